@@ -48,6 +48,7 @@ struct CliParameters {
     int window_height = 0;
 
     QString pattern;
+    QString stats_format;
 
     CliParameters( QCoreApplication& app, bool console = false )
     {
@@ -83,6 +84,9 @@ struct CliParameters {
                                                               << "pattern",
                                                 "pattern to search for", "pattern" );
 
+        const QCommandLineOption statsOption(
+            "stats", "print indexing and search statistics to stderr (json)", "format" );
+
         const QCommandLineOption debugOption(
             QStringList() << "d"
                           << "debug",
@@ -105,6 +109,7 @@ struct CliParameters {
         }
         else {
             parser.addOption( patternOption );
+            parser.addOption( statsOption );
         }
 
         parser.process( app );
@@ -150,6 +155,15 @@ struct CliParameters {
             if ( parser.isSet( patternOption ) ) {
                 pattern = parser.value( patternOption );
             }
+
+            if ( parser.isSet( statsOption ) ) {
+                stats_format = parser.value( statsOption );
+                if ( stats_format != "json" ) {
+                    std::cerr << "Unsupported statistics format " << stats_format.toStdString()
+                              << "\n";
+                    exit( EXIT_FAILURE );
+                }
+            }
         }
 
         for ( const auto& file : parser.positionalArguments() ) {
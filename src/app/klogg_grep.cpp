@@ -19,11 +19,15 @@
 
 #include <mimalloc.h>
 
+#include <QJsonDocument>
+#include <QJsonObject>
+
 #include "configuration.h"
 #include "logdata.h"
 #include "logfiltereddata.h"
 #include "dispatch_to.h"
 #include "logger.h"
+#include "performancestats.h"
 #include "persistentinfo.h"
 
 #include "cli.h"
@@ -37,6 +41,8 @@ int main( int argc, char* argv[] )
 #endif
     qRegisterMetaType<LinesCount>( "LinesCount" );
     qRegisterMetaType<LineNumber>( "LineNumber" );
+    qRegisterMetaType<IndexingStats>( "IndexingStats" );
+    qRegisterMetaType<SearchStats>( "SearchStats" );
 
     QCoreApplication app( argc, argv );
     CliParameters parameters( app, true );
@@ -48,6 +54,16 @@ int main( int argc, char* argv[] )
     LogData logData;
     auto filteredData = logData.getNewFilteredData();
 
+    QJsonObject stats;
+    logData.connect( &logData, &LogData::indexingStatsCollected,
+                     [ & ]( const IndexingStats& indexingStats ) {
+                         stats.insert( "indexing", indexingStats.toJson() );
+                     } );
+    filteredData->connect( filteredData.get(), &LogFilteredData::searchStatsCollected,
+                           [ & ]( const SearchStats& searchStats ) {
+                               stats.insert( "search", searchStats.toJson() );
+                           } );
+
     filteredData->connect(
         filteredData.get(), &LogFilteredData::searchProgressed,
         [ & ]( LinesCount nbMatches, int progress, LineNumber ) {
@@ -66,6 +82,11 @@ int main( int argc, char* argv[] )
                     }
                 }
 
+                if ( !parameters.stats_format.isEmpty() ) {
+                    std::cout.flush();
+                    std::cerr << QJsonDocument( stats ).toJson().toStdString();
+                }
+
                 exit( EXIT_SUCCESS );
             }
         } );
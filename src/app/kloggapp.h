@@ -46,6 +46,7 @@
 #include "crashhandler.h"
 #include "klogg_version.h"
 #include "log.h"
+#include "performancestats.h"
 #include "session.h"
 #include "uuid.h"
 
@@ -73,6 +74,8 @@ class KloggApp : public QApplication {
         qRegisterMetaType<std::vector<LineNumber>>( "std::vector<LineNumber>" );
         qRegisterMetaType<klogg::vector<LineNumber>>( "klogg::vector<LineNumber>" );
         qRegisterMetaType<LineLength>( "LineLength" );
+        qRegisterMetaType<IndexingStats>( "IndexingStats" );
+        qRegisterMetaType<SearchStats>( "SearchStats" );
         qRegisterMetaType<Portion>( "Portion" );
         qRegisterMetaType<Selection>( "Selection" );
         qRegisterMetaType<QFNotification>( "QFNotification" );
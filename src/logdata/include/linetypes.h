@@ -21,10 +21,12 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <optional>
 #include <qglobal.h>
 #include <string_view>
+#include <utility>
 
 #include <type_safe/narrow_cast.hpp>
 #include <type_safe/strong_typedef.hpp>
@@ -306,21 +308,79 @@ private:
 // Length of a tab stop
 constexpr int TabStop = 8;
 
-inline QString untabify( QString&& line, LineColumn initialPosition = 0_lcol )
+// Maps columns of a line to columns of the line with tabs expanded
+class TabColumnMap {
+  public:
+    void clear()
+    {
+        tabs_.clear();
+    }
+
+    bool empty() const
+    {
+        return tabs_.empty();
+    }
+
+    // Tabs have to be added in order of their columns
+    void addTab( LineColumn rawColumn, LineLength addedSpaces )
+    {
+        const auto totalSpaces = ( tabs_.empty() ? 0 : tabs_.back().second ) + addedSpaces.get();
+        tabs_.emplace_back( rawColumn.get(), totalSpaces );
+    }
+
+    LineColumn expandedColumn( LineColumn rawColumn ) const
+    {
+        const auto nextTab = std::lower_bound(
+            tabs_.begin(), tabs_.end(), rawColumn.get(),
+            []( const auto& tab, LineColumn::UnderlyingType column ) {
+                return tab.first < column;
+            } );
+
+        return nextTab == tabs_.begin()
+                   ? rawColumn
+                   : rawColumn + LineLength{ std::prev( nextTab )->second };
+    }
+
+  private:
+    // Column of each tab and the spaces added by it and all tabs before it
+    klogg::vector<std::pair<LineColumn::UnderlyingType, LineLength::UnderlyingType>> tabs_;
+};
+
+// Expands tabs in one pass, text between tabs is copied as a whole.
+// If columnMap is passed, it receives the expanded positions of the tabs.
+inline QString untabify( QString&& line, LineColumn initialPosition = 0_lcol,
+                         TabColumnMap* columnMap = nullptr )
 {
     line.replace( QChar::Null, QChar::Space );
+    if ( columnMap ) {
+        columnMap->clear();
+    }
+
+    auto tabPosition = line.indexOf( QChar::Tabulation );
+    if ( tabPosition < 0 ) {
+        return std::move( line );
+    }
+
+    QString expandedLine;
+    expandedLine.reserve( line.size() + ( TabStop - 1 ) * line.count( QChar::Tabulation ) );
+
+    decltype( tabPosition ) textStart = 0;
+    while ( tabPosition >= 0 ) {
+        expandedLine.append( line.constData() + textStart, tabPosition - textStart );
+
+        const auto spaces
+            = TabStop - ( ( initialPosition.get() + expandedLine.size() ) % TabStop );
+        expandedLine.resize( expandedLine.size() + spaces, QChar::Space );
+        if ( columnMap ) {
+            columnMap->addTab( LineColumn{ tabPosition }, LineLength{ spaces - 1 } );
+        }
 
-    LineLength::UnderlyingType position = 0;
-    position = type_safe::narrow_cast<LineLength::UnderlyingType>(
-        line.indexOf( QChar::Tabulation, position ) );
-    while ( position >= 0 ) {
-        const auto spaces = TabStop - ( ( initialPosition.get() + position ) % TabStop );
-        line.replace( position, 1, QString( spaces, QChar::Space ) );
-        position = type_safe::narrow_cast<LineLength::UnderlyingType>(
-            line.indexOf( QChar::Tabulation, position ) );
+        textStart = tabPosition + 1;
+        tabPosition = line.indexOf( QChar::Tabulation, textStart );
     }
+    expandedLine.append( line.constData() + textStart, line.size() - textStart );
 
-    return std::move( line );
+    return expandedLine;
 }
 
 template <typename LineType>
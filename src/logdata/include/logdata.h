@@ -40,6 +40,7 @@
 #define LOGDATA_H
 
 #include <memory>
+#include <optional>
 
 #include <QDateTime>
 #include <QFile>
@@ -49,6 +50,7 @@
 #include <qregularexpression.h>
 #include <qtextcodec.h>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "abstractlogdata.h"
@@ -59,6 +61,7 @@
 #include "logdataworker.h"
 
 class LogFilteredData;
+class SearchCoordinator;
 
 // Thrown when trying to attach an already attached LogData
 class CantReattachErr {
@@ -93,6 +96,11 @@ class LogData : public AbstractLogData {
     std::unique_ptr<LogFilteredData> getNewFilteredData() const;
     // Returns the size if the file in bytes
     qint64 getFileSize() const;
+    // Returns digests of the indexed file content.
+    IndexedHash getIndexedHash() const;
+    // Checks that the file starts with content that had the passed hash,
+    // i.e. the file was only appended to since then.
+    bool hasContentPrefix( const IndexedHash& hash ) const;
     // Returns the last modification date for the file.
     // Null if the file is not on disk.
     QDateTime getLastModifiedDate() const;
@@ -102,7 +110,28 @@ class LogData : public AbstractLogData {
     // Get the auto-detected encoding for the indexed text.
     QTextCodec* getDetectedEncoding() const;
 
+    // Timestamp format detected at the beginning of lines when indexing,
+    // empty if lines have no known timestamps or they are not in order.
+    QString getTimestampFormat() const;
+    // Parses the time using the detected timestamp format.
+    // Time of day alone is completed with the date of dateLine.
+    std::optional<int64_t> parseTimestamp( const QString& time,
+                                           OptionalLineNumber dateLine = {} ) const;
+    // Returns the first line with timestamp not earlier than the passed one,
+    // empty if there is no such line.
+    OptionalLineNumber getLineForTimestamp( int64_t timestamp ) const;
+
     void setPrefilter(const QString& prefilterPattern);
+    // Whether a prefilter hides parts of lines
+    bool hasPrefilter() const;
+    // Pattern of the text removed from lines, empty if there is no prefilter
+    QString getPrefilter() const;
+
+    // Returns the name of the attached file
+    QString getFileName() const;
+    // Returns offsets in the file of the first byte of the lines and of
+    // the byte after the last one, line feed included.
+    std::pair<qint64, qint64> getLinesByteRange( LineNumber first, LinesCount number ) const;
 
     struct RawLines {
         LineNumber startLine;
@@ -124,6 +153,9 @@ class LogData : public AbstractLogData {
 
     RawLines getLinesRaw( LineNumber first, LinesCount number ) const;
 
+    // Shared by all filtered data of this log data to search in one pass.
+    SearchCoordinator& searchCoordinator() const;
+
   Q_SIGNALS:
     // Sent during the 'attach' process to signal progress
     // percent being the percentage of completion.
@@ -133,6 +165,8 @@ class LogData : public AbstractLogData {
     // Sent when the file on disk has changed, will be followed
     // by loadingProgressed if needed and then a loadingFinished.
     void fileChanged( MonitoredFileStatus status );
+    // Sent after each indexing operation with its timings.
+    void indexingStatsCollected( const IndexingStats& stats );
 
   private Q_SLOTS:
     // Consider reloading the file when it changes on disk updated
@@ -183,6 +217,9 @@ class LogData : public AbstractLogData {
     MonitoredFileStatus fileChangedOnDisk_;
 
     QString prefilterPattern_;
+
+    // Declared last to stop scanning before the rest is destroyed
+    std::unique_ptr<SearchCoordinator> searchCoordinator_;
 };
 
 #endif
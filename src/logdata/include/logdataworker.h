@@ -61,6 +61,8 @@
 #include "encodingdetector.h"
 #include "linepositionarray.h"
 #include "loadingstatus.h"
+#include "performancestats.h"
+#include "timestampindex.h"
 
 struct IndexedHash {
     qint64 size = 0;
@@ -146,6 +148,17 @@ public:
         data_->addAll( block, length, linePosition, encoding );
     }
 
+    // Sparse index of timestamps found at the beginning of lines
+    const TimestampIndex& getTimestamps() const
+    {
+        return data_->getTimestamps();
+    }
+
+    void addTimestamps( const TimestampIndex& timestamps )
+    {
+        data_->addTimestamps( timestamps );
+    }
+
     void setHeaderHash( quint64 digest, qint64 size )
     {
         data_->hash_.headerSize = size;
@@ -219,6 +232,9 @@ private:
     void addAll( const klogg::vector<char>& block, LineLength length,
                  const FastLinePositionArray& linePosition, QTextCodec* encoding );
 
+    const TimestampIndex& getTimestamps() const;
+    void addTimestamps( const TimestampIndex& timestamps );
+
     // Completely clear the indexing data.
     void clear();
 
@@ -235,6 +251,8 @@ private:
 
     LineLength maxLength_;
 
+    TimestampIndex timestamps_;
+
     int progress_{};
 
     FileDigest hashBuilder_;
@@ -257,9 +275,12 @@ struct IndexingState {
     LineLength::UnderlyingType additional_spaces{};
     OffsetInFile::UnderlyingType end{};
     OffsetInFile::UnderlyingType file_size{};
+    LineNumber::UnderlyingType line_number{};
 
     QTextCodec* encodingGuess{};
     QTextCodec* fileTextCodec{};
+
+    TimestampExtractor timestampExtractor;
 };
 
 using OperationResult = std::variant<bool, MonitoredFileStatus>;
@@ -283,6 +304,7 @@ Q_SIGNALS:
     void indexingProgressed( int );
     void indexingFinished( bool );
     void fileCheckFinished( MonitoredFileStatus );
+    void indexingStatsCollected( const IndexingStats& );
 
 protected:
     using BlockBuffer = klogg::vector<char>;
@@ -299,13 +321,15 @@ protected:
 
 private:
     FastLinePositionArray parseDataBlock( OffsetInFile::UnderlyingType blockBegining,
-                                          const BlockBuffer& block, IndexingState& state ) const;
+                                          const BlockBuffer& block, IndexingState& state,
+                                          TimestampIndex& timestamps ) const;
 
     void guessEncoding( const BlockBuffer& block, IndexingData::MutateAccessor& scopedAccessor,
                         IndexingState& state ) const;
 
-    std::chrono::microseconds readFileInBlocks( QFile& file, BlockPrefetcher& blockPrefetcher );
-    void indexNextBlock( IndexingState& state, const BlockData& blockData );
+    std::chrono::microseconds readFileInBlocks( QFile& file, BlockPrefetcher& blockPrefetcher,
+                                                IndexingStats& stats );
+    void indexNextBlock( IndexingState& state, const BlockData& blockData, IndexingStats& stats );
 };
 
 class FullIndexOperation : public IndexOperation {
@@ -394,6 +418,9 @@ Q_SIGNALS:
     // to copy the new data back.
     void checkFileChangesFinished( MonitoredFileStatus status );
 
+    // Sent after each indexing operation with its timings
+    void indexingStatsCollected( const IndexingStats& stats );
+
 private Q_SLOTS:
     void onIndexingFinished( bool result );
     void onCheckFileFinished( MonitoredFileStatus result );
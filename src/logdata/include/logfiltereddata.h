@@ -42,8 +42,8 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <tuple>
-#include <unordered_map>
 
 #include <QByteArray>
 #include <QList>
@@ -56,6 +56,7 @@
 #include "hsregularexpression.h"
 #include "linetypes.h"
 #include "logfiltereddataworker.h"
+#include "searchresultscache.h"
 #include "synchronization.h"
 
 class LogData;
@@ -96,6 +97,15 @@ class LogFilteredData : public AbstractLogData {
     // Returns the line 'index' in filterd log data that matches
     // given original line number
     LineNumber getLineIndexNumber( LineNumber lineNumber ) const;
+    // Returns line numbers in the original LogData of elements
+    // from 'first' to 'first + number', in one pass over the results.
+    klogg::vector<LineNumber::UnderlyingType> getMatchingLineNumbers( LineNumber first,
+                                                                      LinesCount number ) const;
+    // Returns the LogData the lines are found in
+    const LogData* getSourceLogData() const
+    {
+        return sourceLogData_;
+    }
 
     // Returns the number of lines in the source log data
     LinesCount getNbTotalLines() const;
@@ -104,6 +114,12 @@ class LogFilteredData : public AbstractLogData {
     // Returns the number of marks (independently of the visibility)
     LinesCount getNbMarks() const;
 
+    // Published sets of matching lines, marked lines and their union.
+    // They are never changed and can be read from any thread.
+    SearchResultsSnapshot getMatchingLines() const;
+    SearchResultsSnapshot getMarkedLines() const;
+    SearchResultsSnapshot getMarkedAndMatchingLines() const;
+
     LineType lineTypeByIndex( LineNumber index ) const;
     LineType lineTypeByLine( LineNumber lineNumber ) const;
 
@@ -121,6 +137,11 @@ class LogFilteredData : public AbstractLogData {
     void toggleMark( LineNumber line );
     // Completely clear the marks list.
     void clearMarks();
+    // Bulk versions of the above for large sets of lines,
+    // lines outside of the file are ignored.
+    void addMarks( const SearchResultArray& lines );
+    void removeMarks( const SearchResultArray& lines );
+    void toggleMarks( const SearchResultArray& lines );
     // Get all marked lines
     QList<LineNumber> getMarks() const;
 
@@ -137,11 +158,16 @@ class LogFilteredData : public AbstractLogData {
     Visibility visibility() const;
 
     void iterateOverLines( const std::function<void( LineNumber )>& callback ) const;
+    // Iterates over visible lines starting at the passed filtered index
+    void iterateOverLines( LineNumber firstIndex,
+                           const std::function<void( LineNumber )>& callback ) const;
   Q_SIGNALS:
     // Sent when the search has progressed, give the number of matches (so far)
     // and the percentage of completion
     void searchProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
     void searchProgressedThrottled();
+    // Sent before the final searchProgressed with timings of the search
+    void searchStatsCollected( const SearchStats& stats );
 
   private Q_SLOTS:
     void handleSearchProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
@@ -153,8 +179,9 @@ class LogFilteredData : public AbstractLogData {
     QString doGetExpandedLineString( LineNumber line ) const override;
     klogg::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
     klogg::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    // Reads runs of close source lines at once instead of line by line
     klogg::vector<QString> doGetLines( LineNumber first, LinesCount number,
-                                     const std::function<QString( LineNumber )>& lineGetter ) const;
+                                       bool expandTabs ) const;
     LineNumber doGetLineNumber( LineNumber index ) const override;
     LinesCount doGetNbLine() const override;
     LineLength doGetMaxLength() const override;
@@ -174,10 +201,11 @@ class LogFilteredData : public AbstractLogData {
     // Returns wheither the passed line has a mark on it.
     bool isLineMarked( LineNumber line ) const;
 
-    // List of the matching line numbers
-    SearchResultArray matching_lines_;
-    SearchResultArray marks_;
-    SearchResultArray marks_and_matches_;
+    // List of the matching line numbers. Snapshots are replaced as a whole
+    // on the main thread, other threads read them through load().
+    SearchResultsSnapshot matching_lines_;
+    SearchResultsSnapshot marks_;
+    SearchResultsSnapshot marks_and_matches_;
 
     const LogData* sourceLogData_;
 
@@ -197,54 +225,26 @@ class LogFilteredData : public AbstractLogData {
     KDToolBox::KDSignalThrottler searchProgressThrottler_;
 
   private:
-    struct CachedSearchResult {
-        SearchResultArray matching_lines;
-        LineLength maxLength;
-    };
-
-    using SearchCacheKey = std::tuple<RegularExpressionPattern, LineNumber::UnderlyingType,
-                                      LineNumber::UnderlyingType>;
-    struct SearchCacheKeyHash {
-        template <class T>
-        void hash_combine( std::size_t& seed, const T& v ) const
-        {
-            seed ^= std::hash<T>()( v ) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
-        }
-        std::size_t operator()( const SearchCacheKey& k ) const
-        {
-            size_t seed = qHash( std::get<0>( k ).pattern );
-
-            hash_combine( seed, std::get<0>( k ).isPlainText );
-            hash_combine( seed, std::get<0>( k ).isBoolean );
-            hash_combine( seed, std::get<0>( k ).isCaseSensitive );
-            hash_combine( seed, std::get<0>( k ).isExclude );
-            hash_combine( seed, std::get<1>( k ) );
-            hash_combine( seed, std::get<2>( k ) );
-            return seed;
-        }
-    };
-
-    std::unordered_map<SearchCacheKey, CachedSearchResult, SearchCacheKeyHash> searchResultsCache_;
-    SearchCacheKey currentSearchKey_;
-
-    SearchCacheKey makeCacheKey( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                 LineNumber endLine )
-    {
-        return std::make_tuple( regExp, startLine.get(), endLine.get() );
-    }
+    std::optional<SearchResultsCache::Key> currentSearchKey_;
 
     void updateSearchResultsCache();
 
-    inline LineNumber getExpectedSearchEnd( const SearchCacheKey& cacheKey ) const
-    {
-        return LineNumber( std::get<2>( cacheKey ) );
-    }
-
     // Utility functions
-    const SearchResultArray& currentResultArray() const;
+    SearchResultsSnapshot currentResults() const;
+    static SearchResultsSnapshot load( const SearchResultsSnapshot& results );
+    static void store( SearchResultsSnapshot& target, SearchResultsSnapshot results );
     LineNumber findLogDataLine( LineNumber lineNum ) const;
     LineNumber findFilteredLine( LineNumber lineNum ) const;
 
+    // Replaces marks and their union with matches
+    void setMarks( SearchResultArray marks );
+    void setMarks( SearchResultArray marks, SearchResultArray marksAndMatches );
+    // Adds and removes sets of marks updating their union with matches in place
+    void changeMarks( const SearchResultArray& added, SearchResultArray removed );
+    // Drops lines past the end of the source file
+    SearchResultArray linesInFile( const SearchResultArray& lines ) const;
+    // Length of the longest of passed source lines, they are read in runs
+    LineLength maxLineLength( const SearchResultArray& lines ) const;
     // update maxLengthMarks_ when a Marks was changed.
     void updateMaxLengthMarks( OptionalLineNumber added_line, OptionalLineNumber removed_line );
 };
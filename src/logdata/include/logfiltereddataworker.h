@@ -41,17 +41,25 @@
 
 #include <QObject>
 
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+
 #include <qthreadpool.h>
 
 #ifndef Q_MOC_RUN
-#include <roaring.hh>
-#include <roaring64map.hh>
 #include <tbb/task_group.h>
 #endif
 
 #include "atomicflag.h"
+#include "configuration.h"
+#include "containers.h"
 #include "linetypes.h"
+#include "performancestats.h"
 #include "regularexpression.h"
+#include "searchresultarray.h"
 #include "synchronization.h"
 
 class LogData;
@@ -80,27 +88,106 @@ private:
     LineNumber lineNumber_;
 };
 
-// This is an array of matching lines.
-// It shall be implemented for random lookup speed, so
-// a fixed "in-place" array (vector) is probably fine.
-using SearchResultArray = roaring::Roaring64Map;
+// Collects matching lines found in increasing order. Consecutive lines are
+// inserted as ranges and isolated ones in batches, so results of dense
+// searches are built from run containers instead of line by line.
+class SearchResultsBuilder {
+public:
+    void add( LineNumber line )
+    {
+        if ( runLength_ > 0 && line.get() == runStart_ + runLength_ ) {
+            ++runLength_;
+        }
+        else {
+            flushRun();
+            runStart_ = line.get();
+            runLength_ = 1;
+        }
+    }
+
+    void addRange( LineNumber first, LinesCount count )
+    {
+        flushRun();
+        flushSingles();
+        results_.addRange( first.get(), first.get() + count.get() );
+    }
+
+    SearchResultArray finish()
+    {
+        flushRun();
+        flushSingles();
+        results_.runOptimize();
+        return std::move( results_ );
+    }
+
+private:
+    static constexpr size_t SinglesBatchSize = 1024;
+
+    void flushRun()
+    {
+        if ( runLength_ == 1 ) {
+            singles_.push_back( runStart_ );
+            if ( singles_.size() == SinglesBatchSize ) {
+                flushSingles();
+            }
+        }
+        else if ( runLength_ > 1 ) {
+            results_.addRange( runStart_, runStart_ + runLength_ );
+        }
+        runLength_ = 0;
+    }
+
+    void flushSingles()
+    {
+        if ( !singles_.empty() ) {
+            results_.addMany( singles_.size(), singles_.data() );
+            singles_.clear();
+        }
+    }
+
+private:
+    SearchResultArray results_;
+    klogg::vector<uint64_t> singles_;
+    uint64_t runStart_ = 0;
+    uint64_t runLength_ = 0;
+};
 
 struct SearchResults {
-    SearchResultArray newMatches;
+    SearchResultsSnapshot matches;
+    // Union of matches and the marks below
+    SearchResultsSnapshot marksAndMatches;
+    SearchResultsSnapshot marks;
     LineLength maxLength;
     LinesCount processedLines;
 };
 
 // This class is a mutex protected set of search result data.
 // It is thread safe.
+// Matches are merged by the searching thread and published as immutable
+// snapshots, so the GUI thread only has to swap pointers to show them.
 class SearchData {
 public:
-    // will clear new matches
-    SearchResults takeCurrentResults() const;
+    SearchData();
+
+    // Returns the last published results
+    SearchResults currentResults() const;
 
     // Atomically add to all the existing search data.
     void addAll( LineLength length, const SearchResultArray& matches, LinesCount nbMatches,
                  LinesCount nbLinesProcessed );
+
+    // Makes results added so far visible to currentResults(). Intermediate
+    // results are published at most once per PublishInterval, as copying
+    // the matches costs time proportional to their number. Union with marks
+    // is updated with the matches changed since the previous publishing.
+    void publishResults( bool isFinal );
+
+    // Compacts matches at the end of a full search,
+    // the next publishing rebuilds union with marks from scratch
+    void optimizeResults();
+
+    // Marks to merge with matches when publishing
+    void setMarks( SearchResultsSnapshot marks );
     // Get the number of matches
     LinesCount getNbMatches() const;
     // Get the last matched line number
@@ -117,21 +204,60 @@ public:
     void clear();
 
 private:
+    // Adds matches received out of order to the indexed ones,
+    // has to be called with the data mutex locked
+    void mergePendingMatches();
+
+private:
+    static constexpr std::chrono::milliseconds PublishInterval{ 100 };
+
     mutable SharedMutex dataMutex_;
 
     SearchResultArray matches_;
-    mutable SearchResultArray newMatches_;
+    SearchResultRankIndex matchesIndex_;
+    // Matches below the last indexed one, not counted by matchesIndex_ yet
+    SearchResultArray pendingMatches_;
+
+    // Changes of matches since the last publishing
+    SearchResultArray addedMatches_;
+    klogg::vector<uint64_t> removedMatches_;
+    bool isMarksAndMatchesOutdated_ = false;
     LineLength maxLength_{ 0 };
     LinesCount nbLinesProcessed_{ 0 };
     LinesCount nbMatches_{ 0 };
+
+    SearchResultsSnapshot marks_;
+    SearchResults published_;
+    std::chrono::steady_clock::time_point publishTime_;
+};
+
+// Keeps compiled regular expression and its matchers between searches
+// for the same pattern. Follow mode updates reuse them instead of
+// compiling patterns and allocating matching scratch space on each append.
+// Used only from the worker's operation thread.
+class SearchSession {
+public:
+    using MatcherList = klogg::vector<std::unique_ptr<PatternMatcher>>;
+
+    // Returns at least matchersCount matchers for the pattern,
+    // creating new ones only if the pattern or the regexp engine has changed.
+    const MatcherList& matchers( const RegularExpressionPattern& pattern, size_t matchersCount );
+
+    void reset();
+
+private:
+    std::optional<RegularExpressionPattern> pattern_;
+    RegexpEngine engine_ = RegexpEngine::Hyperscan;
+    std::unique_ptr<RegularExpression> expression_;
+    MatcherList matchers_;
 };
 
 class SearchOperation : public QObject {
     Q_OBJECT
 public:
     SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                     const RegularExpressionPattern& regExp, LineNumber startLine,
-                     LineNumber endLine );
+                     SearchSession& session, const RegularExpressionPattern& regExp,
+                     LineNumber startLine, LineNumber endLine );
 
     // Run the search operation, returns true if it has been done
     // and false if it has been cancelled (results not copied)
@@ -139,6 +265,7 @@ public:
 
 Q_SIGNALS:
     void searchProgressed( LinesCount nbMatches, int percent, LineNumber initialLine );
+    void searchStatsCollected( const SearchStats& stats );
     void searchFinished();
 
 protected:
@@ -146,33 +273,29 @@ protected:
     // the shared results and the line to begin the search from.
     void doSearch( SearchData& result, LineNumber initialLine );
 
+private:
+    // Searches a range that fits into one read chunk on the calling
+    // thread, without building the matching pipeline.
+    void doSearchInline( SearchData& result, const PatternMatcher& matcher,
+                         LineNumber initialLine, LineNumber endLine );
+
+protected:
     AtomicFlag& interruptRequested_;
+    SearchSession& session_;
     const RegularExpressionPattern regexp_;
     const LogData& sourceLogData_;
     LineNumber startLine_;
     LineNumber endLine_;
 };
 
-class FullSearchOperation : public SearchOperation {
-    Q_OBJECT
-public:
-    FullSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                         const RegularExpressionPattern& regExp, LineNumber startLine,
-                         LineNumber endLine )
-        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
-    {
-    }
-
-    void run( SearchData& result ) override;
-};
-
 class UpdateSearchOperation : public SearchOperation {
     Q_OBJECT
 public:
     UpdateSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                           const RegularExpressionPattern& regExp, LineNumber startLine,
-                           LineNumber endLine, LineNumber position )
-        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+                           SearchSession& session, const RegularExpressionPattern& regExp,
+                           LineNumber startLine, LineNumber endLine, LineNumber position )
+        : SearchOperation( sourceLogData, interruptRequested, session, regExp, startLine,
+                           endLine )
         , initialPosition_( position )
     {
     }
@@ -196,19 +319,33 @@ public:
     LogFilteredDataWorker( LogFilteredDataWorker&& ) = delete;
     LogFilteredDataWorker& operator=( LogFilteredDataWorker&& ) = delete;
 
-    // Start the search with the passed regexp
-    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine );
+    // Looks for results found earlier for the same pattern
+    // in the beginning of the file
+    using PreviousResultsLookup = std::function<std::optional<SearchResults>()>;
+
+    // Start the search with the passed regexp. If previousResults is set,
+    // it is called in the worker thread first, and the search continues
+    // from the results it returns.
+    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine,
+                 PreviousResultsLookup previousResults = {} );
     // Continue the previous search starting at the passed position
     // in the source file (line number)
     void updateSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
                        LineNumber endLine, LineNumber position );
 
+    // Runs the task in the worker thread after the current operation,
+    // task must not access search data
+    void runInBackground( std::function<void()> task );
+
     // Interrupts the search if one is in progress
     void interrupt();
 
-    // get the current indexing data
+    // get the last published search results
     SearchResults getSearchResults() const;
 
+    // Marks to include into published results
+    void setMarks( SearchResultsSnapshot marks );
+
 Q_SIGNALS:
     // Sent during the indexing process to signal progress
     // percent being the percentage of completion.
@@ -216,9 +353,18 @@ Q_SIGNALS:
     // Sent when indexing is finished, signals the client
     // to copy the new data back.
     void searchFinished();
+    // Sent before searchFinished with timings of the search
+    void searchStatsCollected( const SearchStats& stats );
 
 private:
     void connectSignalsAndRun( SearchOperation* operationRequested );
+    void waitForCoordinatedSearch();
+
+    // Both require operationsMutex_ to be locked
+    void submitSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine );
+    void resumeSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine, const SearchResults& previousResults );
 
 private:
     const LogData& sourceLogData_;
@@ -229,6 +375,12 @@ private:
 
     // Shared indexing data
     SearchData searchData_;
+
+    // Warm matchers, protected by operationsMutex_
+    SearchSession searchSession_;
+
+    // Full search running in the shared scan of source log data
+    std::shared_future<void> coordinatedSearch_;
 };
 
 #endif
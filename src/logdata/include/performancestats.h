@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PERFORMANCESTATS_H
+#define KLOGG_PERFORMANCESTATS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <QJsonObject>
+#include <QMetaType>
+
+#include "containers.h"
+#include "linetypes.h"
+
+// Distribution of durations in power of two buckets of microseconds,
+// bucket i counts durations below 2^i us.
+class DurationHistogram {
+  public:
+    static constexpr size_t BucketsCount = 32;
+
+    void add( std::chrono::microseconds duration );
+    void merge( const DurationHistogram& other );
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+    std::chrono::microseconds total() const
+    {
+        return total_;
+    }
+
+    std::chrono::microseconds max() const
+    {
+        return max_;
+    }
+
+    QJsonObject toJson() const;
+
+  private:
+    std::array<uint64_t, BucketsCount> buckets_{};
+    uint64_t count_ = 0;
+    std::chrono::microseconds total_{};
+    std::chrono::microseconds min_{};
+    std::chrono::microseconds max_{};
+};
+
+// Measures time between construction and stop, or destruction.
+class ScopedDuration {
+  public:
+    explicit ScopedDuration( DurationHistogram& histogram )
+        : histogram_( &histogram )
+        , start_( std::chrono::high_resolution_clock::now() )
+    {
+    }
+
+    ~ScopedDuration()
+    {
+        stop();
+    }
+
+    ScopedDuration( const ScopedDuration& ) = delete;
+    ScopedDuration& operator=( const ScopedDuration& ) = delete;
+    ScopedDuration( ScopedDuration&& ) = delete;
+    ScopedDuration& operator=( ScopedDuration&& ) = delete;
+
+    void stop()
+    {
+        if ( histogram_ ) {
+            histogram_->add( std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - start_ ) );
+            histogram_ = nullptr;
+        }
+    }
+
+  private:
+    DurationHistogram* histogram_;
+    std::chrono::high_resolution_clock::time_point start_;
+};
+
+struct IndexingStats {
+    qint64 indexedBytes = 0;
+    LinesCount indexedLines;
+    std::chrono::microseconds duration{};
+
+    // Reading of each block from file
+    DurationHistogram blockRead;
+    // Reader waiting for parser to free a prefetch slot
+    DurationHistogram queueWait;
+    // Finding line feeds and timestamps in a block
+    DurationHistogram blockParse;
+    // Waiting for exclusive access to indexing data
+    DurationHistogram indexLock;
+
+    QJsonObject toJson() const;
+};
+
+struct SearchStats {
+    LinesCount searchedLines;
+    LinesCount nbMatches;
+    qint64 searchedBytes = 0;
+    std::chrono::microseconds duration{};
+
+    // Reading and decoding of each chunk of lines
+    DurationHistogram blockRead;
+    // Reader waiting for matchers to free a prefetch slot
+    DurationHistogram queueWait;
+    // Matching of chunks, one histogram per matching thread
+    klogg::vector<DurationHistogram> threadMatch;
+    // Adding results of a chunk to shared search data, including lock wait
+    DurationHistogram resultsLock;
+
+    void addThreadMatch( size_t thread, std::chrono::microseconds duration );
+
+    QJsonObject toJson() const;
+};
+
+Q_DECLARE_METATYPE( IndexingStats )
+Q_DECLARE_METATYPE( SearchStats )
+
+#endif
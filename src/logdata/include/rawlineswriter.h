@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_RAWLINESWRITER_H
+#define KLOGG_RAWLINESWRITER_H
+
+#include <QFile>
+
+#include "containers.h"
+#include "linetypes.h"
+
+class LogData;
+
+// Writes lines of a LogData to another file byte for byte as they are in
+// the source file, without decoding and encoding them again.
+// Byte ranges of lines are taken from the line index. On Linux large ranges
+// are copied in kernel with copy_file_range or sendfile, smaller ones are
+// read in blocks and written with writev in large batches.
+// The destination must not be written through Qt buffers at the same time.
+class RawLinesWriter {
+  public:
+    RawLinesWriter( const LogData& logData, QFileDevice& destination );
+
+    // Opens the source file, returns false if it can not be read
+    bool open();
+
+    // Append lines to the destination, all return false on write errors
+    bool writeLines( LineNumber first, LinesCount number );
+    // Lines must be sorted and follow the ones written before
+    bool writeLines( const klogg::vector<LineNumber::UnderlyingType>& lines );
+    // Writes lines kept in the current batch
+    bool flush();
+
+  private:
+    struct ByteRange {
+        qint64 begin;
+        qint64 end;
+    };
+
+    bool addRange( ByteRange range );
+    bool copyRange( ByteRange range );
+    bool readRange( ByteRange range, char* data );
+    bool writeData( const char* data, qint64 size );
+
+  private:
+    const LogData& logData_;
+    QFile source_;
+    QFileDevice& destination_;
+
+    klogg::vector<ByteRange> batch_;
+    klogg::vector<char> buffer_;
+};
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SEARCHCOORDINATOR_H
+#define KLOGG_SEARCHCOORDINATOR_H
+
+#include <functional>
+#include <future>
+#include <memory>
+
+#include <qthreadpool.h>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+#include "regularexpressionpattern.h"
+#include "synchronization.h"
+
+class LogData;
+
+// Runs full searches of all filtered views of one LogData in a single scan.
+// Each block of lines is read and decoded once, then matched for every view.
+// Patterns that are not boolean combinations are compiled together into one
+// MultiRegularExpression with one pattern per view.
+// A search submitted while the scan is running joins it at the current
+// position and wraps around to the beginning of its range.
+// Next batch of lines is read while the current one is matched.
+class SearchCoordinator {
+  public:
+    struct Request {
+        RegularExpressionPattern pattern;
+        LineNumber startLine;
+        LineNumber endLine;
+
+        SearchData* results;
+        AtomicFlag* interruptRequested;
+
+        std::function<void( LinesCount nbMatches, int percent, LineNumber initialLine )>
+            progressed;
+        // Timings of the shared scan while the search was part of it
+        std::function<void( const SearchStats& stats )> statsCollected;
+        std::function<void()> finished;
+    };
+
+    explicit SearchCoordinator( const LogData& sourceLogData );
+    ~SearchCoordinator();
+
+    SearchCoordinator( const SearchCoordinator& ) = delete;
+    SearchCoordinator& operator=( const SearchCoordinator& ) = delete;
+
+    SearchCoordinator( SearchCoordinator&& ) = delete;
+    SearchCoordinator& operator=( SearchCoordinator&& ) = delete;
+
+    // Returned future becomes ready when the search is finished or interrupted.
+    // After that results and callbacks of the request are not used anymore.
+    std::shared_future<void> submit( Request request );
+
+  private:
+    struct ActiveSearch;
+    using ActiveSearchList = klogg::vector<std::unique_ptr<ActiveSearch>>;
+
+    struct ScanBatch;
+
+    void scan();
+    void doScan( ActiveSearchList& searches );
+
+    ScanBatch readBatch( LineNumber begin, LineNumber end, LinesCount nbLinesInChunk ) const;
+    std::future<ScanBatch> prefetchBatch( LineNumber begin, LineNumber end,
+                                          LinesCount nbLinesInChunk );
+
+  private:
+    const LogData& sourceLogData_;
+
+    Mutex pendingMutex_;
+    ActiveSearchList pendingSearches_;
+    bool isScanning_ = false;
+
+    QThreadPool scanPool_;
+    QThreadPool readPool_;
+};
+
+#endif
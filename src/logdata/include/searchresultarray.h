@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SEARCHRESULTARRAY_H
+#define KLOGG_SEARCHRESULTARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <variant>
+
+#include <roaring.hh>
+#include <roaring64map.hh>
+
+#include "containers.h"
+#include "linetypes.h"
+
+// Set of line numbers used for search results and marks.
+// Uses 32-bit Roaring bitmap while all lines fit into 32 bits, its rank and
+// select are much cheaper than those of Roaring64Map that keeps a std::map
+// of 32-bit bitmaps. Switches to the 64-bit map when a larger line is added.
+class SearchResultArray {
+  public:
+    using Iterator = bool ( * )( uint64_t value, void* context );
+
+    SearchResultArray() = default;
+
+    // Chooses representation for lines of a file with nbLines lines
+    static SearchResultArray forLines( LinesCount nbLines );
+
+    bool isWide() const
+    {
+        return std::holds_alternative<roaring::Roaring64Map>( bitmap_ );
+    }
+
+    void add( uint64_t value );
+    // Returns false if the value was already present
+    bool addChecked( uint64_t value );
+    // Adds all values in [min, max)
+    void addRange( uint64_t min, uint64_t max );
+    void addMany( size_t count, const uint64_t* values );
+    void remove( uint64_t value );
+
+    bool contains( uint64_t value ) const;
+    uint64_t cardinality() const;
+    bool isEmpty() const;
+    // Smallest and largest values, the set must not be empty
+    uint64_t minimum() const;
+    uint64_t maximum() const;
+    // Whether all values of the set are in the other one
+    bool isSubsetOf( const SearchResultArray& other ) const;
+
+    // Number of values less than or equal to the passed one
+    uint64_t rank( uint64_t value ) const;
+    // Value with passed zero-based rank
+    bool select( uint64_t rank, uint64_t* element ) const;
+
+    void iterate( Iterator iterator, void* context ) const;
+    // Iterates over values greater than or equal to the passed one
+    void iterateFrom( uint64_t from, Iterator iterator, void* context ) const;
+
+    bool runOptimize();
+
+    size_t getSizeInBytes( bool portable = true ) const;
+    size_t write( char* buffer, bool portable = true ) const;
+    // Throws on invalid data
+    static SearchResultArray readSafe( const char* buffer, size_t maxBytes );
+
+    SearchResultArray& operator|=( const SearchResultArray& other );
+    SearchResultArray& operator&=( const SearchResultArray& other );
+    SearchResultArray& operator-=( const SearchResultArray& other );
+
+    friend SearchResultArray operator|( const SearchResultArray& lhs,
+                                        const SearchResultArray& rhs )
+    {
+        SearchResultArray result = lhs;
+        result |= rhs;
+        return result;
+    }
+
+  private:
+    static bool isNarrowValue( uint64_t value )
+    {
+        return value <= UINT32_MAX;
+    }
+
+    void widen();
+
+    // Applies in place operation to bitmaps of the same width
+    template <typename Operation>
+    SearchResultArray& combine( const SearchResultArray& other, Operation operation );
+
+  private:
+    std::variant<roaring::Roaring, roaring::Roaring64Map> bitmap_;
+};
+
+// Side table for fast rank and select on a large SearchResultArray.
+// Roaring select walks the cardinalities of all containers before the one
+// holding the value, and run containers have to sum their runs to know it.
+// The table keeps every SampleStep-th value of the set, so a lookup is a
+// binary search or an array access followed by a short iteration.
+// It has to be rebuilt or extended after each change of the indexed set.
+class SearchResultRankIndex {
+  public:
+    static constexpr uint64_t SampleStep = 256;
+
+    void clear();
+    void rebuild( const SearchResultArray& results );
+    // Indexes values added after the last indexed one,
+    // the added values must all be greater than it
+    void extend( const SearchResultArray& results );
+    // Reindexes values starting at the smallest one that has been added
+    // or removed, samples of smaller values are kept
+    void rebuildFrom( const SearchResultArray& results, uint64_t firstChanged );
+    // Drops the largest value after it has been removed from results
+    void removeLast( const SearchResultArray& results );
+
+    uint64_t cardinality() const
+    {
+        return cardinality_;
+    }
+
+    // Same as SearchResultArray::rank for the indexed set
+    uint64_t rank( const SearchResultArray& results, uint64_t value ) const;
+    // Same as SearchResultArray::select for the indexed set
+    bool select( const SearchResultArray& results, uint64_t rank, uint64_t* element ) const;
+
+  private:
+    // Value of rank i * SampleStep is at index i
+    klogg::vector<uint64_t> samples_;
+    uint64_t cardinality_ = 0;
+    uint64_t lastValue_ = 0;
+};
+
+// Result set with its rank table. Published sets are never changed, so
+// views can read them from any thread while the next one is being built.
+struct IndexedSearchResults {
+    IndexedSearchResults() = default;
+
+    explicit IndexedSearchResults( SearchResultArray results )
+        : lines( std::move( results ) )
+    {
+        index.rebuild( lines );
+    }
+
+    IndexedSearchResults( SearchResultArray results, SearchResultRankIndex resultsIndex )
+        : lines( std::move( results ) )
+        , index( std::move( resultsIndex ) )
+    {
+    }
+
+    uint64_t cardinality() const
+    {
+        return index.cardinality();
+    }
+
+    uint64_t rank( uint64_t value ) const
+    {
+        return index.rank( lines, value );
+    }
+
+    bool select( uint64_t rank, uint64_t* element ) const
+    {
+        return index.select( lines, rank, element );
+    }
+
+    SearchResultArray lines;
+    SearchResultRankIndex index;
+};
+
+using SearchResultsSnapshot = std::shared_ptr<const IndexedSearchResults>;
+
+#endif
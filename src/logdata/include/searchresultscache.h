@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SEARCHRESULTSCACHE_H
+#define KLOGG_SEARCHRESULTSCACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+
+#include <QString>
+
+#include "linetypes.h"
+#include "logdataworker.h"
+#include "logfiltereddataworker.h"
+#include "regularexpressionpattern.h"
+#include "synchronization.h"
+
+// Least recently used cache of search results shared by all filtered views.
+// Results are bound to the content of the searched file by its IndexedHash,
+// not to the file name, and are stored on disk to survive restarts.
+// Total size of stored result sets is limited by configuration.
+// Methods read and write files, they are called from the search worker.
+class SearchResultsCache {
+  public:
+    struct Key {
+        RegularExpressionPattern pattern;
+        LineNumber startLine;
+        LineNumber endLine;
+        IndexedHash fileHash;
+        // Same bytes decoded differently or with parts of lines
+        // removed by a prefilter have different matches
+        QString codecName;
+        QString prefilterPattern;
+    };
+
+    struct Results {
+        SearchResultArray matchingLines;
+        LineLength maxLength;
+        // Lines of the file that were searched, counting from its beginning.
+        // Less than key's end line if new data was appended to the file since.
+        LinesCount processedLines;
+    };
+
+    using ContentPrefixCheck = std::function<bool( const IndexedHash& )>;
+
+    static SearchResultsCache& get();
+
+    // Looks for results of the same search in the same file content.
+    // Otherwise returns results for the longest earlier version of the file
+    // that was searched to the end, if hasContentPrefix confirms that the
+    // file only had data appended since.
+    std::optional<Results> find( const Key& key, const ContentPrefixCheck& hasContentPrefix );
+
+    // fileLines is the number of lines in the file when it was searched
+    void insert( const Key& key, const Results& results, LinesCount fileLines );
+
+  private:
+    SearchResultsCache();
+
+    struct Entry {
+        Key key;
+        LinesCount fileLines;
+        LineLength maxLength;
+        LinesCount processedLines;
+
+        QString fileName;
+        uint64_t sizeInBytes = 0;
+
+        // Loaded from disk on first use
+        std::optional<SearchResultArray> matchingLines;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    void loadIndex();
+    bool loadMatchingLines( Entry& entry ) const;
+    bool store( Entry& entry ) const;
+
+    void touch( EntryList::iterator entry );
+    void evict();
+
+  private:
+    Mutex mutex_;
+
+    QString cacheDirectory_;
+
+    // Most recently used first
+    EntryList entries_;
+    uint64_t totalSize_ = 0;
+};
+
+#endif
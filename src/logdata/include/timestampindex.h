@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMESTAMPINDEX_H
+#define KLOGG_TIMESTAMPINDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include <QString>
+#include <QStringList>
+
+#include "containers.h"
+#include "linetypes.h"
+
+// Parses timestamp with fixed layout at the beginning of a line.
+// Format fields are yyyy, yy, MM, MMM (English month abbreviation), dd,
+// HH, mm, ss and zzz, any other character has to match literally.
+// Parsed time is in milliseconds since epoch, time zone is ignored,
+// missing date fields default to 1970-01-01.
+class TimestampParser {
+  public:
+    explicit TimestampParser( const QString& format );
+
+    bool isValid() const
+    {
+        return !tokens_.empty();
+    }
+
+    const QString& format() const
+    {
+        return format_;
+    }
+
+    std::optional<int64_t> parse( std::string_view line ) const;
+
+  private:
+    enum class Field : uint8_t {
+        Literal,
+        Year,
+        ShortYear,
+        Month,
+        MonthName,
+        Day,
+        Hour,
+        Minute,
+        Second,
+        Millisecond,
+    };
+
+    struct Token {
+        Field field;
+        uint8_t width;
+        char literal;
+    };
+
+    QString format_;
+    klogg::vector<Token> tokens_;
+    size_t length_ = 0;
+};
+
+// Sparse index of line timestamps built during indexing. Holds timestamps of
+// about one line in Stride, and only while they are not decreasing.
+class TimestampIndex {
+  public:
+    static constexpr LineNumber::UnderlyingType Stride = 1024;
+
+    const QString& format() const
+    {
+        return format_;
+    }
+
+    void setFormat( const QString& format )
+    {
+        format_ = format;
+    }
+
+    bool isEmpty() const
+    {
+        return lines_.empty();
+    }
+
+    // False if a timestamp earlier than the previous one was found,
+    // lookups are not possible in that case.
+    bool isMonotone() const
+    {
+        return isMonotone_;
+    }
+
+    void add( LineNumber line, int64_t timestamp );
+    void append( const TimestampIndex& other );
+
+    // Returns range of lines that contains the first line with timestamp
+    // not earlier than the passed one. The end of the range is either
+    // the line of the next index entry or the end of file.
+    std::pair<LineNumber, LineNumber> findRange( int64_t timestamp, LinesCount nbLines ) const;
+
+    void clear();
+
+    size_t allocatedSize() const;
+
+  private:
+    QString format_;
+    klogg::vector<LineNumber::UnderlyingType> lines_;
+    klogg::vector<int64_t> timestamps_;
+    bool isMonotone_ = true;
+};
+
+// Extracts timestamps while lines are indexed. The first of the formats
+// that matches one of the first lines of the file is used for the rest of it.
+class TimestampExtractor {
+  public:
+    static constexpr LineNumber::UnderlyingType DetectionLines = 1000;
+
+    TimestampExtractor() = default;
+    TimestampExtractor( const QStringList& formats, LineNumber nextLine );
+    TimestampExtractor( const TimestampParser& parser, LineNumber nextLine );
+
+    bool isLineWanted( LineNumber line ) const
+    {
+        return ( parser_ || !candidates_.empty() ) && line.get() >= nextLine_;
+    }
+
+    void extract( LineNumber line, std::string_view data, TimestampIndex& timestamps );
+
+  private:
+    klogg::vector<TimestampParser> candidates_;
+    std::optional<TimestampParser> parser_;
+    LineNumber::UnderlyingType nextLine_ = 0;
+};
+
+#endif
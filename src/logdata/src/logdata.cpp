@@ -41,6 +41,7 @@
 #include <algorithm>
 #include <limits>
 #include <numeric>
+#include <optional>
 #include <qregularexpression.h>
 #include <qtextcodec.h>
 #include <string_view>
@@ -53,9 +54,11 @@
 
 #include "configuration.h"
 #include "containers.h"
+#include "filedigest.h"
 #include "linetypes.h"
 #include "log.h"
 #include "logfiltereddata.h"
+#include "searchcoordinator.h"
 
 #include "logdata.h"
 
@@ -64,6 +67,7 @@ LogData::LogData()
     , indexing_data_( std::make_shared<IndexingData>() )
     , operationQueue_( [ this ] { attached_file_->attachReader(); } )
     , codec_( QTextCodec::codecForName( "ISO-8859-1" ) )
+    , searchCoordinator_( std::make_unique<SearchCoordinator>( *this ) )
 {
     // Initialise the file watcher
     connect( &FileWatcher::getFileWatcher(), &FileWatcher::fileChanged, this,
@@ -77,6 +81,8 @@ LogData::LogData()
              Qt::QueuedConnection );
     connect( worker.get(), &LogDataWorker::checkFileChangesFinished, this,
              &LogData::checkFileChangesFinished, Qt::QueuedConnection );
+    connect( worker.get(), &LogDataWorker::indexingStatsCollected, this,
+             &LogData::indexingStatsCollected, Qt::QueuedConnection );
 
     operationQueue_.setWorker( std::move( worker ) );
 
@@ -105,6 +111,37 @@ void LogData::setPrefilter( const QString& prefilterPattern )
     prefilterPattern_ = prefilterPattern;
 }
 
+bool LogData::hasPrefilter() const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    return !prefilterPattern_.isEmpty();
+}
+
+QString LogData::getPrefilter() const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    return prefilterPattern_;
+}
+
+QString LogData::getFileName() const
+{
+    return indexingFileName_;
+}
+
+std::pair<qint64, qint64> LogData::getLinesByteRange( LineNumber first, LinesCount number ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( number.get() == 0 || ( first + number ).get() > scopedAccessor.getNbLines().get() ) {
+        LOG_WARNING << "Lines out of bound asked for";
+        return {};
+    }
+
+    const auto begin
+        = ( first == 0_lnum ) ? 0 : scopedAccessor.getEndOfLineOffset( first - 1_lcount ).get();
+    const auto end = scopedAccessor.getEndOfLineOffset( first + number - 1_lcount ).get();
+    return { begin, end };
+}
+
 void LogData::attachFile( const QString& fileName )
 {
     LOG_DEBUG << "LogData::attachFile " << fileName.toStdString();
@@ -131,6 +168,115 @@ qint64 LogData::getFileSize() const
     return IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize();
 }
 
+IndexedHash LogData::getIndexedHash() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getHash();
+}
+
+bool LogData::hasContentPrefix( const IndexedHash& hash ) const
+{
+    if ( hash.size > getFileSize() ) {
+        return false;
+    }
+
+    QFile file( indexingFileName_ );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    // Same check as fast modification detection does
+    const auto getDigest = [ &file ]( qint64 offset, qint64 size ) -> std::optional<quint64> {
+        if ( !file.seek( offset ) ) {
+            return {};
+        }
+        const auto data = file.read( size );
+        if ( data.size() != size ) {
+            return {};
+        }
+        FileDigest digest;
+        digest.addData( data );
+        return digest.digest();
+    };
+
+    return getDigest( 0, hash.headerSize ) == hash.headerDigest
+           && getDigest( hash.tailOffset, hash.tailSize ) == hash.tailDigest;
+}
+
+QString LogData::getTimestampFormat() const
+{
+    const auto& timestamps = IndexingData::ConstAccessor{ indexing_data_.get() }.getTimestamps();
+    return timestamps.isMonotone() && !timestamps.isEmpty() ? timestamps.format() : QString{};
+}
+
+std::optional<int64_t> LogData::parseTimestamp( const QString& time,
+                                                OptionalLineNumber dateLine ) const
+{
+    const auto format = getTimestampFormat();
+    if ( format.isEmpty() ) {
+        return {};
+    }
+
+    auto fullTime = time.trimmed();
+
+    const auto timeStart = format.indexOf( QLatin1String( "HH" ) );
+    if ( dateLine && *dateLine < LineNumber( getNbLine().get() ) && timeStart > 0
+         && fullTime.size() <= format.size() - timeStart ) {
+        fullTime.prepend( getLineString( *dateLine ).left( timeStart ) );
+    }
+
+    // Day is typed without padding, "Oct 3" is read as "Oct 03"
+    const auto dayStart = format.indexOf( QLatin1String( "dd" ) );
+    if ( dayStart >= 0 && fullTime.size() > dayStart + 1 && fullTime.at( dayStart ).isDigit()
+         && !fullTime.at( dayStart + 1 ).isDigit() ) {
+        fullTime.insert( dayStart, QLatin1Char( '0' ) );
+    }
+
+    const auto utf8Time = fullTime.toUtf8();
+    return TimestampParser( format ).parse(
+        std::string_view( utf8Time.constData(), static_cast<size_t>( utf8Time.size() ) ) );
+}
+
+OptionalLineNumber LogData::getLineForTimestamp( int64_t timestamp ) const
+{
+    const auto format = getTimestampFormat();
+    if ( format.isEmpty() ) {
+        return {};
+    }
+
+    const auto nbLines = getNbLine();
+    const auto range = IndexingData::ConstAccessor{ indexing_data_.get() }
+                           .getTimestamps()
+                           .findRange( timestamp, nbLines );
+
+    // Index has one line in many, the rest of the range is parsed here.
+    // Lines without timestamp are continuations of the previous one.
+    const TimestampParser parser( format );
+    const auto chunkSize = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        Configuration::get().searchReadBufferSizeLines() ) );
+
+    auto chunkStart = range.first;
+    while ( chunkStart < range.second ) {
+        const auto chunkLines = std::min( chunkSize, range.second - chunkStart );
+        const auto rawLines = getLinesRaw( chunkStart, chunkLines );
+        const auto lines = rawLines.buildUtf8View();
+
+        for ( auto index = 0u; index < lines.size(); ++index ) {
+            const auto lineTimestamp = parser.parse( lines[ index ] );
+            if ( lineTimestamp && *lineTimestamp >= timestamp ) {
+                return chunkStart + LinesCount( static_cast<LinesCount::UnderlyingType>( index ) );
+            }
+        }
+
+        chunkStart = chunkStart + chunkLines;
+    }
+
+    if ( range.second.get() < nbLines.get() ) {
+        return range.second;
+    }
+
+    return {};
+}
+
 QDateTime LogData::getLastModifiedDate() const
 {
     return lastModifiedDate_;
@@ -142,6 +288,11 @@ std::unique_ptr<LogFilteredData> LogData::getNewFilteredData() const
     return std::make_unique<LogFilteredData>( this );
 }
 
+SearchCoordinator& LogData::searchCoordinator() const
+{
+    return *searchCoordinator_;
+}
+
 void LogData::reload( QTextCodec* forcedEncoding )
 {
     operationQueue_.interrupt();
@@ -145,6 +145,16 @@ void IndexingData::addAll( const klogg::vector<char>& block, LineLength length,
     encodingGuess_ = encoding;
 }
 
+const TimestampIndex& IndexingData::getTimestamps() const
+{
+    return timestamps_;
+}
+
+void IndexingData::addTimestamps( const TimestampIndex& timestamps )
+{
+    timestamps_.append( timestamps );
+}
+
 int IndexingData::getProgress() const
 {
     return progress_;
@@ -160,6 +170,7 @@ void IndexingData::clear()
     const auto& config = Configuration::get();
 
     maxLength_ = 0_length;
+    timestamps_.clear();
     hash_ = {};
     hashBuilder_.reset();
     if ( config.useCompressedIndex() ) {
@@ -178,7 +189,8 @@ void IndexingData::clear()
 size_t IndexingData::allocatedSize() const
 {
     return std::visit( []( const auto& linePosition ) { return linePosition.allocatedSize(); },
-                       linePosition_ );
+                       linePosition_ )
+           + timestamps_.allocatedSize();
 }
 
 LogDataWorker::LogDataWorker( const std::shared_ptr<IndexingData>& indexing_data )
@@ -280,6 +292,9 @@ OperationResult LogDataWorker::connectSignalsAndRun( IndexOperation* operationRe
     connect( operationRequested, &IndexOperation::fileCheckFinished, this,
              &LogDataWorker::onCheckFileFinished );
 
+    connect( operationRequested, &IndexOperation::indexingStatsCollected, this,
+             &LogDataWorker::indexingStatsCollected );
+
     auto result = operationRequested->run();
 
     operationRequested->disconnect( this );
@@ -428,7 +443,8 @@ findNextLineFeed( const klogg::vector<char>& block, int posWithinBlock, const In
 
 FastLinePositionArray IndexOperation::parseDataBlock( OffsetInFile::UnderlyingType blockBeginning,
                                                       const klogg::vector<char>& block,
-                                                      IndexingState& state ) const
+                                                      IndexingState& state,
+                                                      TimestampIndex& timestamps ) const
 {
     using namespace parse_data_block;
 
@@ -470,10 +486,22 @@ FastLinePositionArray IndexOperation::parseDataBlock( OffsetInFile::UnderlyingTy
         state.max_length = std::max( state.max_length, length );
 
         if ( !isEndOfBlock ) {
+            // Timestamps are only looked for in lines that start in this block
+            const auto lineNumber = LineNumber( state.line_number );
+            if ( state.encodingParams.lineFeedWidth == 1 && state.pos >= blockBeginning
+                 && state.timestampExtractor.isLineWanted( lineNumber ) ) {
+                const auto lineStart = static_cast<size_t>( state.pos - blockBeginning );
+                const auto lineSize = static_cast<size_t>( currentDataEnd - state.pos );
+                state.timestampExtractor.extract(
+                    lineNumber, std::string_view( block.data() + lineStart, lineSize ),
+                    timestamps );
+            }
+
             state.end = currentDataEnd;
             state.pos = state.end + state.encodingParams.lineFeedWidth;
             state.additional_spaces = 0;
             linePositions.append( OffsetInFile( state.pos ) );
+            ++state.line_number;
         }
     }
 
@@ -508,7 +536,8 @@ void IndexOperation::guessEncoding( const klogg::vector<char>& block,
 }
 
 std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
-                                                            BlockPrefetcher& blockPrefetcher )
+                                                            BlockPrefetcher& blockPrefetcher,
+                                                            IndexingStats& stats )
 {
     using namespace std::chrono;
     using clock = high_resolution_clock;
@@ -541,15 +570,19 @@ std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
 
         clock::time_point ioT2 = clock::now();
 
-        ioDuration += duration_cast<microseconds>( ioT2 - ioT1 );
+        const auto blockReadDuration = duration_cast<microseconds>( ioT2 - ioT1 );
+        ioDuration += blockReadDuration;
+        stats.blockRead.add( blockReadDuration );
 
         if ( sentBlocksCount % 10 == 0 ) {
             LOG_INFO << "Sending block " << blockData.first << " size " << blockData.second->size();
         }
 
+        ScopedDuration queueWait( stats.queueWait );
         while ( !blockPrefetcher.try_put( std::move( blockData ) ) && !interruptRequest_ ) {
             std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
         }
+        queueWait.stop();
         sentBlocksCount++;
     }
 
@@ -562,7 +595,8 @@ std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
     return ioDuration;
 }
 
-void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& blockData )
+void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& blockData,
+                                     IndexingStats& stats )
 {
     const auto& blockBeginning = blockData.first;
     const auto& block = *blockData.second;
@@ -573,12 +607,18 @@ void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& bloc
         return;
     }
 
+    ScopedDuration lockWait( stats.indexLock );
     IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    lockWait.stop();
 
     guessEncoding( block, scopedAccessor, state );
 
     if ( !block.empty() ) {
-        const auto linePositions = parseDataBlock( blockBeginning, block, state );
+        ScopedDuration blockParse( stats.blockParse );
+        TimestampIndex timestamps;
+        const auto linePositions = parseDataBlock( blockBeginning, block, state, timestamps );
+        blockParse.stop();
+
         auto maxLength = state.max_length;
         if ( maxLength > std::numeric_limits<LineLength::UnderlyingType>::max() ) {
             LOG_ERROR << "Too long lines " << maxLength;
@@ -588,6 +628,7 @@ void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& bloc
         scopedAccessor.addAll(
             block, LineLength( type_safe::narrow_cast<LineLength::UnderlyingType>( maxLength ) ),
             linePositions, state.encodingGuess );
+        scopedAccessor.addTimestamps( timestamps );
 
         // Update the caller for progress indication
         const auto progress
@@ -641,6 +682,29 @@ void IndexOperation::doIndex( OffsetInFile initialPosition )
         }
 
         state.encodingGuess = scopedAccessor.getEncodingGuess();
+
+        // Last line without LF is indexed again
+        state.line_number = scopedAccessor.getNbLines().get();
+        if ( state.line_number > 0
+             && scopedAccessor.getEndOfLineOffset( LineNumber( state.line_number - 1 ) )
+                    > initialPosition ) {
+            --state.line_number;
+        }
+
+        // Partial indexing keeps using the format detected before
+        const auto& timestamps = scopedAccessor.getTimestamps();
+        if ( !timestamps.isMonotone() ) {
+            state.timestampExtractor = {};
+        }
+        else if ( !timestamps.format().isEmpty() ) {
+            state.timestampExtractor = TimestampExtractor( TimestampParser( timestamps.format() ),
+                                                           LineNumber( state.line_number ) );
+        }
+        else {
+            state.timestampExtractor = TimestampExtractor(
+                Configuration::get().timestampFormats(), LineNumber( state.line_number ) );
+        }
+
         LOG_INFO << "Initial encoding "
                  << ( state.fileTextCodec != nullptr ? state.fileTextCodec->name().toStdString()
                                                      : std::string{ "auto" } );
@@ -657,13 +721,16 @@ void IndexOperation::doIndex( OffsetInFile initialPosition )
 
     const auto indexingStartTime = clock::now();
 
+    IndexingStats stats;
+    const auto firstIndexedLine = state.line_number;
+
     tbb::flow::graph indexingGraph;
     auto blockPrefetcher = tbb::flow::limiter_node<BlockData>( indexingGraph, prefetchBufferSize );
     auto blockQueue = tbb::flow::queue_node<BlockData>( indexingGraph );
 
     auto blockParser = tbb::flow::function_node<BlockData, tbb::flow::continue_msg>(
-        indexingGraph, tbb::flow::serial, [ this, &state ]( const BlockData& blockData ) {
-            indexNextBlock( state, blockData );
+        indexingGraph, tbb::flow::serial, [ this, &state, &stats ]( const BlockData& blockData ) {
+            indexNextBlock( state, blockData, stats );
             delete blockData.second;
             return tbb::flow::continue_msg{};
         } );
@@ -673,7 +740,7 @@ void IndexOperation::doIndex( OffsetInFile initialPosition )
     tbb::flow::make_edge( blockParser, blockPrefetcher.decrementer() );
 
     file.seek( state.pos );
-    ioDuration = readFileInBlocks( file, blockPrefetcher );
+    ioDuration = readFileInBlocks( file, blockPrefetcher, stats );
     indexingGraph.wait_for_all();
 
     IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
@@ -727,6 +794,11 @@ void IndexOperation::doIndex( OffsetInFile initialPosition )
              << " MiB/s";
     LOG_INFO << "Memory usage " << readableSize( usedMemory() );
 
+    stats.indexedBytes = state.file_size - initialPosition.get();
+    stats.indexedLines = LinesCount( state.line_number - firstIndexedLine );
+    stats.duration = duration;
+    Q_EMIT indexingStatsCollected( stats );
+
     if ( interruptRequest_ ) {
         scopedAccessor.clear();
     }
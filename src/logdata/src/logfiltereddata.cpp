@@ -48,7 +48,6 @@
 
 #include <cassert>
 #include <functional>
-#include <numeric>
 #include <tuple>
 #include <vector>
 
@@ -57,12 +56,54 @@
 
 #include "configuration.h"
 #include "readablesize.h"
+#include "searchresultscache.h"
 #include "synchronization.h"
 
+namespace {
+
+// Lines between two requested ones are read together with them if there
+// are no more of them, decoding a few lines is cheaper than another read
+constexpr LineNumber::UnderlyingType MaxSkippedLines = 32;
+
+// Limit of lines read with one request, so that sparse requested lines
+// do not make a run read many times more lines than they are
+constexpr LineNumber::UnderlyingType MaxRunLines = 4096;
+
+// Lines measured at once when looking for the longest of marked lines
+constexpr size_t MaxLengthBatchLines = 8192;
+
+// Calls function with [start, end) index ranges of sorted lineNumbers
+// that can be read with one request
+template <typename Function>
+void forEachLinesRun( const klogg::vector<LineNumber::UnderlyingType>& lineNumbers,
+                      Function function )
+{
+    auto runStart = size_t{ 0 };
+    while ( runStart < lineNumbers.size() ) {
+        auto runEnd = runStart + 1;
+        while ( runEnd < lineNumbers.size()
+                && lineNumbers[ runEnd ] - lineNumbers[ runEnd - 1 ] <= MaxSkippedLines + 1 ) {
+            const auto runLines = lineNumbers[ runEnd ] - lineNumbers[ runStart ] + 1;
+            const auto requestedLines = runEnd - runStart + 1;
+            if ( runLines > MaxRunLines || runLines > 2 * requestedLines + MaxSkippedLines ) {
+                break;
+            }
+            ++runEnd;
+        }
+
+        function( runStart, runEnd );
+        runStart = runEnd;
+    }
+}
+
+} // namespace
+
 // Usual constructor: just copy the data, the search is started by runSearch()
 LogFilteredData::LogFilteredData( const LogData* logData )
     : AbstractLogData()
-    , matching_lines_( SearchResultArray() )
+    , matching_lines_( std::make_shared<const IndexedSearchResults>() )
+    , marks_( matching_lines_ )
+    , marks_and_matches_( matching_lines_ )
     , currentRegExp_()
     , visibility_()
     , workerThread_( *logData )
@@ -75,10 +116,13 @@ LogFilteredData::LogFilteredData( const LogData* logData )
     sourceLogData_ = logData;
 
     visibility_ = VisibilityFlags::Marks | VisibilityFlags::Matches;
+    workerThread_.setMarks( marks_ );
 
     // Forward the update signal
     connect( &workerThread_, &LogFilteredDataWorker::searchProgressed, this,
              &LogFilteredData::handleSearchProgressed );
+    connect( &workerThread_, &LogFilteredDataWorker::searchStatsCollected, this,
+             &LogFilteredData::searchStatsCollected );
 
     searchProgressThrottler_.setTimeout( 100 );
     connect( this, &LogFilteredData::searchProgressedThrottled, &searchProgressThrottler_,
@@ -103,36 +147,47 @@ void LogFilteredData::runSearch( const RegularExpressionPattern& regExp, LineNum
 
     clearSearch();
     currentRegExp_ = regExp;
-    currentSearchKey_ = makeCacheKey( regExp, startLine, endLine );
+    const auto codecName = QString::fromLatin1( sourceLogData_->getDisplayEncoding()->name() );
+    currentSearchKey_ = SearchResultsCache::Key{ regExp,
+                                                 startLine,
+                                                 endLine,
+                                                 sourceLogData_->getIndexedHash(),
+                                                 codecName,
+                                                 sourceLogData_->getPrefilter() };
     LOG_INFO << "Search cache key: " << regExp.pattern << "_" << startLine.get() << "_"
-             << endLine.get();
-
-    bool shouldRunSearch = true;
-    if ( config.useSearchResultsCache() ) {
-        const auto cachedResults = searchResultsCache_.find( currentSearchKey_ );
-        if ( cachedResults != std::end( searchResultsCache_ ) ) {
-            LOG_INFO << "Got result from cache";
-            shouldRunSearch = false;
-            matching_lines_ = cachedResults->second.matching_lines;
-            maxLength_ = cachedResults->second.maxLength;
+             << endLine.get() << "_" << currentSearchKey_->fileHash.size;
 
-            marks_and_matches_ = matching_lines_ | marks_;
-
-            Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), 100, startLine );
-        }
-    }
+    attachReader();
 
-    if ( shouldRunSearch ) {
-        attachReader();
+    if ( !config.useSearchResultsCache() ) {
         workerThread_.search( currentRegExp_, startLine, endLine );
+        return;
     }
+
+    workerThread_.search(
+        currentRegExp_, startLine, endLine,
+        [ key = *currentSearchKey_, sourceLogData = sourceLogData_ ]() {
+            const auto cachedResults = SearchResultsCache::get().find(
+                key, [ &sourceLogData ]( const IndexedHash& hash ) {
+                    return sourceLogData->hasContentPrefix( hash );
+                } );
+
+            if ( !cachedResults ) {
+                return std::optional<SearchResults>{};
+            }
+
+            const auto matches
+                = std::make_shared<const IndexedSearchResults>( cachedResults->matchingLines );
+            return std::make_optional( SearchResults{ matches, {}, {}, cachedResults->maxLength,
+                                                      cachedResults->processedLines } );
+        } );
 }
 
 void LogFilteredData::updateSearch( LineNumber startLine, LineNumber endLine )
 {
     LOG_DEBUG << "Entering updateSearch";
 
-    currentSearchKey_ = {};
+    currentSearchKey_.reset();
 
     attachReader();
     workerThread_.updateSearch( currentRegExp_, startLine, endLine,
@@ -151,13 +206,15 @@ void LogFilteredData::clearSearch( bool dropCache )
     interruptSearch();
 
     currentRegExp_ = {};
-    matching_lines_ = {};
-    marks_and_matches_ = marks_;
+    store( matching_lines_, std::make_shared<const IndexedSearchResults>() );
+    store( marks_and_matches_, load( marks_ ) );
     maxLength_ = 0_length;
     nbLinesProcessed_ = 0_lcount;
 
+    // Cached results are bound to the file content,
+    // so results of changed file are not found anymore
     if ( dropCache ) {
-        searchResultsCache_.clear();
+        currentSearchKey_.reset();
     }
 }
 
@@ -174,7 +231,7 @@ LineNumber LogFilteredData::getLineIndexNumber( LineNumber lineNumber ) const
 // Scan the list for the 'lineNumber' passed
 bool LogFilteredData::isLineMatched( LineNumber lineNumber ) const
 {
-    return matching_lines_.contains( lineNumber.get() );
+    return load( matching_lines_ )->lines.contains( lineNumber.get() );
 }
 
 LinesCount LogFilteredData::getNbTotalLines() const
@@ -184,12 +241,27 @@ LinesCount LogFilteredData::getNbTotalLines() const
 
 LinesCount LogFilteredData::getNbMatches() const
 {
-    return LinesCount( matching_lines_.cardinality() );
+    return LinesCount( load( matching_lines_ )->cardinality() );
 }
 
 LinesCount LogFilteredData::getNbMarks() const
 {
-    return LinesCount( marks_.cardinality() );
+    return LinesCount( load( marks_ )->cardinality() );
+}
+
+SearchResultsSnapshot LogFilteredData::getMatchingLines() const
+{
+    return load( matching_lines_ );
+}
+
+SearchResultsSnapshot LogFilteredData::getMarkedLines() const
+{
+    return load( marks_ );
+}
+
+SearchResultsSnapshot LogFilteredData::getMarkedAndMatchingLines() const
+{
+    return load( marks_and_matches_ );
 }
 
 LogFilteredData::LineType LogFilteredData::lineTypeByIndex( LineNumber index ) const
@@ -211,10 +283,23 @@ LogFilteredData::LineType LogFilteredData::lineTypeByLine( LineNumber lineNumber
 }
 
 void LogFilteredData::iterateOverLines( const std::function<void( LineNumber )>& callback ) const
+{
+    iterateOverLines( 0_lnum, callback );
+}
+
+void LogFilteredData::iterateOverLines( LineNumber firstIndex,
+                                        const std::function<void( LineNumber )>& callback ) const
 {
     using CallbackFn = std::function<void( LineNumber )>;
-    const auto& currentResults = currentResultArray();
-    currentResults.iterate(
+    const auto results = currentResults();
+
+    LineNumber::UnderlyingType firstLine = {};
+    if ( !results->select( firstIndex.get(), &firstLine ) ) {
+        return;
+    }
+
+    results->lines.iterateFrom(
+        firstLine,
         []( uint64_t line, void* context ) -> bool {
             auto* callbackFn = static_cast<CallbackFn*>( context );
             callbackFn->operator()( LineNumber( line ) );
@@ -228,11 +313,14 @@ void LogFilteredData::iterateOverLines( const std::function<void( LineNumber )>&
 void LogFilteredData::toggleMark( LineNumber line )
 {
     if ( ( line >= 0_lnum ) && line < sourceLogData_->getNbLine() ) {
-        if ( !marks_.addChecked( line.get() ) ) {
-            marks_.remove( line.get() );
+        auto marks = marks_->lines;
+        if ( !marks.addChecked( line.get() ) ) {
+            marks.remove( line.get() );
+            setMarks( std::move( marks ) );
             updateMaxLengthMarks( {}, line );
         }
         else {
+            setMarks( std::move( marks ) );
             updateMaxLengthMarks( line, {} );
         }
     }
@@ -244,7 +332,9 @@ void LogFilteredData::toggleMark( LineNumber line )
 void LogFilteredData::addMark( LineNumber line )
 {
     if ( ( line >= 0_lnum ) && line < sourceLogData_->getNbLine() ) {
-        marks_.add( line.get() );
+        auto marks = marks_->lines;
+        marks.add( line.get() );
+        setMarks( std::move( marks ) );
         updateMaxLengthMarks( line, {} );
     }
     else {
@@ -254,15 +344,16 @@ void LogFilteredData::addMark( LineNumber line )
 
 bool LogFilteredData::isLineMarked( LineNumber line ) const
 {
-    return marks_.contains( line.get() );
+    return load( marks_ )->lines.contains( line.get() );
 }
 
 OptionalLineNumber LogFilteredData::getMarkAfter( LineNumber line ) const
 {
     OptionalLineNumber marked_line;
-    const LineNumber::UnderlyingType rank = marks_.rank( line.get() );
+    const auto marks = load( marks_ );
+    const LineNumber::UnderlyingType rank = marks->rank( line.get() );
     LineNumber::UnderlyingType nextMark;
-    if ( marks_.select( rank, &nextMark ) ) {
+    if ( marks->select( rank, &nextMark ) ) {
         marked_line = LineNumber( nextMark );
     }
 
@@ -273,14 +364,15 @@ OptionalLineNumber LogFilteredData::getMarkBefore( LineNumber line ) const
 {
     OptionalLineNumber marked_line;
 
-    const LineNumber::UnderlyingType rank = marks_.rank( line.get() );
+    const auto marks = load( marks_ );
+    const LineNumber::UnderlyingType rank = marks->rank( line.get() );
 
     if ( rank < 2 ) {
         return marked_line;
     }
 
     LineNumber::UnderlyingType nextMark;
-    if ( marks_.select( rank - 2, &nextMark ) ) {
+    if ( marks->select( rank - 2, &nextMark ) ) {
         marked_line = LineNumber( nextMark );
     }
 
@@ -289,15 +381,152 @@ OptionalLineNumber LogFilteredData::getMarkBefore( LineNumber line ) const
 
 void LogFilteredData::deleteMark( LineNumber line )
 {
-    marks_.remove( line.get() );
+    auto marks = marks_->lines;
+    marks.remove( line.get() );
+    setMarks( std::move( marks ) );
     updateMaxLengthMarks( {}, line );
 }
 
+void LogFilteredData::addMarks( const SearchResultArray& lines )
+{
+    auto added = linesInFile( lines );
+    added -= marks_->lines;
+    changeMarks( added, {} );
+}
+
+void LogFilteredData::removeMarks( const SearchResultArray& lines )
+{
+    auto removed = lines;
+    removed &= marks_->lines;
+    changeMarks( {}, std::move( removed ) );
+}
+
+void LogFilteredData::toggleMarks( const SearchResultArray& lines )
+{
+    auto added = linesInFile( lines );
+    auto removed = added;
+    added -= marks_->lines;
+    removed &= marks_->lines;
+    changeMarks( added, std::move( removed ) );
+}
+
+void LogFilteredData::changeMarks( const SearchResultArray& added, SearchResultArray removed )
+{
+    if ( added.isEmpty() && removed.isEmpty() ) {
+        return;
+    }
+
+    auto marks = marks_->lines;
+    marks |= added;
+    marks -= removed;
+
+    // When removing more marks than are left measuring what is left
+    // is cheaper than checking whether the longest one was removed
+    if ( !removed.isEmpty()
+         && ( removed.cardinality() >= marks.cardinality()
+              || maxLineLength( removed ) >= maxLengthMarks_ ) ) {
+        LOG_DEBUG << "changeMarks recalculating longest mark";
+        maxLengthMarks_ = maxLineLength( marks );
+    }
+    else {
+        maxLengthMarks_ = qMax( maxLengthMarks_, maxLineLength( added ) );
+    }
+
+    // Only removed lines that do not match leave the union
+    auto marksAndMatches = marks_and_matches_->lines;
+    marksAndMatches |= added;
+    removed -= matching_lines_->lines;
+    marksAndMatches -= removed;
+
+    setMarks( std::move( marks ), std::move( marksAndMatches ) );
+}
+
+SearchResultArray LogFilteredData::linesInFile( const SearchResultArray& lines ) const
+{
+    const auto nbLines = sourceLogData_->getNbLine();
+    if ( lines.isEmpty() || lines.maximum() < nbLines.get() ) {
+        return lines;
+    }
+
+    LOG_ERROR << "LogFilteredData trying to change marks outside of the file.";
+    SearchResultArray fileLines;
+    fileLines.addRange( 0, nbLines.get() );
+    fileLines &= lines;
+    return fileLines;
+}
+
+LineLength LogFilteredData::maxLineLength( const SearchResultArray& lines ) const
+{
+    struct Batch {
+        klogg::vector<LineNumber::UnderlyingType> lines;
+        size_t limit;
+    } batch;
+    batch.lines.reserve( MaxLengthBatchLines );
+    batch.limit = MaxLengthBatchLines;
+
+    auto maxLength = 0_length;
+    auto from = LineNumber::UnderlyingType{};
+    auto hasMoreLines = !lines.isEmpty();
+    while ( hasMoreLines ) {
+        batch.lines.clear();
+        lines.iterateFrom(
+            from,
+            []( uint64_t line, void* context ) -> bool {
+                auto* batch = static_cast<Batch*>( context );
+                batch->lines.push_back( line );
+                return batch->lines.size() < batch->limit;
+            },
+            static_cast<void*>( &batch ) );
+
+        const auto& lineNumbers = batch.lines;
+        forEachLinesRun( lineNumbers, [ & ]( size_t runStart, size_t runEnd ) {
+            const auto runFirstLine = lineNumbers[ runStart ];
+            const auto runLinesCount = LinesCount( lineNumbers[ runEnd - 1 ] - runFirstLine + 1 );
+            const auto runLines
+                = sourceLogData_->getExpandedLines( LineNumber( runFirstLine ), runLinesCount );
+
+            for ( auto index = runStart; index < runEnd; ++index ) {
+                const auto runIndex = lineNumbers[ index ] - runFirstLine;
+                if ( runIndex >= runLines.size() ) {
+                    break;
+                }
+
+                const auto& line = runLines[ runIndex ];
+                maxLength = qMax( maxLength, LineLength{ line.size() } );
+            }
+        } );
+
+        hasMoreLines = lineNumbers.size() == batch.limit;
+        if ( hasMoreLines ) {
+            from = lineNumbers.back() + 1;
+        }
+    }
+
+    return maxLength;
+}
+
+void LogFilteredData::setMarks( SearchResultArray marks )
+{
+    auto marksAndMatches = matching_lines_->lines | marks;
+    setMarks( std::move( marks ), std::move( marksAndMatches ) );
+}
+
+void LogFilteredData::setMarks( SearchResultArray marks, SearchResultArray marksAndMatches )
+{
+    const SearchResultsSnapshot newMarks
+        = std::make_shared<const IndexedSearchResults>( std::move( marks ) );
+
+    store( marks_, newMarks );
+    store( marks_and_matches_,
+           std::make_shared<const IndexedSearchResults>( std::move( marksAndMatches ) ) );
+
+    // Running search publishes its results merged with the new marks
+    workerThread_.setMarks( newMarks );
+}
+
 void LogFilteredData::updateMaxLengthMarks( OptionalLineNumber added_line,
                                             OptionalLineNumber removed_line )
 {
-    marks_and_matches_ = matching_lines_ | marks_;
-
     if ( added_line.has_value() ) {
         maxLengthMarks_ = qMax( maxLengthMarks_, sourceLogData_->getLineLength( *added_line ) );
     }
@@ -307,7 +536,7 @@ void LogFilteredData::updateMaxLengthMarks( OptionalLineNumber added_line,
          && sourceLogData_->getLineLength( *removed_line ) >= maxLengthMarks_ ) {
         LOG_DEBUG << "deleteMark recalculating longest mark";
         maxLengthMarks_ = 0_length;
-        marks_.iterate(
+        marks_->lines.iterate(
             []( uint64_t line, void* context ) -> bool {
                 auto* self = static_cast<LogFilteredData*>( context );
                 self->maxLengthMarks_
@@ -321,14 +550,14 @@ void LogFilteredData::updateMaxLengthMarks( OptionalLineNumber added_line,
 
 void LogFilteredData::clearMarks()
 {
-    marks_ = {};
+    setMarks( {} );
     maxLengthMarks_ = 0_length;
 }
 
 QList<LineNumber> LogFilteredData::getMarks() const
 {
     QList<LineNumber> markedLines;
-    marks_.iterate(
+    load( marks_ )->lines.iterate(
         []( uint64_t line, void* context ) -> bool {
             static_cast<QList<LineNumber>*>( context )->append( LineNumber( line ) );
             return true;
@@ -351,44 +580,25 @@ LogFilteredData::Visibility LogFilteredData::visibility() const
 void LogFilteredData::updateSearchResultsCache()
 {
     const auto& config = Configuration::get();
-    if ( !config.useSearchResultsCache() ) {
+    if ( !config.useSearchResultsCache() || !currentSearchKey_ ) {
         return;
     }
 
-    if ( currentSearchKey_ == SearchCacheKey{} ) {
-        return;
-    }
-
-    const uint64_t maxCacheLines = config.searchResultsCacheLines();
-
-    if ( matching_lines_.cardinality() > maxCacheLines ) {
+    if ( matching_lines_->cardinality() > config.searchResultsCacheLines() ) {
         LOG_DEBUG << "LogFilteredData: too many matches to place in cache";
+        return;
     }
-    else {
-        LOG_INFO << "LogFilteredData: caching results for key "
-                 << std::get<0>( currentSearchKey_ ).pattern << "_"
-                 << std::get<1>( currentSearchKey_ ) << "_" << std::get<2>( currentSearchKey_ );
-
-        searchResultsCache_[ currentSearchKey_ ] = { matching_lines_, maxLength_ };
-        auto cacheSize = std::accumulate( searchResultsCache_.cbegin(), searchResultsCache_.cend(),
-                                          uint64_t{ 0 }, []( const auto& acc, const auto& next ) {
-                                              return acc + next.second.matching_lines.cardinality();
-                                          } );
-
-        LOG_INFO << "LogFilteredData: cache size " << cacheSize;
 
-        auto cachedResult = std::begin( searchResultsCache_ );
-        while ( cachedResult != std::end( searchResultsCache_ ) && cacheSize > maxCacheLines ) {
-
-            if ( cachedResult->first == currentSearchKey_ ) {
-                ++cachedResult;
-                continue;
-            }
+    LOG_INFO << "LogFilteredData: caching results for key " << currentSearchKey_->pattern.pattern
+             << "_" << currentSearchKey_->startLine << "_" << currentSearchKey_->endLine;
 
-            cacheSize -= cachedResult->second.matching_lines.cardinality();
-            cachedResult = searchResultsCache_.erase( cachedResult );
-        }
-    }
+    // Results are written to disk in the worker thread
+    workerThread_.runInBackground( [ key = *currentSearchKey_, matches = load( matching_lines_ ),
+                                     maxLength = maxLength_, processedLines = nbLinesProcessed_,
+                                     fileLines = getNbTotalLines() ] {
+        SearchResultsCache::get().insert( key, { matches->lines, maxLength, processedLines },
+                                          fileLines );
+    } );
 }
 
 //
@@ -399,16 +609,27 @@ void LogFilteredData::handleSearchProgressed( LinesCount nbMatches, int progress
 {
     assert( nbMatches >= 0_lcount );
 
+    // Results are merged and indexed by the worker,
+    // here only the published snapshots are swapped in
     const auto searchResults = workerThread_.getSearchResults();
+    if ( searchResults.matches != matching_lines_ ) {
+        store( matching_lines_, searchResults.matches );
 
-    matching_lines_ |= searchResults.newMatches;
-    marks_and_matches_ |= searchResults.newMatches;
+        if ( searchResults.marks == marks_ ) {
+            store( marks_and_matches_, searchResults.marksAndMatches );
+        }
+        else {
+            // Marks have changed after the worker has published results
+            store( marks_and_matches_, std::make_shared<const IndexedSearchResults>(
+                                           matching_lines_->lines | marks_->lines ) );
+        }
+    }
 
     maxLength_ = searchResults.maxLength;
     nbLinesProcessed_ = searchResults.processedLines;
 
-    if ( progress == 100
-         && nbLinesProcessed_.get() == getExpectedSearchEnd( currentSearchKey_ ).get() ) {
+    if ( progress == 100 && currentSearchKey_
+         && nbLinesProcessed_.get() == currentSearchKey_->endLine.get() ) {
         updateSearchResultsCache();
     }
 
@@ -422,9 +643,11 @@ void LogFilteredData::handleSearchProgressed( LinesCount nbMatches, int progress
     if ( progress == 100 ) {
         detachReader();
 
-        LOG_INFO << "Matches size " << readableSize( matching_lines_.getSizeInBytes( false ) )
-                 << ", marks size " << readableSize( marks_.getSizeInBytes( false ) )
-                 << ", union size " << readableSize( marks_and_matches_.getSizeInBytes( false ) );
+        LOG_INFO << "Matches size "
+                 << readableSize( matching_lines_->lines.getSizeInBytes( false ) )
+                 << ", marks size " << readableSize( marks_->lines.getSizeInBytes( false ) )
+                 << ", union size "
+                 << readableSize( marks_and_matches_->lines.getSizeInBytes( false ) );
     }
 }
 
@@ -442,38 +665,48 @@ void LogFilteredData::handleSearchProgressedThrottled()
 
 LineNumber LogFilteredData::findLogDataLine( LineNumber index ) const
 {
-    const auto& currentResults = currentResultArray();
+    const auto results = currentResults();
 
     LineNumber::UnderlyingType line = {};
-    if ( currentResults.select( index.get(), &line ) ) {
+    if ( results->select( index.get(), &line ) ) {
         return LineNumber( line );
     }
     else {
-        if ( !currentResults.isEmpty() ) {
+        if ( results->cardinality() > 0 ) {
             LOG_ERROR << "Index too big in LogFilteredData: " << index << " cache size "
-                      << currentResults.cardinality();
+                      << results->cardinality();
         }
         return maxValue<LineNumber>();
     }
 }
 
-const SearchResultArray& LogFilteredData::currentResultArray() const
+SearchResultsSnapshot LogFilteredData::currentResults() const
 {
     if ( visibility_.testFlag( VisibilityFlags::Marks )
          && visibility_.testFlag( VisibilityFlags::Matches ) ) {
-        return marks_and_matches_;
+        return load( marks_and_matches_ );
     }
     else if ( visibility_.testFlag( VisibilityFlags::Matches ) ) {
-        return matching_lines_;
+        return load( matching_lines_ );
     }
     else {
-        return marks_;
+        return load( marks_ );
     }
 }
 
+SearchResultsSnapshot LogFilteredData::load( const SearchResultsSnapshot& results )
+{
+    return std::atomic_load( &results );
+}
+
+void LogFilteredData::store( SearchResultsSnapshot& target, SearchResultsSnapshot results )
+{
+    std::atomic_store( &target, std::move( results ) );
+}
+
 LineNumber LogFilteredData::findFilteredLine( LineNumber lineNum ) const
 {
-    LineNumber::UnderlyingType index = currentResultArray().rank( lineNum.get() );
+    LineNumber::UnderlyingType index = currentResults()->rank( lineNum.get() );
 
     if ( index > 0 ) {
         index--;
@@ -498,30 +731,74 @@ QString LogFilteredData::doGetExpandedLineString( LineNumber index ) const
 // Implementation of the virtual function.
 klogg::vector<QString> LogFilteredData::doGetLines( LineNumber first_line, LinesCount number ) const
 {
-    return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetLineString( line ); } );
+    return doGetLines( first_line, number, false );
 }
 
 // Implementation of the virtual function.
 klogg::vector<QString> LogFilteredData::doGetExpandedLines( LineNumber first_line,
                                                           LinesCount number ) const
 {
-    return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetExpandedLineString( line ); } );
+    return doGetLines( first_line, number, true );
+}
+
+klogg::vector<LineNumber::UnderlyingType>
+LogFilteredData::getMatchingLineNumbers( LineNumber first, LinesCount number ) const
+{
+    struct SourceLines {
+        klogg::vector<LineNumber::UnderlyingType> lines;
+        LinesCount::UnderlyingType limit;
+    } sourceLines;
+    sourceLines.lines.reserve( number.get() );
+    sourceLines.limit = number.get();
+
+    const auto results = currentResults();
+    LineNumber::UnderlyingType firstSourceLine = {};
+    if ( number.get() > 0 && results->select( first.get(), &firstSourceLine ) ) {
+        results->lines.iterateFrom(
+            firstSourceLine,
+            []( uint64_t line, void* context ) -> bool {
+                auto* sourceLines = static_cast<SourceLines*>( context );
+                sourceLines->lines.push_back( line );
+                return sourceLines->lines.size() < sourceLines->limit;
+            },
+            static_cast<void*>( &sourceLines ) );
+    }
+
+    if ( sourceLines.lines.size() < number.get() ) {
+        LOG_ERROR << "Lines out of range in LogFilteredData: " << first << " + " << number
+                  << ", cache size " << results->cardinality();
+    }
+
+    return std::move( sourceLines.lines );
 }
 
-klogg::vector<QString>
-LogFilteredData::doGetLines( LineNumber first_line, LinesCount number,
-                             const std::function<QString( LineNumber )>& lineGetter ) const
+klogg::vector<QString> LogFilteredData::doGetLines( LineNumber first_line, LinesCount number,
+                                                    bool expandTabs ) const
 {
-    klogg::vector<LineNumber::UnderlyingType> lineNumbers( number.get() );
-    std::iota( lineNumbers.begin(), lineNumbers.end(), first_line.get() );
+    const auto lineNumbers = getMatchingLineNumbers( first_line, number );
+
+    klogg::vector<QString> lines;
+    lines.reserve( number.get() );
 
-    klogg::vector<QString> lines( number.get() );
-    std::transform(
-        lineNumbers.cbegin(), lineNumbers.cend(), lines.begin(),
-        [ &lineGetter ]( const auto& line ) { return lineGetter( LineNumber( line ) ); } );
+    forEachLinesRun( lineNumbers, [ & ]( size_t runStart, size_t runEnd ) {
+        const auto runFirstLine = lineNumbers[ runStart ];
+        const auto runLinesCount = LinesCount( lineNumbers[ runEnd - 1 ] - runFirstLine + 1 );
+        auto runLines = sourceLogData_->getLines( LineNumber( runFirstLine ), runLinesCount );
+
+        for ( auto index = runStart; index < runEnd; ++index ) {
+            // Source lines are not read if the file was truncated since the search
+            const auto runIndex = lineNumbers[ index ] - runFirstLine;
+            if ( runIndex >= runLines.size() ) {
+                lines.emplace_back();
+                continue;
+            }
+
+            auto& line = runLines[ runIndex ];
+            lines.push_back( expandTabs ? untabify( std::move( line ) ) : std::move( line ) );
+        }
+    } );
 
+    lines.resize( number.get() );
     return lines;
 }
 
@@ -533,7 +810,7 @@ LineNumber LogFilteredData::doGetLineNumber(LineNumber index) const
 // Implementation of the virtual function.
 LinesCount LogFilteredData::doGetNbLine() const
 {
-    const LinesCount::UnderlyingType nbLines = currentResultArray().cardinality();
+    const LinesCount::UnderlyingType nbLines = currentResults()->cardinality();
     return LinesCount( nbLines );
 }
 
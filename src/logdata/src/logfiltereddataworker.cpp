@@ -39,6 +39,8 @@
 #include <chrono>
 #include <cmath>
 #include <exception>
+#include <functional>
+#include <optional>
 #include <qsemaphore.h>
 #include <utility>
 
@@ -58,6 +60,7 @@
 #include "regularexpression.h"
 
 #include "logfiltereddataworker.h"
+#include "searchcoordinator.h"
 #include "synchronization.h"
 
 namespace {
@@ -105,29 +108,93 @@ PartialSearchResults filterLines( const PatternMatcher& matcher, const LogData::
     results.processedLines = LinesCount{ rawLines.endOfLines.size() };
 
     const auto& lines = rawLines.buildUtf8View();
+    if ( lines.empty() ) {
+        return results;
+    }
 
-    for ( auto offset = 0u; offset < lines.size(); ++offset ) {
-        const auto& line = lines[ offset ];
+    // Lines are views into one buffer, so the whole chunk can be checked
+    // for required literals before running regex engine on each line.
+    const auto blockBegin = lines.front().data();
+    const auto blockEnd = lines.back().data() + lines.back().size();
+    const auto blockResult
+        = std::less<>{}( blockBegin, blockEnd )
+              ? matcher.precheckBlock(
+                  std::string_view( blockBegin, static_cast<size_t>( blockEnd - blockBegin ) ) )
+              : std::nullopt;
+
+    if ( blockResult.has_value() && !*blockResult ) {
+        LOG_DEBUG << "Chunk at " << chunkStart << " has no required literals";
+        return results;
+    }
 
-        const auto hasMatch = matcher.hasMatch( line );
+    SearchResultsBuilder matchingLines;
 
-        if ( hasMatch ) {
+    if ( blockResult.has_value() ) {
+        // Every line of the chunk matches
+        matchingLines.addRange( chunkStart, LinesCount{ lines.size() } );
+        for ( const auto& line : lines ) {
             results.maxLength = qMax( results.maxLength, getUntabifiedLength( line ) );
-            const auto lineNumber = chunkStart + LinesCount{ offset };
-            results.matchingLines.add( lineNumber.get() );
-
-            // LOG_INFO << "Match at " << lineNumber << ": " << line;
         }
     }
+    else {
+        for ( auto offset = 0u; offset < lines.size(); ++offset ) {
+            const auto& line = lines[ offset ];
+
+            if ( matcher.hasMatch( line ) ) {
+                results.maxLength = qMax( results.maxLength, getUntabifiedLength( line ) );
+                matchingLines.add( chunkStart + LinesCount{ offset } );
+            }
+        }
+    }
+
+    results.matchingLines = matchingLines.finish();
     return results;
 }
 
+// Applies matches changed since the previous publishing to the previously
+// published union of matches and marks. Only the part of the rank index
+// from the first changed line is rebuilt, usually the appended tail.
+SearchResultsSnapshot updateMarksAndMatches( const SearchResultsSnapshot& previous,
+                                             const SearchResultArray& marks,
+                                             const SearchResultArray& addedMatches,
+                                             const klogg::vector<uint64_t>& removedMatches )
+{
+    auto lines = previous->lines;
+    std::optional<uint64_t> firstChanged;
+
+    for ( const auto line : removedMatches ) {
+        if ( !marks.contains( line ) && lines.contains( line ) ) {
+            lines.remove( line );
+            firstChanged = firstChanged ? qMin( *firstChanged, line ) : line;
+        }
+    }
+
+    if ( !addedMatches.isEmpty() ) {
+        lines |= addedMatches;
+        firstChanged = firstChanged ? qMin( *firstChanged, addedMatches.minimum() )
+                                    : addedMatches.minimum();
+    }
+
+    if ( !firstChanged ) {
+        return previous;
+    }
+
+    auto index = previous->index;
+    index.rebuildFrom( lines, *firstChanged );
+    return std::make_shared<const IndexedSearchResults>( std::move( lines ), std::move( index ) );
+}
+
 } // namespace
 
-SearchResults SearchData::takeCurrentResults() const
+SearchData::SearchData()
 {
-    UniqueLock lock( dataMutex_ );
-    return SearchResults{ std::exchange( newMatches_, {} ), maxLength_, nbLinesProcessed_ };
+    clear();
+}
+
+SearchResults SearchData::currentResults() const
+{
+    SharedLock lock( dataMutex_ );
+    return published_;
 }
 
 void SearchData::addAll( LineLength length, const SearchResultArray& matches,
@@ -139,7 +206,100 @@ void SearchData::addAll( LineLength length, const SearchResultArray& matches,
     nbLinesProcessed_ = qMax( nbLinesProcessed_, processedLines );
     nbMatches_ += matchedLines;
 
-    newMatches_ |= matches;
+    if ( matches.isEmpty() ) {
+        return;
+    }
+
+    addedMatches_ |= matches;
+
+    // Chunks usually come in file order, then only the tail has to be indexed.
+    // Batches behind it, like the wrapped around part of a shared scan,
+    // are kept aside and indexed together when results are published.
+    if ( matches_.isEmpty() || matches.minimum() > matches_.maximum() ) {
+        matches_ |= matches;
+        matchesIndex_.extend( matches_ );
+    }
+    else {
+        pendingMatches_ |= matches;
+    }
+}
+
+void SearchData::mergePendingMatches()
+{
+    if ( pendingMatches_.isEmpty() ) {
+        return;
+    }
+
+    const auto firstChanged = pendingMatches_.minimum();
+    matches_ |= pendingMatches_;
+    pendingMatches_ = {};
+    matchesIndex_.rebuildFrom( matches_, firstChanged );
+}
+
+void SearchData::publishResults( bool isFinal )
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    SearchResults results;
+    SearchResultsSnapshot previousMarksAndMatches;
+    SearchResultArray addedMatches;
+    klogg::vector<uint64_t> removedMatches;
+    bool canUpdateMarksAndMatches = false;
+    {
+        UniqueLock lock( dataMutex_ );
+        if ( !isFinal && now - publishTime_ < PublishInterval ) {
+            return;
+        }
+
+        mergePendingMatches();
+
+        // Matches index is kept up to date by addAll,
+        // it is copied along with matches and not rebuilt
+        results.matches = std::make_shared<const IndexedSearchResults>( matches_, matchesIndex_ );
+        results.marks = marks_;
+        results.maxLength = maxLength_;
+        results.processedLines = nbLinesProcessed_;
+        publishTime_ = now;
+
+        previousMarksAndMatches = published_.marksAndMatches;
+        canUpdateMarksAndMatches = !isMarksAndMatchesOutdated_ && published_.marks == marks_;
+        addedMatches = std::exchange( addedMatches_, {} );
+        removedMatches = std::exchange( removedMatches_, {} );
+        isMarksAndMatchesOutdated_ = false;
+    }
+
+    if ( results.marks->lines.isEmpty() ) {
+        results.marksAndMatches = results.matches;
+    }
+    else if ( canUpdateMarksAndMatches ) {
+        results.marksAndMatches = updateMarksAndMatches(
+            previousMarksAndMatches, results.marks->lines, addedMatches, removedMatches );
+    }
+    else {
+        auto marksAndMatches = results.matches->lines | results.marks->lines;
+        marksAndMatches.runOptimize();
+        results.marksAndMatches
+            = std::make_shared<const IndexedSearchResults>( std::move( marksAndMatches ) );
+    }
+
+    UniqueLock lock( dataMutex_ );
+    published_ = std::move( results );
+}
+
+void SearchData::optimizeResults()
+{
+    UniqueLock lock( dataMutex_ );
+    mergePendingMatches();
+
+    // Merging chunks may turn runs into bitset containers
+    matches_.runOptimize();
+    isMarksAndMatchesOutdated_ = true;
+}
+
+void SearchData::setMarks( SearchResultsSnapshot marks )
+{
+    UniqueLock lock( dataMutex_ );
+    marks_ = std::move( marks );
 }
 
 LinesCount SearchData::getNbMatches() const
@@ -157,7 +317,28 @@ LineNumber SearchData::getLastProcessedLine() const
 void SearchData::deleteMatch( LineNumber line )
 {
     UniqueLock lock( dataMutex_ );
+    mergePendingMatches();
+    if ( !matches_.contains( line.get() ) ) {
+        return;
+    }
+
+    const auto isLast = line.get() == matches_.maximum();
     matches_.remove( line.get() );
+    nbMatches_ = LinesCount( nbMatches_.get() - 1 );
+
+    if ( addedMatches_.contains( line.get() ) ) {
+        addedMatches_.remove( line.get() );
+    }
+    else {
+        removedMatches_.push_back( line.get() );
+    }
+
+    if ( isLast ) {
+        matchesIndex_.removeLast( matches_ );
+    }
+    else {
+        matchesIndex_.rebuildFrom( matches_, line.get() );
+    }
 }
 
 void SearchData::clear()
@@ -168,7 +349,46 @@ void SearchData::clear()
     nbLinesProcessed_ = LinesCount( 0 );
     nbMatches_ = LinesCount( 0 );
     matches_ = {};
-    newMatches_ = {};
+    matchesIndex_.clear();
+    pendingMatches_ = {};
+    addedMatches_ = {};
+    removedMatches_.clear();
+    isMarksAndMatchesOutdated_ = false;
+
+    if ( !marks_ ) {
+        marks_ = std::make_shared<const IndexedSearchResults>();
+    }
+
+    const auto emptyMatches = std::make_shared<const IndexedSearchResults>();
+    published_ = SearchResults{ emptyMatches, marks_, marks_, LineLength( 0 ), LinesCount( 0 ) };
+    publishTime_ = {};
+}
+
+const SearchSession::MatcherList&
+SearchSession::matchers( const RegularExpressionPattern& pattern, size_t matchersCount )
+{
+    // Matchers use the engine selected when they were created
+    const auto engine = Configuration::get().regexpEngine();
+    if ( !pattern_ || !( *pattern_ == pattern ) || engine_ != engine ) {
+        LOG_INFO << "Creating matchers for new search pattern";
+        matchers_.clear();
+        expression_ = std::make_unique<RegularExpression>( pattern );
+        pattern_ = pattern;
+        engine_ = engine;
+    }
+
+    while ( matchers_.size() < matchersCount ) {
+        matchers_.push_back( expression_->createMatcher() );
+    }
+
+    return matchers_;
+}
+
+void SearchSession::reset()
+{
+    matchers_.clear();
+    expression_.reset();
+    pattern_.reset();
 }
 
 LogFilteredDataWorker::LogFilteredDataWorker( const LogData& sourceLogData )
@@ -183,6 +403,7 @@ LogFilteredDataWorker::~LogFilteredDataWorker() noexcept
         interruptRequested_.set();
         ScopedLock locker( operationsMutex_ );
         operationsPool_.waitForDone();
+        waitForCoordinatedSearch();
         LOG_INFO << "LogFilteredDataWorker shutdown";
     } catch ( const std::exception& e ) {
         LOG_ERROR << "Failed to destroy LogFilteredDataWorker: " << e.what();
@@ -193,6 +414,8 @@ void LogFilteredDataWorker::connectSignalsAndRun( SearchOperation* operationRequ
 {
     connect( operationRequested, &SearchOperation::searchProgressed, this,
              &LogFilteredDataWorker::searchProgressed );
+    connect( operationRequested, &SearchOperation::searchStatsCollected, this,
+             &LogFilteredDataWorker::searchStatsCollected, Qt::QueuedConnection );
     connect( operationRequested, &SearchOperation::searchFinished, this,
              &LogFilteredDataWorker::searchFinished, Qt::QueuedConnection );
 
@@ -201,30 +424,65 @@ void LogFilteredDataWorker::connectSignalsAndRun( SearchOperation* operationRequ
 }
 
 void LogFilteredDataWorker::search( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                    LineNumber endLine )
+                                    LineNumber endLine, PreviousResultsLookup previousResults )
 {
     ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
     operationsPool_.waitForDone();
+    waitForCoordinatedSearch();
     interruptRequested_.clear();
 
     LOG_INFO << "Search requested";
+
+    if ( !previousResults ) {
+        submitSearch( regExp, startLine, endLine );
+        return;
+    }
+
+    // Looking up previous results reads files, so it is done here
+    // and not in the thread that requested the search
     QSemaphore operationStarted;
-    operationsPool_.start( createRunnable( [ this, &operationStarted, regExp, startLine, endLine ] {
-        operationStarted.release();
-        ScopedLock operationLock( operationsMutex_ );
-        auto operationRequested = std::make_unique<FullSearchOperation>(
-            sourceLogData_, interruptRequested_, regExp, startLine, endLine );
-        connectSignalsAndRun( operationRequested.get() );
-    } ) );
+    operationsPool_.start( createRunnable(
+        [ this, &operationStarted, regExp, startLine, endLine,
+          lookup = std::move( previousResults ) ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+
+            const auto results = lookup();
+            if ( interruptRequested_ ) {
+                return;
+            }
+
+            if ( results ) {
+                resumeSearch( regExp, startLine, endLine, *results );
+            }
+            else {
+                submitSearch( regExp, startLine, endLine );
+            }
+        } ) );
+
     operationStarted.acquire();
 }
 
+void LogFilteredDataWorker::submitSearch( const RegularExpressionPattern& regExp,
+                                          LineNumber startLine, LineNumber endLine )
+{
+    // Full searches of all views of the file share one scan
+    coordinatedSearch_ = sourceLogData_.searchCoordinator().submit( SearchCoordinator::Request{
+        regExp, startLine, endLine, &searchData_, &interruptRequested_,
+        [ this ]( LinesCount nbMatches, int percent, LineNumber initialLine ) {
+            Q_EMIT searchProgressed( nbMatches, percent, initialLine );
+        },
+        [ this ]( const SearchStats& stats ) { Q_EMIT searchStatsCollected( stats ); },
+        [ this ] { Q_EMIT searchFinished(); } } );
+}
+
 void LogFilteredDataWorker::updateSearch( const RegularExpressionPattern& regExp,
                                           LineNumber startLine, LineNumber endLine,
                                           LineNumber position )
 {
     ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
     operationsPool_.waitForDone();
+    waitForCoordinatedSearch();
     interruptRequested_.clear();
 
     LOG_INFO << "Search update requested from " << position.get();
@@ -235,23 +493,60 @@ void LogFilteredDataWorker::updateSearch( const RegularExpressionPattern& regExp
             operationStarted.release();
             ScopedLock operationLock( operationsMutex_ );
             auto operationRequested = std::make_unique<UpdateSearchOperation>(
-                sourceLogData_, interruptRequested_, regExp, startLine, endLine, position );
+                sourceLogData_, interruptRequested_, searchSession_, regExp, startLine, endLine,
+                position );
             connectSignalsAndRun( operationRequested.get() );
         } ) );
 
     operationStarted.acquire();
 }
 
+void LogFilteredDataWorker::resumeSearch( const RegularExpressionPattern& regExp,
+                                          LineNumber startLine, LineNumber endLine,
+                                          const SearchResults& previousResults )
+{
+    searchData_.clear();
+    searchData_.addAll( previousResults.maxLength, previousResults.matches->lines,
+                        LinesCount( previousResults.matches->cardinality() ),
+                        previousResults.processedLines );
+    searchData_.publishResults( true );
+
+    // Lines appended since the results were found are searched here.
+    // If there are none, only the last line is searched again, that also
+    // reports the restored results and lets follow mode updates continue.
+    auto operationRequested = std::make_unique<UpdateSearchOperation>(
+        sourceLogData_, interruptRequested_, searchSession_, regExp, startLine, endLine,
+        LineNumber( previousResults.processedLines.get() ) );
+    connectSignalsAndRun( operationRequested.get() );
+}
+
+void LogFilteredDataWorker::runInBackground( std::function<void()> task )
+{
+    operationsPool_.start( createRunnable( std::move( task ) ) );
+}
+
+void LogFilteredDataWorker::waitForCoordinatedSearch()
+{
+    if ( coordinatedSearch_.valid() ) {
+        coordinatedSearch_.wait();
+        coordinatedSearch_ = {};
+    }
+}
+
 void LogFilteredDataWorker::interrupt()
 {
     LOG_INFO << "Search interruption requested";
     interruptRequested_.set();
 }
 
-// This will do an atomic copy of the object
 SearchResults LogFilteredDataWorker::getSearchResults() const
 {
-    return searchData_.takeCurrentResults();
+    return searchData_.currentResults();
+}
+
+void LogFilteredDataWorker::setMarks( SearchResultsSnapshot marks )
+{
+    searchData_.setMarks( std::move( marks ) );
 }
 
 //
@@ -259,10 +554,11 @@ SearchResults LogFilteredDataWorker::getSearchResults() const
 //
 
 SearchOperation::SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                                  const RegularExpressionPattern& regExp, LineNumber startLine,
-                                  LineNumber endLine )
+                                  SearchSession& session, const RegularExpressionPattern& regExp,
+                                  LineNumber startLine, LineNumber endLine )
 
     : interruptRequested_( interruptRequested )
+    , session_( session )
     , regexp_( regExp )
     , sourceLogData_( sourceLogData )
     , startLine_( startLine )
@@ -290,10 +586,6 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                                                       : configuredThreadPoolSize );
     }() );
 
-    LOG_INFO << "Using " << matchingThreadsCount << " matching threads";
-
-    tbb::flow::graph searchGraph;
-
     if ( initialLine < startLine_ ) {
         initialLine = startLine_;
     }
@@ -302,6 +594,22 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
     const auto nbLinesInChunk = LinesCount(
         static_cast<LinesCount::UnderlyingType>( config.searchReadBufferSizeLines() ) );
 
+    const auto& matchers = session_.matchers( regexp_, matchingThreadsCount );
+
+    // Small appends in follow mode are faster to match right here than
+    // to spread over matching threads.
+    if ( initialLine >= endLine || endLine - initialLine <= nbLinesInChunk ) {
+        doSearchInline( searchData, *matchers.front(), initialLine, endLine );
+        return;
+    }
+
+    LOG_INFO << "Using " << matchingThreadsCount << " matching threads";
+
+    SearchStats stats;
+    stats.threadMatch.resize( matchingThreadsCount );
+
+    tbb::flow::graph searchGraph;
+
     std::chrono::microseconds fileReadingDuration{ 0 };
 
     using BlockDataType = SearchBlockData*;
@@ -313,17 +621,17 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
     using RegexMatcherNode
         = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>;
 
-    using PatternMatcherPtr = std::unique_ptr<PatternMatcher>;
+    using PatternMatcherPtr = const PatternMatcher*;
     using MatcherContext = std::tuple<PatternMatcherPtr, microseconds, RegexMatcherNode>;
 
     klogg::vector<MatcherContext> regexMatchers;
     regexMatchers.reserve( matchingThreadsCount );
-    RegularExpression regularExpression{ regexp_ };
     for ( auto index = 0u; index < matchingThreadsCount; ++index ) {
         regexMatchers.emplace_back(
-            regularExpression.createMatcher(), microseconds{ 0 },
+            matchers[ index ].get(), microseconds{ 0 },
             RegexMatcherNode(
-                searchGraph, 1, [ &regexMatchers, index, this ]( const BlockDataType& blockData ) {
+                searchGraph, 1,
+                [ &regexMatchers, &stats, index, this ]( const BlockDataType& blockData ) {
                     if ( interruptRequested_ ) {
                         LOG_INFO << "Matcher " << index << " interrupted";
                         auto results = std::make_shared<PartialSearchResults>();
@@ -341,9 +649,10 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
 
                     const auto matchEndTime = high_resolution_clock::now();
 
-                    microseconds& matchDuration
-                        = std::get<microseconds>( regexMatchers.at( index ) );
-                    matchDuration += duration_cast<microseconds>( matchEndTime - matchStartTime );
+                    const auto blockMatchDuration
+                        = duration_cast<microseconds>( matchEndTime - matchStartTime );
+                    std::get<microseconds>( regexMatchers.at( index ) ) += blockMatchDuration;
+                    stats.threadMatch[ index ].add( blockMatchDuration );
                     LOG_DEBUG << "Searcher " << index << " block " << blockData->chunkStart
                               << " sending matches "
                               << blockData->searchResults.matchingLines.cardinality();
@@ -388,8 +697,10 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
 
                     // After each block, copy the data to shared data
                     // and update the client
+                    ScopedDuration resultsLock( stats.resultsLock );
                     searchData.addAll( maxLength, matchResults.matchingLines, matchesCount,
                                        processedLines );
+                    resultsLock.stop();
 
                     LOG_DEBUG << "done Searching chunk starting at " << matchResults.chunkStart
                               << ", " << matchResults.processedLines << " lines read.";
@@ -405,6 +716,7 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
 
                 if ( percentage > reportedPercentage || nbMatches > reportedMatches ) {
 
+                    searchData.publishResults( false );
                     Q_EMIT searchProgressed( nbMatches, std::min( 99, percentage ), initialLine );
 
                     reportedPercentage = percentage;
@@ -436,11 +748,13 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
         /*LOG_DEBUG << "Sending chunk starting at " << chunkStart << ", " <<
             lines.second.size()
                 << " lines read.";*/
+        stats.searchedBytes += klogg::ssize( lines.buffer );
         BlockDataType blockData = new SearchBlockData{ chunkStart, std::move( lines ) };
 
         const auto lineSourceEndTime = high_resolution_clock::now();
         const auto chunkReadTime
             = duration_cast<microseconds>( lineSourceEndTime - lineSourceStartTime );
+        stats.blockRead.add( chunkReadTime );
 
         /*LOG_DEBUG << "Sent chunk starting at " << chunkStart << ", " <<
         blockData->lines.second.size()
@@ -451,6 +765,7 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
         chunkStart = chunkStart + nbLinesInChunk;
         fileReadingDuration += chunkReadTime;
 
+        ScopedDuration queueWait( stats.queueWait );
         while ( !blockPrefetcher.try_put( blockData ) && !interruptRequested_ ) {
             std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
         }
@@ -483,25 +798,60 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                     / ( 1024 * 1024 )
              << " MiB/s";
 
+    stats.searchedLines = totalProcessedLines;
+    stats.nbMatches = nbMatches;
+    stats.duration = durationUs;
+    Q_EMIT searchStatsCollected( stats );
+
+    searchData.optimizeResults();
+    searchData.publishResults( true );
     Q_EMIT searchProgressed( nbMatches, 100, initialLine );
     Q_EMIT searchFinished();
 }
 
-// Called in the worker thread's context
-void FullSearchOperation::run( SearchData& searchData )
+void SearchOperation::doSearchInline( SearchData& searchData, const PatternMatcher& matcher,
+                                      LineNumber initialLine, LineNumber endLine )
 {
-    try {
-        // Clear the shared data
-        searchData.clear();
-        doSearch( searchData, 0_lnum );
-    } catch ( const std::exception& err ) {
-        const auto errorString = QString( "FullSearchOperation failed: %1" ).arg( err.what() );
-        LOG_ERROR << errorString;
-        dispatchToMainThread( [ errorString ]() {
-            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
-        } );
-        searchData.clear();
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    auto nbMatches = searchData.getNbMatches();
+    SearchStats stats;
+
+    if ( initialLine < endLine && !interruptRequested_ ) {
+        ScopedDuration blockRead( stats.blockRead );
+        const auto lines = sourceLogData_.getLinesRaw( initialLine, endLine - initialLine );
+        blockRead.stop();
+
+        const auto matchStartTime = high_resolution_clock::now();
+        const auto matchResults = filterLines( matcher, lines, initialLine );
+        stats.addThreadMatch(
+            0, duration_cast<microseconds>( high_resolution_clock::now() - matchStartTime ) );
+
+        const auto matchesCount = LinesCount( matchResults.matchingLines.cardinality() );
+        nbMatches += matchesCount;
+
+        ScopedDuration resultsLock( stats.resultsLock );
+        searchData.addAll(
+            matchResults.maxLength, matchResults.matchingLines, matchesCount,
+            LinesCount{ matchResults.chunkStart.get() + matchResults.processedLines.get() } );
+        resultsLock.stop();
+
+        stats.searchedLines = matchResults.processedLines;
+        stats.searchedBytes = klogg::ssize( lines.buffer );
     }
+
+    stats.nbMatches = nbMatches;
+    stats.duration = duration_cast<microseconds>( high_resolution_clock::now() - startTime );
+
+    LOG_DEBUG << "Searched lines " << initialLine << " to " << endLine << " in "
+              << stats.duration;
+
+    Q_EMIT searchStatsCollected( stats );
+
+    searchData.publishResults( true );
+    Q_EMIT searchProgressed( nbMatches, 100, initialLine );
+    Q_EMIT searchFinished();
 }
 
 // Called in the worker thread's context
@@ -526,5 +876,6 @@ void UpdateSearchOperation::run( SearchData& searchData )
             IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
         } );
         searchData.clear();
+        session_.reset();
     }
 }
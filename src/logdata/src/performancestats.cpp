@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "performancestats.h"
+
+#include <algorithm>
+
+#include <QJsonArray>
+
+namespace {
+
+size_t bucketIndex( std::chrono::microseconds duration )
+{
+    auto value = static_cast<uint64_t>( std::max( int64_t{ 0 }, duration.count() ) );
+    size_t index = 0;
+    while ( value > 0 && index + 1 < DurationHistogram::BucketsCount ) {
+        value >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+double perSecond( double value, std::chrono::microseconds duration )
+{
+    return duration.count() > 0 ? value * 1000.0 * 1000.0 / static_cast<double>( duration.count() )
+                                : 0.0;
+}
+
+double mibPerSecond( qint64 bytes, std::chrono::microseconds duration )
+{
+    return perSecond( static_cast<double>( bytes ), duration ) / ( 1024 * 1024 );
+}
+
+} // namespace
+
+void DurationHistogram::add( std::chrono::microseconds duration )
+{
+    buckets_[ bucketIndex( duration ) ]++;
+    min_ = count_ == 0 ? duration : std::min( min_, duration );
+    max_ = std::max( max_, duration );
+    total_ += duration;
+    count_++;
+}
+
+void DurationHistogram::merge( const DurationHistogram& other )
+{
+    if ( other.count_ == 0 ) {
+        return;
+    }
+
+    for ( auto index = 0u; index < BucketsCount; ++index ) {
+        buckets_[ index ] += other.buckets_[ index ];
+    }
+    min_ = count_ == 0 ? other.min_ : std::min( min_, other.min_ );
+    max_ = std::max( max_, other.max_ );
+    total_ += other.total_;
+    count_ += other.count_;
+}
+
+QJsonObject DurationHistogram::toJson() const
+{
+    QJsonArray buckets;
+    for ( auto index = 0u; index < BucketsCount; ++index ) {
+        if ( buckets_[ index ] > 0 ) {
+            buckets.append( QJsonObject{
+                { "below_us", static_cast<double>( uint64_t{ 1 } << index ) },
+                { "count", static_cast<double>( buckets_[ index ] ) } } );
+        }
+    }
+
+    return QJsonObject{ { "count", static_cast<double>( count_ ) },
+                        { "total_us", static_cast<double>( total_.count() ) },
+                        { "min_us", static_cast<double>( min_.count() ) },
+                        { "max_us", static_cast<double>( max_.count() ) },
+                        { "buckets", buckets } };
+}
+
+QJsonObject IndexingStats::toJson() const
+{
+    return QJsonObject{
+        { "bytes", static_cast<double>( indexedBytes ) },
+        { "lines", static_cast<double>( indexedLines.get() ) },
+        { "duration_us", static_cast<double>( duration.count() ) },
+        { "mib_per_s", mibPerSecond( indexedBytes, duration ) },
+        { "block_read", blockRead.toJson() },
+        { "queue_wait", queueWait.toJson() },
+        { "block_parse", blockParse.toJson() },
+        { "index_lock", indexLock.toJson() },
+    };
+}
+
+void SearchStats::addThreadMatch( size_t thread, std::chrono::microseconds duration )
+{
+    if ( threadMatch.size() <= thread ) {
+        threadMatch.resize( thread + 1 );
+    }
+    threadMatch[ thread ].add( duration );
+}
+
+QJsonObject SearchStats::toJson() const
+{
+    QJsonArray threads;
+    for ( const auto& thread : threadMatch ) {
+        threads.append( thread.toJson() );
+    }
+
+    return QJsonObject{
+        { "lines", static_cast<double>( searchedLines.get() ) },
+        { "matches", static_cast<double>( nbMatches.get() ) },
+        { "bytes", static_cast<double>( searchedBytes ) },
+        { "duration_us", static_cast<double>( duration.count() ) },
+        { "lines_per_s", perSecond( static_cast<double>( searchedLines.get() ), duration ) },
+        { "mib_per_s", mibPerSecond( searchedBytes, duration ) },
+        { "block_read", blockRead.toJson() },
+        { "queue_wait", queueWait.toJson() },
+        { "thread_match", threads },
+        { "results_lock", resultsLock.toJson() },
+    };
+}
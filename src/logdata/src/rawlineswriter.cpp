@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rawlineswriter.h"
+
+#include <algorithm>
+
+#if defined( Q_OS_UNIX )
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined( Q_OS_LINUX )
+#include <sys/sendfile.h>
+#endif
+
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+
+// Ranges closer than this to the first one of a batch are read with one
+// request and written with as few calls as possible
+constexpr qint64 BatchBytes = 8 * 1024 * 1024;
+
+// Ranges this large are copied without batching
+constexpr qint64 CopyRangeBytes = 1024 * 1024;
+
+#if defined( Q_OS_UNIX )
+// Lowest IOV_MAX of supported systems
+constexpr size_t MaxIoVectors = 1024;
+
+bool writeVectors( int fd, klogg::vector<iovec>& vectors )
+{
+    auto first = size_t{ 0 };
+    while ( first < vectors.size() ) {
+        const auto count = std::min( vectors.size() - first, MaxIoVectors );
+        auto written = ::writev( fd, vectors.data() + first, static_cast<int>( count ) );
+        if ( written < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+
+        // Skip written vectors, the last one can be written partially
+        while ( written > 0 ) {
+            auto& vector = vectors[ first ];
+            const auto part = std::min( vector.iov_len, static_cast<size_t>( written ) );
+            vector.iov_base = static_cast<char*>( vector.iov_base ) + part;
+            vector.iov_len -= part;
+            written -= static_cast<ssize_t>( part );
+            if ( vector.iov_len == 0 ) {
+                ++first;
+            }
+        }
+    }
+
+    return true;
+}
+#endif
+
+} // namespace
+
+RawLinesWriter::RawLinesWriter( const LogData& logData, QFileDevice& destination )
+    : logData_( logData )
+    , source_( logData.getFileName() )
+    , destination_( destination )
+{
+}
+
+bool RawLinesWriter::open()
+{
+    if ( !source_.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) ) {
+        LOG_ERROR << "Failed to open " << source_.fileName() << " to save lines";
+        return false;
+    }
+
+    return true;
+}
+
+bool RawLinesWriter::writeLines( LineNumber first, LinesCount number )
+{
+    const auto [ begin, end ] = logData_.getLinesByteRange( first, number );
+    if ( end <= begin ) {
+        return false;
+    }
+
+    return addRange( { begin, end } );
+}
+
+bool RawLinesWriter::writeLines( const klogg::vector<LineNumber::UnderlyingType>& lines )
+{
+    // Consecutive lines take one range of the file
+    auto runStart = size_t{ 0 };
+    while ( runStart < lines.size() ) {
+        auto runEnd = runStart + 1;
+        while ( runEnd < lines.size() && lines[ runEnd ] == lines[ runEnd - 1 ] + 1 ) {
+            ++runEnd;
+        }
+
+        if ( !writeLines( LineNumber( lines[ runStart ] ), LinesCount( runEnd - runStart ) ) ) {
+            return false;
+        }
+        runStart = runEnd;
+    }
+
+    return true;
+}
+
+bool RawLinesWriter::flush()
+{
+    if ( batch_.empty() ) {
+        return true;
+    }
+
+    const auto span = ByteRange{ batch_.front().begin, batch_.back().end };
+    buffer_.resize( static_cast<size_t>( span.end - span.begin ) );
+    auto isWritten = readRange( span, buffer_.data() );
+
+    if ( isWritten ) {
+#if defined( Q_OS_UNIX )
+        klogg::vector<iovec> vectors;
+        vectors.reserve( batch_.size() );
+        for ( const auto& range : batch_ ) {
+            vectors.push_back( iovec{ buffer_.data() + ( range.begin - span.begin ),
+                                      static_cast<size_t>( range.end - range.begin ) } );
+        }
+        isWritten = writeVectors( destination_.handle(), vectors );
+#else
+        for ( const auto& range : batch_ ) {
+            isWritten = writeData( buffer_.data() + ( range.begin - span.begin ),
+                                   range.end - range.begin );
+            if ( !isWritten ) {
+                break;
+            }
+        }
+#endif
+    }
+
+    batch_.clear();
+    return isWritten;
+}
+
+bool RawLinesWriter::addRange( ByteRange range )
+{
+    if ( range.end - range.begin >= CopyRangeBytes ) {
+        return flush() && copyRange( range );
+    }
+
+    if ( !batch_.empty() && range.end - batch_.front().begin > BatchBytes && !flush() ) {
+        return false;
+    }
+
+    batch_.push_back( range );
+    return true;
+}
+
+bool RawLinesWriter::copyRange( ByteRange range )
+{
+#if defined( Q_OS_LINUX )
+    const auto sourceFd = source_.handle();
+    const auto destinationFd = destination_.handle();
+
+    auto canCopyFileRange = true;
+    while ( range.begin < range.end ) {
+        const auto size = static_cast<size_t>( range.end - range.begin );
+
+        ssize_t copied = 0;
+        if ( canCopyFileRange ) {
+            loff_t sourceOffset = range.begin;
+            copied = ::copy_file_range( sourceFd, &sourceOffset, destinationFd, nullptr, size, 0 );
+            // Not supported by the kernel or between these file systems
+            if ( copied < 0
+                 && ( errno == EXDEV || errno == ENOSYS || errno == EINVAL
+                      || errno == EOPNOTSUPP ) ) {
+                LOG_INFO << "copy_file_range failed with " << errno << ", trying sendfile";
+                canCopyFileRange = false;
+                continue;
+            }
+        }
+        else {
+            off_t sourceOffset = range.begin;
+            copied = ::sendfile( destinationFd, sourceFd, &sourceOffset, size );
+        }
+
+        if ( copied < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( copied <= 0 ) {
+            LOG_INFO << "Copying in kernel stopped with " << errno << ", reading the rest";
+            break;
+        }
+
+        range.begin += copied;
+    }
+#endif
+
+    while ( range.begin < range.end ) {
+        const auto chunk
+            = ByteRange{ range.begin, std::min( range.end, range.begin + BatchBytes ) };
+        buffer_.resize( static_cast<size_t>( chunk.end - chunk.begin ) );
+        if ( !readRange( chunk, buffer_.data() )
+             || !writeData( buffer_.data(), chunk.end - chunk.begin ) ) {
+            return false;
+        }
+        range.begin = chunk.end;
+    }
+
+    return true;
+}
+
+bool RawLinesWriter::readRange( ByteRange range, char* data )
+{
+    const auto size = range.end - range.begin;
+    if ( !source_.seek( range.begin ) || source_.read( data, size ) != size ) {
+        LOG_ERROR << "Failed to read " << size << " bytes at " << range.begin << " from "
+                  << source_.fileName();
+        return false;
+    }
+
+    return true;
+}
+
+bool RawLinesWriter::writeData( const char* data, qint64 size )
+{
+#if defined( Q_OS_UNIX )
+    const auto fd = destination_.handle();
+    while ( size > 0 ) {
+        const auto written = ::write( fd, data, static_cast<size_t>( size ) );
+        if ( written < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+#else
+    return destination_.write( data, size ) == size;
+#endif
+}
@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchcoordinator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+#include <tbb/info.h>
+#include <tbb/parallel_for.h>
+
+#include "configuration.h"
+#include "log.h"
+#include "logdata.h"
+#include "progress.h"
+#include "regularexpression.h"
+#include "runnable_lambda.h"
+
+namespace {
+
+using LineRange = std::pair<LineNumber, LineNumber>;
+
+uint32_t getMatchingThreadsCount( const Configuration& config )
+{
+    if ( !config.useParallelSearch() ) {
+        return 1;
+    }
+    const auto configuredThreadPoolSize = config.searchThreadPoolSize();
+    return static_cast<uint32_t>( qMax( 1, configuredThreadPoolSize == 0
+                                               ? tbb::info::default_concurrency()
+                                               : configuredThreadPoolSize ) );
+}
+
+struct ChunkMatches {
+    SearchResultArray matchingLines;
+    LineLength maxLength;
+};
+
+// Matchers used by one matching thread
+struct ScanMatchers {
+    std::unique_ptr<MultiPatternMatcher> combined;
+    klogg::vector<std::unique_ptr<PatternMatcher>> individual;
+};
+
+} // namespace
+
+// Lines read for one batch of the scan, with the time it took
+struct SearchCoordinator::ScanBatch {
+    LineNumber begin;
+    LineNumber end;
+    klogg::vector<std::pair<LineNumber, LogData::RawLines>> chunks;
+    SearchStats stats;
+};
+
+struct SearchCoordinator::ActiveSearch {
+    Request request;
+    std::promise<void> done;
+
+    // Ranges of lines left to scan, the first one may start in the middle
+    // of the requested range if the search joined a running scan.
+    klogg::vector<LineRange> ranges;
+    size_t currentRange = 0;
+    LineNumber endLine;
+
+    LinesCount totalLines;
+    LinesCount scannedLines;
+    LinesCount nbMatches;
+    LineLength maxLength;
+    int reportedPercentage = 0;
+
+    SearchStats stats;
+    std::chrono::high_resolution_clock::time_point startTime;
+
+    // Index of the pattern in combined expression,
+    // otherwise the search uses its own matcher.
+    std::optional<size_t> combinedIndex;
+    size_t matcherIndex = 0;
+
+    // Literals of a pattern matched by the combined expression,
+    // searches with own matcher use the ones of the matcher
+    RequiredLiterals requiredLiterals;
+
+    bool isDone() const
+    {
+        return currentRange == ranges.size();
+    }
+
+    const LineRange& range() const
+    {
+        return ranges[ currentRange ];
+    }
+
+    bool isScanning( LineNumber line ) const
+    {
+        return !isDone() && range().first <= line && line < range().second;
+    }
+
+    // Same as PatternMatcher::precheckBlock for the pattern of the search
+    std::optional<bool> precheckBlock( const ScanMatchers& matchers,
+                                       std::string_view utf8Block ) const
+    {
+        if ( !combinedIndex ) {
+            return matchers.individual[ matcherIndex ]->precheckBlock( utf8Block );
+        }
+
+        if ( requiredLiterals.isEmpty() || requiredLiterals.mayMatch( utf8Block ) ) {
+            return {};
+        }
+
+        return request.pattern.isExclude;
+    }
+
+    void start( LineNumber position, LinesCount nbSourceLines )
+    {
+        const auto startLine = request.startLine;
+        endLine = qMin( request.endLine, LineNumber( nbSourceLines.get() ) );
+
+        request.results->clear();
+
+        if ( !request.pattern.isBoolean ) {
+            requiredLiterals = RequiredLiterals( request.pattern );
+        }
+
+        if ( startLine < position && position < endLine ) {
+            ranges = { { position, endLine }, { startLine, position } };
+        }
+        else if ( startLine < endLine ) {
+            ranges = { { startLine, endLine } };
+        }
+
+        totalLines = startLine < endLine ? endLine - startLine : 0_lcount;
+        startTime = std::chrono::high_resolution_clock::now();
+    }
+
+    void finish()
+    {
+        stats.searchedLines = scannedLines;
+        stats.nbMatches = nbMatches;
+        stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - startTime );
+        request.statsCollected( stats );
+
+        request.results->optimizeResults();
+        request.results->publishResults( true );
+        request.progressed( nbMatches, 100, request.startLine );
+        request.finished();
+        done.set_value();
+    }
+};
+
+namespace {
+
+template <typename ActiveSearchList>
+klogg::vector<ScanMatchers> buildMatchers( const ActiveSearchList& searches, size_t threadsCount )
+{
+    klogg::vector<RegularExpressionPattern> combinedPatterns;
+    klogg::vector<RegularExpression> individualExpressions;
+
+    for ( const auto& search : searches ) {
+        const auto& pattern = search->request.pattern;
+        if ( pattern.isBoolean ) {
+            search->combinedIndex.reset();
+            search->matcherIndex = individualExpressions.size();
+            individualExpressions.emplace_back( pattern );
+        }
+        else {
+            search->combinedIndex = combinedPatterns.size();
+            combinedPatterns.push_back( pattern );
+            combinedPatterns.back().isExclude = false;
+        }
+    }
+
+    std::optional<MultiRegularExpression> combinedExpression;
+    if ( !combinedPatterns.empty() ) {
+        combinedExpression.emplace( combinedPatterns );
+        if ( !combinedExpression->isValid() ) {
+            LOG_WARNING << "Failed to combine search patterns: "
+                        << combinedExpression->errorString();
+            combinedExpression.reset();
+
+            for ( const auto& search : searches ) {
+                if ( search->combinedIndex ) {
+                    search->combinedIndex.reset();
+                    search->matcherIndex = individualExpressions.size();
+                    individualExpressions.emplace_back( search->request.pattern );
+                }
+            }
+        }
+    }
+
+    LOG_INFO << "Scan matchers for " << searches.size() << " searches, "
+             << ( combinedExpression ? combinedPatterns.size() : 0u ) << " combined";
+
+    klogg::vector<ScanMatchers> matchers( threadsCount );
+    for ( auto& threadMatchers : matchers ) {
+        if ( combinedExpression ) {
+            threadMatchers.combined = combinedExpression->createMatcher();
+        }
+        for ( const auto& expression : individualExpressions ) {
+            threadMatchers.individual.push_back( expression.createMatcher() );
+        }
+    }
+
+    return matchers;
+}
+
+template <typename ActiveSearchList>
+klogg::vector<ChunkMatches> matchChunk( const ScanMatchers& matchers,
+                                        const ActiveSearchList& searches,
+                                        const LogData::RawLines& rawLines, LineNumber chunkStart )
+{
+    klogg::vector<ChunkMatches> results( searches.size() );
+    klogg::vector<SearchResultsBuilder> matchingLines( searches.size() );
+
+    const auto& lines = rawLines.buildUtf8View();
+    if ( lines.empty() ) {
+        return results;
+    }
+
+    // Lines are views into one buffer, the whole chunk is checked for
+    // literals required by each pattern before matching lines one by one.
+    // A search with a definite result for the chunk skips regex matching.
+    klogg::vector<std::optional<bool>> blockResults( searches.size() );
+    const auto blockBegin = lines.front().data();
+    const auto blockEnd = lines.back().data() + lines.back().size();
+    if ( std::less<>{}( blockBegin, blockEnd ) ) {
+        const auto block
+            = std::string_view( blockBegin, static_cast<size_t>( blockEnd - blockBegin ) );
+        for ( auto index = 0u; index < searches.size(); ++index ) {
+            blockResults[ index ] = searches[ index ]->precheckBlock( matchers, block );
+        }
+    }
+
+    if ( std::all_of( blockResults.cbegin(), blockResults.cend(),
+                      []( const auto& result ) { return result.has_value() && !*result; } ) ) {
+        return results;
+    }
+
+    MatchedPatterns combinedMatches;
+
+    for ( auto offset = 0u; offset < lines.size(); ++offset ) {
+        const auto& line = lines[ offset ];
+        const auto lineNumber = chunkStart + LinesCount{ offset };
+
+        // Combined expression is run once per line for all searches
+        bool isCombinedMatched = false;
+        for ( auto index = 0u; index < searches.size(); ++index ) {
+            const auto& search = *searches[ index ];
+            if ( !search.isScanning( lineNumber ) ) {
+                continue;
+            }
+
+            bool hasMatch = false;
+            if ( blockResults[ index ].has_value() ) {
+                // Every scanned line of the chunk has the same result
+                hasMatch = *blockResults[ index ];
+            }
+            else if ( search.combinedIndex ) {
+                if ( !isCombinedMatched ) {
+                    combinedMatches = matchers.combined->matchingPatterns( line );
+                    isCombinedMatched = true;
+                }
+                const auto patternIndex = *search.combinedIndex;
+                const auto isPatternMatched
+                    = patternIndex < combinedMatches.size() && combinedMatches[ patternIndex ];
+                hasMatch = isPatternMatched != search.request.pattern.isExclude;
+            }
+            else {
+                hasMatch = matchers.individual[ search.matcherIndex ]->hasMatch( line );
+            }
+
+            if ( hasMatch ) {
+                auto& result = results[ index ];
+                result.maxLength = qMax( result.maxLength, getUntabifiedLength( line ) );
+                matchingLines[ index ].add( lineNumber );
+            }
+        }
+    }
+
+    for ( auto index = 0u; index < searches.size(); ++index ) {
+        results[ index ].matchingLines = matchingLines[ index ].finish();
+    }
+
+    return results;
+}
+
+// Continues the scan at the position if any search needs it,
+// otherwise jumps to the closest range ahead or wraps around.
+template <typename ActiveSearchList>
+LineNumber nextScanPosition( const ActiveSearchList& searches, LineNumber position )
+{
+    std::optional<LineNumber> ahead;
+    std::optional<LineNumber> first;
+    for ( const auto& search : searches ) {
+        const auto& [ rangeStart, rangeEnd ] = search->range();
+        first = first ? qMin( *first, rangeStart ) : rangeStart;
+        if ( rangeEnd > position ) {
+            const auto start = qMax( rangeStart, position );
+            ahead = ahead ? qMin( *ahead, start ) : start;
+        }
+    }
+
+    return ahead ? *ahead : *first;
+}
+
+} // namespace
+
+SearchCoordinator::SearchCoordinator( const LogData& sourceLogData )
+    : sourceLogData_( sourceLogData )
+{
+    scanPool_.setMaxThreadCount( 1 );
+    readPool_.setMaxThreadCount( 1 );
+}
+
+SearchCoordinator::~SearchCoordinator()
+{
+    scanPool_.waitForDone();
+    readPool_.waitForDone();
+}
+
+std::shared_future<void> SearchCoordinator::submit( Request request )
+{
+    auto search = std::make_unique<ActiveSearch>();
+    search->request = std::move( request );
+    auto done = search->done.get_future().share();
+
+    ScopedLock lock( pendingMutex_ );
+    pendingSearches_.push_back( std::move( search ) );
+
+    if ( !isScanning_ ) {
+        isScanning_ = true;
+        scanPool_.start( createRunnable( [ this ] { scan(); } ) );
+    }
+
+    return done;
+}
+
+// Called in the scan thread's context
+void SearchCoordinator::scan()
+{
+    ActiveSearchList searches;
+    try {
+        doScan( searches );
+    } catch ( const std::exception& err ) {
+        LOG_ERROR << "Search scan failed: " << err.what();
+
+        ScopedLock lock( pendingMutex_ );
+        std::move( pendingSearches_.begin(), pendingSearches_.end(),
+                   std::back_inserter( searches ) );
+        pendingSearches_.clear();
+        isScanning_ = false;
+
+        for ( auto& search : searches ) {
+            search->request.results->clear();
+            search->finish();
+        }
+    }
+}
+
+void SearchCoordinator::doScan( ActiveSearchList& searches )
+{
+    const auto& config = Configuration::get();
+    const auto threadsCount = getMatchingThreadsCount( config );
+    const auto nbLinesInChunk = LinesCount(
+        static_cast<LinesCount::UnderlyingType>( config.searchReadBufferSizeLines() ) );
+
+    klogg::vector<ScanMatchers> matchers;
+    bool isMatchersOutdated = true;
+    auto position = 0_lnum;
+
+    // Batch following the last one, it is used if the scan continues there
+    std::future<ScanBatch> prefetchedBatch;
+
+    while ( true ) {
+        ActiveSearchList runningSearches;
+        for ( auto& search : searches ) {
+            if ( search->isDone() || *search->request.interruptRequested ) {
+                search->finish();
+                isMatchersOutdated = true;
+            }
+            else {
+                runningSearches.push_back( std::move( search ) );
+            }
+        }
+        searches = std::move( runningSearches );
+
+        {
+            ScopedLock lock( pendingMutex_ );
+            const auto nbSourceLines = sourceLogData_.getNbLine();
+            for ( auto& search : pendingSearches_ ) {
+                LOG_INFO << "Search joins scan at line " << position;
+                search->start( position, nbSourceLines );
+                searches.push_back( std::move( search ) );
+                isMatchersOutdated = true;
+            }
+            pendingSearches_.clear();
+
+            if ( searches.empty() ) {
+                isScanning_ = false;
+                return;
+            }
+        }
+
+        // Searches for empty ranges are finished on the next iteration
+        if ( std::any_of( searches.cbegin(), searches.cend(),
+                          []( const auto& search ) { return search->isDone(); } ) ) {
+            continue;
+        }
+
+        if ( isMatchersOutdated ) {
+            matchers = buildMatchers( searches, threadsCount );
+            isMatchersOutdated = false;
+        }
+
+        position = nextScanPosition( searches, position );
+
+        auto scanEnd = position;
+        for ( const auto& search : searches ) {
+            if ( search->isScanning( position ) ) {
+                scanEnd = qMax( scanEnd, search->range().second );
+            }
+        }
+        const auto batchLines = LinesCount( nbLinesInChunk.get() * threadsCount );
+        const auto batchEnd = qMin( scanEnd, position + batchLines );
+
+        auto batch = [ & ] {
+            if ( prefetchedBatch.valid() ) {
+                auto prefetched = prefetchedBatch.get();
+                if ( prefetched.begin == position && prefetched.end == batchEnd ) {
+                    return prefetched;
+                }
+            }
+            return readBatch( position, batchEnd, nbLinesInChunk );
+        }();
+
+        const auto nextBatchEnd = qMin( scanEnd, batchEnd + batchLines );
+        if ( batchEnd < nextBatchEnd ) {
+            prefetchedBatch = prefetchBatch( batchEnd, nextBatchEnd, nbLinesInChunk );
+        }
+
+        // Timings of this batch are added to all searches taking part in it
+        auto& batchStats = batch.stats;
+        batchStats.threadMatch.resize( threadsCount );
+
+        const auto& chunks = batch.chunks;
+
+        klogg::vector<klogg::vector<ChunkMatches>> chunkMatches( chunks.size() );
+        tbb::parallel_for( size_t{ 0 }, chunks.size(), [ & ]( size_t index ) {
+            ScopedDuration chunkMatch( batchStats.threadMatch[ index ] );
+            chunkMatches[ index ] = matchChunk( matchers[ index ], searches,
+                                                chunks[ index ].second, chunks[ index ].first );
+        } );
+
+        for ( auto index = 0u; index < searches.size(); ++index ) {
+            auto& search = *searches[ index ];
+            const auto [ rangeStart, rangeEnd ] = search.range();
+            const auto scannedBegin = qMax( rangeStart, position );
+            const auto scannedEnd = qMin( rangeEnd, batchEnd );
+            if ( scannedBegin >= scannedEnd ) {
+                continue;
+            }
+
+            SearchResultArray matches;
+            for ( auto& matchesInChunk : chunkMatches ) {
+                auto& result = matchesInChunk[ index ];
+                matches |= result.matchingLines;
+                search.maxLength = qMax( search.maxLength, result.maxLength );
+            }
+
+            const auto matchesCount = LinesCount( matches.cardinality() );
+            search.nbMatches += matchesCount;
+            search.scannedLines += scannedEnd - scannedBegin;
+
+            // Lines processed are reported only for the contiguous part from
+            // the start of the search, follow mode continues from there.
+            const auto isScanningFromStart
+                = search.currentRange == 0 && rangeStart == search.request.startLine;
+            if ( scannedEnd == rangeEnd ) {
+                ++search.currentRange;
+            }
+
+            const auto processedEnd = search.isDone()      ? search.endLine
+                                      : isScanningFromStart ? scannedEnd
+                                                            : search.request.startLine;
+
+            ScopedDuration resultsLock( search.stats.resultsLock );
+            search.request.results->addAll( search.maxLength, matches, matchesCount,
+                                            LinesCount( processedEnd.get() ) );
+            resultsLock.stop();
+
+            search.stats.searchedBytes += batchStats.searchedBytes;
+            search.stats.blockRead.merge( batchStats.blockRead );
+            search.stats.threadMatch.resize(
+                std::max( search.stats.threadMatch.size(), batchStats.threadMatch.size() ) );
+            for ( auto thread = 0u; thread < batchStats.threadMatch.size(); ++thread ) {
+                search.stats.threadMatch[ thread ].merge( batchStats.threadMatch[ thread ] );
+            }
+
+            const int percentage
+                = calculateProgress( search.scannedLines.get(), search.totalLines.get() );
+            if ( percentage > search.reportedPercentage || matchesCount.get() > 0 ) {
+                search.request.results->publishResults( false );
+                search.request.progressed( search.nbMatches, std::min( 99, percentage ),
+                                           search.request.startLine );
+                search.reportedPercentage = percentage;
+            }
+        }
+
+        position = batchEnd;
+    }
+}
+
+SearchCoordinator::ScanBatch SearchCoordinator::readBatch( LineNumber begin, LineNumber end,
+                                                           LinesCount nbLinesInChunk ) const
+{
+    ScanBatch batch{ begin, end, {}, {} };
+    for ( auto chunkStart = begin; chunkStart < end; chunkStart = chunkStart + nbLinesInChunk ) {
+        const auto linesInChunk
+            = LinesCount( qMin( nbLinesInChunk.get(), ( end - chunkStart ).get() ) );
+
+        ScopedDuration blockRead( batch.stats.blockRead );
+        batch.chunks.emplace_back( chunkStart,
+                                   sourceLogData_.getLinesRaw( chunkStart, linesInChunk ) );
+        blockRead.stop();
+
+        batch.stats.searchedBytes += klogg::ssize( batch.chunks.back().second.buffer );
+    }
+
+    return batch;
+}
+
+std::future<SearchCoordinator::ScanBatch>
+SearchCoordinator::prefetchBatch( LineNumber begin, LineNumber end, LinesCount nbLinesInChunk )
+{
+    auto batch = std::make_shared<std::promise<ScanBatch>>();
+    auto future = batch->get_future();
+
+    readPool_.start( createRunnable( [ this, batch, begin, end, nbLinesInChunk ] {
+        try {
+            batch->set_value( readBatch( begin, end, nbLinesInChunk ) );
+        } catch ( ... ) {
+            batch->set_exception( std::current_exception() );
+        }
+    } ) );
+
+    return future;
+}
@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchresultarray.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "containers.h"
+
+namespace {
+
+// Serialized bitmaps start with a byte telling their width
+constexpr char NarrowTag = 4;
+constexpr char WideTag = 8;
+
+template <typename Bitmap>
+using ValueType
+    = std::conditional_t<std::is_same_v<Bitmap, roaring::Roaring>, uint32_t, uint64_t>;
+
+struct IterationContext {
+    SearchResultArray::Iterator iterator;
+    void* context;
+};
+
+template <typename Bitmap>
+void iterateBitmapFrom( const Bitmap& bitmap, uint64_t from, SearchResultArray::Iterator iterator,
+                        void* context )
+{
+    auto position = bitmap.begin();
+    if ( !position.move_equalorlarger( static_cast<ValueType<Bitmap>>( from ) ) ) {
+        return;
+    }
+
+    const auto end = bitmap.end();
+    for ( ; position != end; ++position ) {
+        if ( !iterator( *position, context ) ) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+SearchResultArray SearchResultArray::forLines( LinesCount nbLines )
+{
+    SearchResultArray array;
+    if ( nbLines.get() > 0 && !isNarrowValue( nbLines.get() - 1 ) ) {
+        array.widen();
+    }
+    return array;
+}
+
+void SearchResultArray::widen()
+{
+    if ( auto* narrow = std::get_if<roaring::Roaring>( &bitmap_ ) ) {
+        bitmap_ = roaring::Roaring64Map( *narrow );
+    }
+}
+
+void SearchResultArray::add( uint64_t value )
+{
+    if ( !isNarrowValue( value ) ) {
+        widen();
+    }
+
+    std::visit(
+        [ value ]( auto& bitmap ) {
+            using Value = ValueType<std::decay_t<decltype( bitmap )>>;
+            bitmap.add( static_cast<Value>( value ) );
+        },
+        bitmap_ );
+}
+
+bool SearchResultArray::addChecked( uint64_t value )
+{
+    if ( !isNarrowValue( value ) ) {
+        widen();
+    }
+
+    return std::visit(
+        [ value ]( auto& bitmap ) {
+            using Value = ValueType<std::decay_t<decltype( bitmap )>>;
+            return bitmap.addChecked( static_cast<Value>( value ) );
+        },
+        bitmap_ );
+}
+
+void SearchResultArray::addRange( uint64_t min, uint64_t max )
+{
+    if ( min >= max ) {
+        return;
+    }
+
+    if ( !isNarrowValue( max - 1 ) ) {
+        widen();
+    }
+
+    std::visit( [ min, max ]( auto& bitmap ) { bitmap.addRange( min, max ); }, bitmap_ );
+}
+
+void SearchResultArray::addMany( size_t count, const uint64_t* values )
+{
+    if ( count == 0 ) {
+        return;
+    }
+
+    if ( std::any_of( values, values + count,
+                      []( uint64_t value ) { return !isNarrowValue( value ); } ) ) {
+        widen();
+    }
+
+    if ( auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        wide->addMany( count, values );
+    }
+    else {
+        klogg::vector<uint32_t> narrowValues( values, values + count );
+        std::get<roaring::Roaring>( bitmap_ ).addMany( count, narrowValues.data() );
+    }
+}
+
+void SearchResultArray::remove( uint64_t value )
+{
+    if ( auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        wide->remove( value );
+    }
+    else if ( isNarrowValue( value ) ) {
+        std::get<roaring::Roaring>( bitmap_ ).remove( static_cast<uint32_t>( value ) );
+    }
+}
+
+bool SearchResultArray::contains( uint64_t value ) const
+{
+    if ( const auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        return wide->contains( value );
+    }
+
+    return isNarrowValue( value )
+           && std::get<roaring::Roaring>( bitmap_ ).contains( static_cast<uint32_t>( value ) );
+}
+
+uint64_t SearchResultArray::cardinality() const
+{
+    return std::visit( []( const auto& bitmap ) { return bitmap.cardinality(); }, bitmap_ );
+}
+
+bool SearchResultArray::isEmpty() const
+{
+    return std::visit( []( const auto& bitmap ) { return bitmap.isEmpty(); }, bitmap_ );
+}
+
+uint64_t SearchResultArray::minimum() const
+{
+    return std::visit( []( const auto& bitmap ) -> uint64_t { return bitmap.minimum(); },
+                       bitmap_ );
+}
+
+uint64_t SearchResultArray::maximum() const
+{
+    return std::visit( []( const auto& bitmap ) -> uint64_t { return bitmap.maximum(); },
+                       bitmap_ );
+}
+
+bool SearchResultArray::isSubsetOf( const SearchResultArray& other ) const
+{
+    const auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ );
+    const auto* otherWide = std::get_if<roaring::Roaring64Map>( &other.bitmap_ );
+
+    if ( wide && otherWide ) {
+        return wide->isSubset( *otherWide );
+    }
+    else if ( wide ) {
+        const roaring::Roaring64Map otherValues( std::get<roaring::Roaring>( other.bitmap_ ) );
+        return wide->isSubset( otherValues );
+    }
+    else if ( otherWide ) {
+        const roaring::Roaring64Map values( std::get<roaring::Roaring>( bitmap_ ) );
+        return values.isSubset( *otherWide );
+    }
+
+    return std::get<roaring::Roaring>( bitmap_ ).isSubset(
+        std::get<roaring::Roaring>( other.bitmap_ ) );
+}
+
+uint64_t SearchResultArray::rank( uint64_t value ) const
+{
+    if ( const auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        return wide->rank( value );
+    }
+
+    const auto& narrow = std::get<roaring::Roaring>( bitmap_ );
+    return isNarrowValue( value ) ? narrow.rank( static_cast<uint32_t>( value ) )
+                                  : narrow.cardinality();
+}
+
+bool SearchResultArray::select( uint64_t rank, uint64_t* element ) const
+{
+    if ( const auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        return wide->select( rank, element );
+    }
+
+    if ( !isNarrowValue( rank ) ) {
+        return false;
+    }
+
+    uint32_t narrowElement = 0;
+    if ( !std::get<roaring::Roaring>( bitmap_ ).select( static_cast<uint32_t>( rank ),
+                                                         &narrowElement ) ) {
+        return false;
+    }
+
+    *element = narrowElement;
+    return true;
+}
+
+void SearchResultArray::iterate( Iterator iterator, void* context ) const
+{
+    if ( const auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        wide->iterate( iterator, context );
+        return;
+    }
+
+    IterationContext narrowContext{ iterator, context };
+    std::get<roaring::Roaring>( bitmap_ ).iterate(
+        []( uint32_t value, void* param ) -> bool {
+            const auto* iteration = static_cast<IterationContext*>( param );
+            return iteration->iterator( value, iteration->context );
+        },
+        &narrowContext );
+}
+
+void SearchResultArray::iterateFrom( uint64_t from, Iterator iterator, void* context ) const
+{
+    if ( const auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        iterateBitmapFrom( *wide, from, iterator, context );
+    }
+    else if ( isNarrowValue( from ) ) {
+        iterateBitmapFrom( std::get<roaring::Roaring>( bitmap_ ), from, iterator, context );
+    }
+}
+
+bool SearchResultArray::runOptimize()
+{
+    return std::visit( []( auto& bitmap ) { return bitmap.runOptimize(); }, bitmap_ );
+}
+
+size_t SearchResultArray::getSizeInBytes( bool portable ) const
+{
+    return 1
+           + std::visit(
+               [ portable ]( const auto& bitmap ) { return bitmap.getSizeInBytes( portable ); },
+               bitmap_ );
+}
+
+size_t SearchResultArray::write( char* buffer, bool portable ) const
+{
+    buffer[ 0 ] = isWide() ? WideTag : NarrowTag;
+    return 1
+           + std::visit(
+               [ buffer, portable ]( const auto& bitmap ) {
+                   return bitmap.write( buffer + 1, portable );
+               },
+               bitmap_ );
+}
+
+SearchResultArray SearchResultArray::readSafe( const char* buffer, size_t maxBytes )
+{
+    if ( maxBytes < 1 ) {
+        throw std::runtime_error( "Empty search results data" );
+    }
+
+    SearchResultArray array;
+    if ( buffer[ 0 ] == NarrowTag ) {
+        array.bitmap_ = roaring::Roaring::readSafe( buffer + 1, maxBytes - 1 );
+    }
+    else if ( buffer[ 0 ] == WideTag ) {
+        array.bitmap_ = roaring::Roaring64Map::readSafe( buffer + 1, maxBytes - 1 );
+    }
+    else {
+        throw std::runtime_error( "Unknown search results format" );
+    }
+
+    return array;
+}
+
+template <typename Operation>
+SearchResultArray& SearchResultArray::combine( const SearchResultArray& other,
+                                               Operation operation )
+{
+    if ( other.isWide() ) {
+        widen();
+    }
+
+    if ( auto* wide = std::get_if<roaring::Roaring64Map>( &bitmap_ ) ) {
+        if ( const auto* otherWide = std::get_if<roaring::Roaring64Map>( &other.bitmap_ ) ) {
+            operation( *wide, *otherWide );
+        }
+        else {
+            operation( *wide,
+                       roaring::Roaring64Map( std::get<roaring::Roaring>( other.bitmap_ ) ) );
+        }
+    }
+    else {
+        operation( std::get<roaring::Roaring>( bitmap_ ),
+                   std::get<roaring::Roaring>( other.bitmap_ ) );
+    }
+
+    return *this;
+}
+
+SearchResultArray& SearchResultArray::operator|=( const SearchResultArray& other )
+{
+    return combine( other, []( auto& lhs, const auto& rhs ) { lhs |= rhs; } );
+}
+
+SearchResultArray& SearchResultArray::operator&=( const SearchResultArray& other )
+{
+    return combine( other, []( auto& lhs, const auto& rhs ) { lhs &= rhs; } );
+}
+
+SearchResultArray& SearchResultArray::operator-=( const SearchResultArray& other )
+{
+    return combine( other, []( auto& lhs, const auto& rhs ) { lhs -= rhs; } );
+}
+
+void SearchResultRankIndex::clear()
+{
+    samples_.clear();
+    cardinality_ = 0;
+    lastValue_ = 0;
+}
+
+void SearchResultRankIndex::rebuild( const SearchResultArray& results )
+{
+    clear();
+    extend( results );
+}
+
+void SearchResultRankIndex::extend( const SearchResultArray& results )
+{
+    if ( cardinality_ > 0 && lastValue_ == std::numeric_limits<uint64_t>::max() ) {
+        return;
+    }
+
+    results.iterateFrom(
+        cardinality_ > 0 ? lastValue_ + 1 : 0,
+        []( uint64_t value, void* context ) -> bool {
+            auto* index = static_cast<SearchResultRankIndex*>( context );
+            if ( index->cardinality_ % SampleStep == 0 ) {
+                index->samples_.push_back( value );
+            }
+            index->cardinality_++;
+            index->lastValue_ = value;
+            return true;
+        },
+        static_cast<void*>( this ) );
+}
+
+void SearchResultRankIndex::rebuildFrom( const SearchResultArray& results,
+                                         uint64_t firstChanged )
+{
+    // The last kept sample is indexed again, so extend starts right at it
+    const auto keptSamples = static_cast<size_t>( std::distance(
+        samples_.begin(), std::lower_bound( samples_.begin(), samples_.end(), firstChanged ) ) );
+    if ( keptSamples < 2 ) {
+        rebuild( results );
+        return;
+    }
+
+    lastValue_ = samples_[ keptSamples - 1 ] - 1;
+    samples_.resize( keptSamples - 1 );
+    cardinality_ = samples_.size() * SampleStep;
+    extend( results );
+}
+
+void SearchResultRankIndex::removeLast( const SearchResultArray& results )
+{
+    if ( cardinality_ == 0 ) {
+        return;
+    }
+
+    cardinality_--;
+    if ( cardinality_ % SampleStep == 0 ) {
+        samples_.pop_back();
+    }
+    lastValue_ = results.isEmpty() ? 0 : results.maximum();
+}
+
+uint64_t SearchResultRankIndex::rank( const SearchResultArray& results, uint64_t value ) const
+{
+    const auto nextSample = std::upper_bound( samples_.begin(), samples_.end(), value );
+    if ( nextSample == samples_.begin() ) {
+        return 0;
+    }
+
+    const auto sampleIndex
+        = static_cast<uint64_t>( std::distance( samples_.begin(), nextSample ) ) - 1;
+
+    // Values from the sample up to the next one, which is known to be greater
+    struct Counter {
+        uint64_t limit;
+        uint64_t count;
+    } counter{ value, 0 };
+
+    results.iterateFrom(
+        samples_[ sampleIndex ],
+        []( uint64_t line, void* context ) -> bool {
+            auto* counter = static_cast<Counter*>( context );
+            if ( line > counter->limit ) {
+                return false;
+            }
+            counter->count++;
+            return counter->count < SampleStep;
+        },
+        static_cast<void*>( &counter ) );
+
+    return sampleIndex * SampleStep + counter.count;
+}
+
+bool SearchResultRankIndex::select( const SearchResultArray& results, uint64_t rank,
+                                    uint64_t* element ) const
+{
+    if ( rank >= cardinality_ ) {
+        return false;
+    }
+
+    struct Skipper {
+        uint64_t remaining;
+        uint64_t* element;
+    } skipper{ rank % SampleStep, element };
+
+    results.iterateFrom(
+        samples_[ rank / SampleStep ],
+        []( uint64_t line, void* context ) -> bool {
+            auto* skipper = static_cast<Skipper*>( context );
+            if ( skipper->remaining == 0 ) {
+                *skipper->element = line;
+                return false;
+            }
+            skipper->remaining--;
+            return true;
+        },
+        static_cast<void*>( &skipper ) );
+
+    return true;
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchresultscache.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <tuple>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include "configuration.h"
+#include "filedigest.h"
+#include "log.h"
+#include "readablesize.h"
+
+namespace {
+
+constexpr quint32 CacheFileMagic = 0x4b535243; // KSRC
+constexpr quint32 CacheFileVersion = 3;
+
+bool isSameContent( const IndexedHash& lhs, const IndexedHash& rhs )
+{
+    return std::tie( lhs.size, lhs.fullDigest, lhs.headerSize, lhs.headerDigest, lhs.tailSize,
+                     lhs.tailOffset, lhs.tailDigest )
+           == std::tie( rhs.size, rhs.fullDigest, rhs.headerSize, rhs.headerDigest, rhs.tailSize,
+                        rhs.tailOffset, rhs.tailDigest );
+}
+
+bool isSameSearch( const SearchResultsCache::Key& lhs, const SearchResultsCache::Key& rhs )
+{
+    return lhs.pattern == rhs.pattern && lhs.startLine == rhs.startLine
+           && lhs.codecName == rhs.codecName && lhs.prefilterPattern == rhs.prefilterPattern;
+}
+
+void writeMetadata( QDataStream& stream, const SearchResultsCache::Key& key, LinesCount fileLines,
+                    LineLength maxLength, LinesCount processedLines )
+{
+    const auto& pattern = key.pattern;
+    const auto& hash = key.fileHash;
+
+    stream << CacheFileMagic << CacheFileVersion;
+    stream << pattern.pattern << pattern.isCaseSensitive << pattern.isExclude << pattern.isBoolean
+           << pattern.isPlainText;
+    stream << static_cast<quint64>( key.startLine.get() )
+           << static_cast<quint64>( key.endLine.get() );
+    stream << key.codecName << key.prefilterPattern;
+    stream << hash.size << hash.fullDigest << hash.headerSize << hash.headerDigest
+           << hash.tailSize << hash.tailOffset << hash.tailDigest;
+    stream << static_cast<quint64>( fileLines.get() ) << static_cast<qint64>( maxLength.get() )
+           << static_cast<quint64>( processedLines.get() );
+}
+
+bool readMetadata( QDataStream& stream, SearchResultsCache::Key& key, LinesCount& fileLines,
+                   LineLength& maxLength, LinesCount& processedLines )
+{
+    quint32 magic{};
+    quint32 version{};
+    stream >> magic >> version;
+    if ( magic != CacheFileMagic || version != CacheFileVersion ) {
+        return false;
+    }
+
+    QString pattern;
+    bool isCaseSensitive{};
+    bool isExclude{};
+    bool isBoolean{};
+    bool isPlainText{};
+    stream >> pattern >> isCaseSensitive >> isExclude >> isBoolean >> isPlainText;
+    key.pattern
+        = RegularExpressionPattern( pattern, isCaseSensitive, isExclude, isBoolean, isPlainText );
+
+    quint64 startLine{};
+    quint64 endLine{};
+    stream >> startLine >> endLine;
+    key.startLine = LineNumber( startLine );
+    key.endLine = LineNumber( endLine );
+
+    stream >> key.codecName >> key.prefilterPattern;
+
+    auto& hash = key.fileHash;
+    stream >> hash.size >> hash.fullDigest >> hash.headerSize >> hash.headerDigest
+        >> hash.tailSize >> hash.tailOffset >> hash.tailDigest;
+
+    quint64 lines{};
+    qint64 length{};
+    quint64 processed{};
+    stream >> lines >> length >> processed;
+    fileLines = LinesCount( lines );
+    maxLength = LineLength( static_cast<LineLength::UnderlyingType>( length ) );
+    processedLines = LinesCount( processed );
+
+    return stream.status() == QDataStream::Ok;
+}
+
+QString makeFileName( const SearchResultsCache::Key& key )
+{
+    QByteArray keyData;
+    {
+        QDataStream stream( &keyData, QIODevice::WriteOnly );
+        writeMetadata( stream, key, 0_lcount, 0_length, 0_lcount );
+    }
+
+    FileDigest digest;
+    digest.addData( keyData );
+    return QString::number( digest.digest(), 16 ) + ".ksr";
+}
+
+} // namespace
+
+SearchResultsCache& SearchResultsCache::get()
+{
+    static SearchResultsCache cache;
+    return cache;
+}
+
+SearchResultsCache::SearchResultsCache()
+    : cacheDirectory_(
+        QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/search_results" )
+{
+    loadIndex();
+}
+
+void SearchResultsCache::loadIndex()
+{
+    QDir directory( cacheDirectory_ );
+    if ( !directory.exists() && !directory.mkpath( "." ) ) {
+        LOG_WARNING << "Can't create search results cache in " << cacheDirectory_;
+        return;
+    }
+
+    const auto files
+        = directory.entryInfoList( { "*.ksr" }, QDir::Files, QDir::Time | QDir::Reversed );
+    for ( const auto& fileInfo : files ) {
+        QFile file( fileInfo.absoluteFilePath() );
+        if ( !file.open( QIODevice::ReadOnly ) ) {
+            continue;
+        }
+
+        Entry entry;
+        QDataStream stream( &file );
+        if ( !readMetadata( stream, entry.key, entry.fileLines, entry.maxLength,
+                            entry.processedLines ) ) {
+            LOG_WARNING << "Removing invalid search results cache file " << fileInfo.fileName();
+            file.remove();
+            continue;
+        }
+
+        entry.fileName = fileInfo.absoluteFilePath();
+        entry.sizeInBytes = static_cast<uint64_t>( fileInfo.size() );
+        totalSize_ += entry.sizeInBytes;
+
+        // Files are sorted from oldest to newest
+        entries_.push_front( std::move( entry ) );
+    }
+
+    LOG_INFO << "Search results cache has " << entries_.size() << " entries, "
+             << readableSize( totalSize_ );
+
+    evict();
+}
+
+bool SearchResultsCache::loadMatchingLines( Entry& entry ) const
+{
+    if ( entry.matchingLines ) {
+        return true;
+    }
+
+    QFile file( entry.fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    Key key;
+    LinesCount fileLines;
+    LineLength maxLength;
+    LinesCount processedLines;
+    QByteArray serializedLines;
+
+    QDataStream stream( &file );
+    if ( !readMetadata( stream, key, fileLines, maxLength, processedLines ) ) {
+        return false;
+    }
+
+    stream >> serializedLines;
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    try {
+        entry.matchingLines = SearchResultArray::readSafe(
+            serializedLines.constData(), static_cast<size_t>( serializedLines.size() ) );
+    } catch ( const std::exception& err ) {
+        LOG_WARNING << "Failed to read cached search results: " << err.what();
+        return false;
+    }
+
+    return true;
+}
+
+bool SearchResultsCache::store( Entry& entry ) const
+{
+    QByteArray serializedLines( static_cast<int>( entry.matchingLines->getSizeInBytes() ),
+                                Qt::Uninitialized );
+    entry.matchingLines->write( serializedLines.data() );
+
+    QFile file( entry.fileName );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG_WARNING << "Can't write search results cache file " << entry.fileName;
+        return false;
+    }
+
+    QDataStream stream( &file );
+    writeMetadata( stream, entry.key, entry.fileLines, entry.maxLength, entry.processedLines );
+    stream << serializedLines;
+
+    entry.sizeInBytes = static_cast<uint64_t>( file.size() );
+    return stream.status() == QDataStream::Ok;
+}
+
+void SearchResultsCache::touch( EntryList::iterator entry )
+{
+    entries_.splice( entries_.begin(), entries_, entry );
+
+    QFile file( entry->fileName );
+    if ( file.open( QIODevice::Append ) ) {
+        file.setFileTime( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+    }
+}
+
+void SearchResultsCache::evict()
+{
+    const auto maxSize
+        = static_cast<uint64_t>( Configuration::get().searchResultsCacheSizeMb() ) * 1024 * 1024;
+
+    while ( totalSize_ > maxSize && !entries_.empty() ) {
+        const auto& leastRecent = entries_.back();
+        LOG_INFO << "Evicting cached search results for " << leastRecent.key.pattern.pattern
+                 << ", " << readableSize( leastRecent.sizeInBytes );
+
+        QFile::remove( leastRecent.fileName );
+        totalSize_ -= leastRecent.sizeInBytes;
+        entries_.pop_back();
+    }
+}
+
+std::optional<SearchResultsCache::Results>
+SearchResultsCache::find( const Key& key, const ContentPrefixCheck& hasContentPrefix )
+{
+    ScopedLock lock( mutex_ );
+
+    auto found = std::find_if( entries_.begin(), entries_.end(), [ &key ]( const auto& entry ) {
+        return isSameSearch( entry.key, key ) && entry.key.endLine == key.endLine
+               && isSameContent( entry.key.fileHash, key.fileHash );
+    } );
+
+    if ( found == entries_.end() ) {
+        // Results searched to the end of older version of the file
+        // can be used if new lines were only appended.
+        for ( auto entry = entries_.begin(); entry != entries_.end(); ++entry ) {
+            const auto& entryKey = entry->key;
+            const bool isCandidate = isSameSearch( entryKey, key )
+                                     && entryKey.endLine.get() == entry->fileLines.get()
+                                     && entryKey.endLine <= key.endLine
+                                     && entryKey.fileHash.size < key.fileHash.size;
+            if ( isCandidate
+                 && ( found == entries_.end()
+                      || found->key.fileHash.size < entryKey.fileHash.size ) ) {
+                found = entry;
+            }
+        }
+
+        if ( found != entries_.end() && !hasContentPrefix( found->key.fileHash ) ) {
+            found = entries_.end();
+        }
+    }
+
+    if ( found == entries_.end() ) {
+        return {};
+    }
+
+    if ( !loadMatchingLines( *found ) ) {
+        QFile::remove( found->fileName );
+        totalSize_ -= found->sizeInBytes;
+        entries_.erase( found );
+        return {};
+    }
+
+    LOG_INFO << "Got search results from cache, " << found->processedLines << " lines searched";
+
+    touch( found );
+    return Results{ *found->matchingLines, found->maxLength, found->processedLines };
+}
+
+void SearchResultsCache::insert( const Key& key, const Results& results, LinesCount fileLines )
+{
+    ScopedLock lock( mutex_ );
+
+    const auto existing
+        = std::find_if( entries_.begin(), entries_.end(), [ &key ]( const auto& entry ) {
+              return isSameSearch( entry.key, key ) && entry.key.endLine == key.endLine
+                     && isSameContent( entry.key.fileHash, key.fileHash );
+          } );
+    if ( existing != entries_.end() ) {
+        // Results restored from this entry are stored again when shown
+        if ( existing->processedLines == results.processedLines
+             && existing->fileLines == fileLines ) {
+            touch( existing );
+            return;
+        }
+
+        totalSize_ -= existing->sizeInBytes;
+        entries_.erase( existing );
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.fileLines = fileLines;
+    entry.maxLength = results.maxLength;
+    entry.processedLines = results.processedLines;
+    entry.fileName = cacheDirectory_ + "/" + makeFileName( key );
+    entry.matchingLines = results.matchingLines;
+
+    if ( !store( entry ) ) {
+        QFile::remove( entry.fileName );
+        return;
+    }
+
+    LOG_INFO << "Cached search results for " << key.pattern.pattern << ", "
+             << readableSize( entry.sizeInBytes );
+
+    totalSize_ += entry.sizeInBytes;
+    entries_.push_front( std::move( entry ) );
+
+    // Only the most recent results are kept in memory
+    std::for_each( std::next( entries_.begin() ), entries_.end(),
+                   []( auto& olderEntry ) { olderEntry.matchingLines.reset(); } );
+
+    evict();
+}
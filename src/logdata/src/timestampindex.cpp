@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timestampindex.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+#include "log.h"
+
+namespace {
+
+constexpr std::array<std::string_view, 12> MonthNames
+    = { "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec" };
+
+char toLowerAscii( char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>( c - 'A' + 'a' ) : c;
+}
+
+// Days since 1970-01-01 in proleptic Gregorian calendar
+int64_t daysFromCivil( int64_t year, int64_t month, int64_t day )
+{
+    year -= month <= 2 ? 1 : 0;
+    const auto era = ( year >= 0 ? year : year - 399 ) / 400;
+    const auto yearOfEra = year - era * 400;
+    const auto dayOfYear = ( 153 * ( month + ( month > 2 ? -3 : 9 ) ) + 2 ) / 5 + day - 1;
+    const auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+} // namespace
+
+TimestampParser::TimestampParser( const QString& format )
+    : format_( format )
+{
+    struct FieldPattern {
+        QLatin1String pattern;
+        Field field;
+    };
+
+    // Longer patterns go first
+    const std::array<FieldPattern, 9> fields = { {
+        { QLatin1String( "yyyy" ), Field::Year },
+        { QLatin1String( "MMM" ), Field::MonthName },
+        { QLatin1String( "zzz" ), Field::Millisecond },
+        { QLatin1String( "yy" ), Field::ShortYear },
+        { QLatin1String( "MM" ), Field::Month },
+        { QLatin1String( "dd" ), Field::Day },
+        { QLatin1String( "HH" ), Field::Hour },
+        { QLatin1String( "mm" ), Field::Minute },
+        { QLatin1String( "ss" ), Field::Second },
+    } };
+
+    auto position = 0;
+    while ( position < format.size() ) {
+        const auto field
+            = std::find_if( fields.begin(), fields.end(), [ &format, position ]( const auto& f ) {
+                  return format.mid( position ).startsWith( f.pattern );
+              } );
+
+        if ( field != fields.end() ) {
+            tokens_.push_back( Token{ field->field, static_cast<uint8_t>( field->pattern.size() ),
+                                      '\0' } );
+            position += field->pattern.size();
+        }
+        else {
+            const auto literal = format.at( position ).toLatin1();
+            if ( literal == '\0' ) {
+                LOG_WARNING << "Unsupported character in timestamp format " << format;
+                tokens_.clear();
+                return;
+            }
+            tokens_.push_back( Token{ Field::Literal, 1, literal } );
+            ++position;
+        }
+    }
+
+    for ( const auto& token : tokens_ ) {
+        length_ += token.width;
+    }
+}
+
+std::optional<int64_t> TimestampParser::parse( std::string_view line ) const
+{
+    if ( tokens_.empty() || line.size() < length_ ) {
+        return {};
+    }
+
+    int64_t year = 1970;
+    int64_t month = 1;
+    int64_t day = 1;
+    int64_t hour = 0;
+    int64_t minute = 0;
+    int64_t second = 0;
+    int64_t millisecond = 0;
+
+    const char* data = line.data();
+    for ( const auto& token : tokens_ ) {
+        if ( token.field == Field::Literal ) {
+            if ( *data != token.literal ) {
+                return {};
+            }
+            ++data;
+            continue;
+        }
+
+        if ( token.field == Field::MonthName ) {
+            const auto name = std::array<char, 3>{ toLowerAscii( data[ 0 ] ),
+                                                   toLowerAscii( data[ 1 ] ),
+                                                   toLowerAscii( data[ 2 ] ) };
+            const auto monthName
+                = std::find( MonthNames.begin(), MonthNames.end(),
+                             std::string_view( name.data(), name.size() ) );
+            if ( monthName == MonthNames.end() ) {
+                return {};
+            }
+            month = std::distance( MonthNames.begin(), monthName ) + 1;
+            data += 3;
+            continue;
+        }
+
+        int64_t value = 0;
+        for ( auto digit = 0u; digit < token.width; ++digit, ++data ) {
+            // Syslog pads days with a space, "Oct  3"
+            if ( token.field == Field::Day && digit == 0 && *data == ' ' ) {
+                continue;
+            }
+            if ( *data < '0' || *data > '9' ) {
+                return {};
+            }
+            value = value * 10 + ( *data - '0' );
+        }
+
+        switch ( token.field ) {
+        case Field::Year:
+            year = value;
+            break;
+        case Field::ShortYear:
+            year = 2000 + value;
+            break;
+        case Field::Month:
+            month = value;
+            break;
+        case Field::Day:
+            day = value;
+            break;
+        case Field::Hour:
+            hour = value;
+            break;
+        case Field::Minute:
+            minute = value;
+            break;
+        case Field::Second:
+            second = value;
+            break;
+        case Field::Millisecond:
+            millisecond = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if ( month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59
+         || second > 60 ) {
+        return {};
+    }
+
+    const auto seconds
+        = ( ( daysFromCivil( year, month, day ) * 24 + hour ) * 60 + minute ) * 60 + second;
+    return seconds * 1000 + millisecond;
+}
+
+void TimestampIndex::add( LineNumber line, int64_t timestamp )
+{
+    if ( !isMonotone_ ) {
+        return;
+    }
+
+    if ( !timestamps_.empty() && timestamp < timestamps_.back() ) {
+        LOG_WARNING << "Timestamps are not in order at line " << line
+                    << ", timestamp index disabled";
+        isMonotone_ = false;
+        lines_.clear();
+        timestamps_.clear();
+        return;
+    }
+
+    lines_.push_back( line.get() );
+    timestamps_.push_back( timestamp );
+}
+
+void TimestampIndex::append( const TimestampIndex& other )
+{
+    if ( format_.isEmpty() ) {
+        format_ = other.format_;
+    }
+
+    if ( !other.isMonotone_ ) {
+        isMonotone_ = false;
+    }
+
+    for ( auto index = 0u; index < other.lines_.size() && isMonotone_; ++index ) {
+        add( LineNumber( other.lines_[ index ] ), other.timestamps_[ index ] );
+    }
+}
+
+std::pair<LineNumber, LineNumber> TimestampIndex::findRange( int64_t timestamp,
+                                                             LinesCount nbLines ) const
+{
+    const auto next = std::lower_bound( timestamps_.begin(), timestamps_.end(), timestamp );
+    const auto nextIndex = static_cast<size_t>( std::distance( timestamps_.begin(), next ) );
+
+    const auto rangeStart = nextIndex > 0 ? LineNumber( lines_[ nextIndex - 1 ] ) : 0_lnum;
+    const auto rangeEnd = nextIndex < lines_.size() ? LineNumber( lines_[ nextIndex ] )
+                                                    : LineNumber( nbLines.get() );
+    return { rangeStart, rangeEnd };
+}
+
+void TimestampIndex::clear()
+{
+    format_.clear();
+    lines_.clear();
+    timestamps_.clear();
+    isMonotone_ = true;
+}
+
+size_t TimestampIndex::allocatedSize() const
+{
+    return lines_.capacity() * sizeof( LineNumber::UnderlyingType )
+           + timestamps_.capacity() * sizeof( int64_t );
+}
+
+TimestampExtractor::TimestampExtractor( const QStringList& formats, LineNumber nextLine )
+    : nextLine_( nextLine.get() )
+{
+    for ( const auto& format : formats ) {
+        TimestampParser parser( format );
+        if ( parser.isValid() ) {
+            candidates_.push_back( std::move( parser ) );
+        }
+    }
+}
+
+TimestampExtractor::TimestampExtractor( const TimestampParser& parser, LineNumber nextLine )
+    : parser_( parser )
+    , nextLine_( nextLine.get() )
+{
+}
+
+void TimestampExtractor::extract( LineNumber line, std::string_view data,
+                                  TimestampIndex& timestamps )
+{
+    if ( !parser_ ) {
+        if ( line.get() >= DetectionLines ) {
+            LOG_INFO << "No known timestamp format found";
+            candidates_.clear();
+            return;
+        }
+
+        const auto detected
+            = std::find_if( candidates_.begin(), candidates_.end(),
+                            [ data ]( const auto& candidate ) { return candidate.parse( data ); } );
+        if ( detected == candidates_.end() ) {
+            return;
+        }
+
+        LOG_INFO << "Detected timestamp format " << detected->format();
+        parser_ = *detected;
+        candidates_.clear();
+    }
+
+    if ( timestamps.format().isEmpty() ) {
+        timestamps.setFormat( parser_->format() );
+    }
+
+    if ( const auto timestamp = parser_->parse( data ) ) {
+        timestamps.add( line, *timestamp );
+        nextLine_ = line.get() + TimestampIndex::Stride;
+    }
+}
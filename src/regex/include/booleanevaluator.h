@@ -17,18 +17,92 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef KLOGG_BOOLEAN_EVALUATOR_H
+#define KLOGG_BOOLEAN_EVALUATOR_H
+
 #include <exprtk.hpp>
+#include <cstdint>
+#include <memory>
 #include <string_view>
+#include <unordered_map>
 
 #include "containers.h"
 
 #include "regularexpressionpattern.h"
 
+class BooleanExpressionEvaluator;
+
+// Boolean expression over a small number of sub-patterns compiled
+// to a truth table and a reduced ordered decision diagram.
+// It is immutable and can be shared between matchers.
+class CompiledBooleanExpression {
+  public:
+    static constexpr size_t MaxPatterns = 16;
+
+    // Patterns are tested by decision diagram in evaluationOrder,
+    // so cheap patterns should go first.
+    CompiledBooleanExpression( BooleanExpressionEvaluator& evaluator,
+                               const klogg::vector<size_t>& evaluationOrder );
+
+    size_t patternsCount() const
+    {
+        return patternsCount_;
+    }
+
+    size_t nodesCount() const
+    {
+        return nodes_.size();
+    }
+
+    bool evaluate( std::string_view variables ) const;
+
+    // Walks decision diagram asking for pattern results only when they
+    // can change the outcome. isPatternMatched is called at most once
+    // for each pattern.
+    template <typename IsPatternMatched>
+    bool evaluateLazy( IsPatternMatched&& isPatternMatched ) const
+    {
+        auto node = root_;
+        while ( node != FalseNode && node != TrueNode ) {
+            const auto& decision = nodes_[ node ];
+            node = isPatternMatched( decision.pattern ) ? decision.high : decision.low;
+        }
+        return node == TrueNode;
+    }
+
+  private:
+    using UniqueNodes = std::unordered_map<uint64_t, uint32_t>;
+    uint32_t buildNode( size_t level, uint32_t combination, UniqueNodes& uniqueNodes );
+
+    bool lookup( uint32_t combination ) const;
+
+  private:
+    struct Node {
+        uint32_t pattern;
+        uint32_t low;
+        uint32_t high;
+    };
+
+    static constexpr uint32_t FalseNode = 0;
+    static constexpr uint32_t TrueNode = 1;
+
+    size_t patternsCount_ = 0;
+    klogg::vector<size_t> evaluationOrder_;
+
+    klogg::vector<uint64_t> truthTable_;
+    klogg::vector<Node> nodes_;
+    uint32_t root_ = FalseNode;
+};
+
 class BooleanExpressionEvaluator {
   public:
     BooleanExpressionEvaluator( const std::string& expression,
                                 const klogg::vector<RegularExpressionPattern>& patterns );
 
+    // Uses already compiled expression, exprtk is not involved.
+    explicit BooleanExpressionEvaluator(
+        std::shared_ptr<const CompiledBooleanExpression> compiled );
+
     bool isValid() const
     {
         return isValid_;
@@ -41,17 +115,36 @@ class BooleanExpressionEvaluator {
 
     bool evaluate( std::string_view variables );
 
+    template <typename IsPatternMatched>
+    bool evaluateLazy( IsPatternMatched&& isPatternMatched )
+    {
+        if ( compiled_ ) {
+            return compiled_->evaluateLazy( std::forward<IsPatternMatched>( isPatternMatched ) );
+        }
+
+        std::string variables( variables_.size(), 0 );
+        for ( auto index = 0u; index < variables.size(); ++index ) {
+            variables[ index ] = isPatternMatched( index );
+        }
+        return evaluate( variables );
+    }
+
+    std::shared_ptr<const CompiledBooleanExpression>
+    compile( const klogg::vector<size_t>& evaluationOrder );
+
   private:
     bool isValid_ = true;
     std::string errorString_;
 
-    
-
     exprtk::symbol_table<double> symbols_;
     exprtk::expression<double> expression_;
     exprtk::parser<double> parser_;
 
     klogg::vector<double*> variables_;
 
-    double precomputedResults_[16];
-};
\ No newline at end of file
+    std::shared_ptr<const CompiledBooleanExpression> compiled_;
+
+    friend class CompiledBooleanExpression;
+};
+
+#endif
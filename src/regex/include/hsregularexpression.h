@@ -40,6 +40,7 @@
 #endif
 
 #include "regularexpressionpattern.h"
+#include "requiredliterals.h"
 
 using MatchedPatterns = std::string;
 
@@ -51,25 +52,41 @@ class DefaultRegularExpressionMatcher {
         std::transform(
             patterns.cbegin(), patterns.cend(), std::back_inserter( regexp_ ),
             []( const auto& pattern ) { return static_cast<QRegularExpression>( pattern ); } );
+        std::transform( patterns.cbegin(), patterns.cend(), std::back_inserter( literals_ ),
+                        []( const auto& pattern ) { return RequiredLiterals( pattern ); } );
     }
 
     MatchedPatterns match( const std::string_view& utf8Data ) const
     {
         MatchedPatterns matchedPatterns( regexp_.size(), 0 );
-        std::transform( regexp_.cbegin(), regexp_.cend(), matchedPatterns.begin(),
-                        [ utf8Data ]( const auto& regexp ) {
-                            return regexp
-                                .match(
-                                    QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) ) )
-                                .hasMatch();
-                            ;
-                        } );
+
+        // Line is converted only if some pattern passes literals check
+        QString utf16Data;
+        for ( auto index = 0u; index < regexp_.size(); ++index ) {
+            matchedPatterns[ index ] = matchPattern( index, utf8Data, utf16Data );
+        }
 
         return matchedPatterns;
     }
 
+    // Matches only one pattern. utf16Data is a conversion cache
+    // shared between calls for the same line, null until first used.
+    bool matchPattern( size_t index, const std::string_view& utf8Data, QString& utf16Data ) const
+    {
+        if ( !literals_[ index ].mayMatch( utf8Data ) ) {
+            return false;
+        }
+
+        if ( utf16Data.isNull() ) {
+            utf16Data = QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) );
+        }
+
+        return regexp_[ index ].match( utf16Data ).hasMatch();
+    }
+
   private:
     klogg::vector<QRegularExpression> regexp_;
+    klogg::vector<RequiredLiterals> literals_;
 };
 
 #ifdef KLOGG_HAS_HS
@@ -133,9 +150,17 @@ class HsPrefilterMatcher {
     HsPrefilterMatcher(const klogg::vector<RegularExpressionPattern>& patterns, HsMultiMatcher&& hsMatcher);
 
     MatchedPatterns match( const std::string_view& utf8Data ) const;
-  
+
+    // Hyperscan prefilter pass, may have false positives
+    MatchedPatterns prefilter( const std::string_view& utf8Data ) const;
+    // Exact check of one pattern that passed prefilter
+    bool confirmPattern( size_t index, const std::string_view& utf8Data,
+                         QString& utf16Data ) const;
+
   private:
     klogg::vector<RegularExpressionPattern> patterns_;
+    klogg::vector<QRegularExpression> regexp_;
+    klogg::vector<RequiredLiterals> literals_;
     HsMultiMatcher hsMatcher_;
 };
 
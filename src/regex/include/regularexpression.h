@@ -21,6 +21,7 @@
 #define KLOGG_PATTERN_MATHCHER_H
 
 #include <memory>
+#include <optional>
 #include <qchar.h>
 #include <string_view>
 #include <unordered_map>
@@ -31,11 +32,13 @@
 
 #include "hsregularexpression.h"
 #include "regularexpressionpattern.h"
+#include "requiredliterals.h"
 
 
 class PatternMatcher;
 class MultiPatternMatcher;
 class BooleanExpressionEvaluator;
+class CompiledBooleanExpression;
 
 class RegularExpression {
   public:
@@ -57,6 +60,8 @@ class RegularExpression {
     QString errorString_;
 
     HsRegularExpression hsExpression_;
+    RequiredLiterals requiredLiterals_;
+    std::shared_ptr<const CompiledBooleanExpression> compiledExpression_;
 
     friend class PatternMatcher;
 };
@@ -68,6 +73,11 @@ class PatternMatcher {
 
     bool hasMatch( std::string_view line ) const;
 
+    // Checks whole block of lines against literals required by the pattern.
+    // If a literal is absent, every line in the block has the same result,
+    // which is returned. Otherwise lines have to be matched one by one.
+    std::optional<bool> precheckBlock( std::string_view utf8Block ) const;
+
   private:
     using MatchFunc = bool ( * )( std::string_view line, const MatcherVariant& matcher, BooleanExpressionEvaluator* evaluator );
     MatchFunc hasMatchImpl_;
@@ -80,6 +90,8 @@ class PatternMatcher {
 
     MatcherVariant matcher_;
     std::unique_ptr<BooleanExpressionEvaluator> evaluator_;
+
+    RequiredLiterals requiredLiterals_;
 };
 
 class MultiRegularExpression {
@@ -109,6 +121,10 @@ class MultiPatternMatcher {
 
     klogg::vector<std::pair<RegularExpressionPattern, bool>> match( std::string_view line ) const;
 
+    // Non-zero element i means that pattern i matches the line,
+    // exclude flags of the patterns are not applied.
+    MatchedPatterns matchingPatterns( std::string_view line ) const;
+
   private:
     MatcherVariant matcher_;
     klogg::vector<RegularExpressionPattern> patterns_;
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_REQUIRED_LITERALS_H
+#define KLOGG_REQUIRED_LITERALS_H
+
+#include <string>
+#include <string_view>
+
+#include <QString>
+
+#include "containers.h"
+
+#include "regularexpressionpattern.h"
+
+// Returns literal strings that must be present in any text matched by the
+// regular expression. Analysis is conservative: for any construct that is
+// not understood the function gives up and returns less (or no) literals.
+klogg::vector<QString> extractRequiredLiterals( const QString& regexPattern );
+
+// Searches for one literal in utf8 data, optionally ignoring ASCII case.
+class LiteralSearcher {
+  public:
+    LiteralSearcher( std::string literal, bool isCaseSensitive );
+
+    bool isFoundIn( std::string_view utf8Data ) const;
+
+    const std::string& literal() const
+    {
+        return literal_;
+    }
+
+  private:
+    bool equalsAt( const char* data ) const;
+
+  private:
+    std::string literal_;
+    bool isCaseSensitive_ = true;
+
+    char firstLower_ = 0;
+    char firstUpper_ = 0;
+    char lastLower_ = 0;
+    char lastUpper_ = 0;
+};
+
+// Set of literals required by a pattern. If any of the literals
+// is absent in the data, the pattern can't match it.
+class RequiredLiterals {
+  public:
+    RequiredLiterals() = default;
+    explicit RequiredLiterals( const RegularExpressionPattern& pattern );
+
+    bool isEmpty() const
+    {
+        return literals_.empty();
+    }
+
+    bool mayMatch( std::string_view utf8Data ) const
+    {
+        for ( const auto& literal : literals_ ) {
+            if ( !literal.isFoundIn( utf8Data ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+  private:
+    klogg::vector<LiteralSearcher> literals_;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SPAN_REGULAR_EXPRESSION_H
+#define KLOGG_SPAN_REGULAR_EXPRESSION_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include <QRegularExpression>
+#include <QString>
+
+#include "containers.h"
+#include "hsregularexpression.h"
+#include "regularexpressionpattern.h"
+
+// Match of pattern id at columns [from, to) of a line
+struct MatchedSpan {
+    unsigned id;
+    size_t from;
+    size_t to;
+};
+
+using MatchedSpans = klogg::vector<MatchedSpan>;
+
+class SpanMatcher;
+
+// Plain text patterns whose matches are found with their positions in one
+// scan of a line. Hyperscan database is compiled with HS_FLAG_SOM_LEFTMOST,
+// so the callback gets start and end of each match and there is no need to
+// run QRegularExpression to find them. Patterns are matched one by one with
+// QRegularExpression if Hyperscan is not available or fails to compile them.
+class SpanRegularExpression {
+  public:
+    explicit SpanRegularExpression( const klogg::vector<RegularExpressionPattern>& patterns );
+
+    SpanRegularExpression( const SpanRegularExpression& ) = delete;
+    SpanRegularExpression& operator=( const SpanRegularExpression& ) = delete;
+
+    std::unique_ptr<SpanMatcher> createMatcher() const;
+
+    size_t size() const
+    {
+        return patterns_.size();
+    }
+
+  private:
+    klogg::vector<RegularExpressionPattern> patterns_;
+
+#ifdef KLOGG_HAS_HS
+    HsDatabase database_;
+    HsScratch scratch_;
+#endif
+
+    friend class SpanMatcher;
+};
+
+// Finds non-overlapping matches of each pattern, same as the ones
+// QRegularExpression::globalMatch returns for plain text patterns.
+// Not thread safe, each thread needs its own matcher.
+class SpanMatcher {
+  public:
+    explicit SpanMatcher( const SpanRegularExpression& expression );
+
+    // Spans are sorted by pattern id and then by start column.
+    // utf8Line has to be the UTF-8 encoding of line.
+    const MatchedSpans& match( const QString& line, std::string_view utf8Line );
+
+    // Non-zero element i means that pattern i matches the line,
+    // for callers that don't need positions of the matches
+    MatchedPatterns matchingPatterns( std::string_view utf8Line );
+
+  private:
+    void matchPatterns( const QString& line );
+
+#ifdef KLOGG_HAS_HS
+    bool scan( std::string_view utf8Line );
+    void removeOverlappingSpans();
+    void convertToColumns( std::string_view utf8Line, size_t utf16Size );
+#endif
+
+  private:
+    klogg::vector<QRegularExpression> regexp_;
+
+#ifdef KLOGG_HAS_HS
+    HsDatabase database_;
+    HsScratch scratch_;
+    klogg::vector<size_t*> offsets_;
+#endif
+
+    MatchedSpans spans_;
+};
+
+#endif
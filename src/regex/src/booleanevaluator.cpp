@@ -20,15 +20,13 @@
 #include "booleanevaluator.h"
 
 #include <string>
+#include <utility>
 
 #include "log.h"
 
 namespace {
 
-static constexpr size_t MaxPrecomputedPatterns = 4;
-static constexpr size_t PrecomputedCombinations[] = { 0, 2, 4, 8, 16 };
-
-bool isBitSet( unsigned num, unsigned bit )
+bool isBitSet( uint32_t num, size_t bit )
 {
     return 1 == ( ( num >> bit ) & 1 );
 }
@@ -47,6 +45,73 @@ uint32_t buildPatternCombination( std::string_view variables )
 
 } // namespace
 
+CompiledBooleanExpression::CompiledBooleanExpression(
+    BooleanExpressionEvaluator& evaluator, const klogg::vector<size_t>& evaluationOrder )
+    : patternsCount_( evaluator.variables_.size() )
+    , evaluationOrder_( evaluationOrder )
+{
+    const auto combinationsCount = uint32_t{ 1 } << patternsCount_;
+    truthTable_.resize( ( combinationsCount + 63 ) / 64 );
+
+    for ( auto combination = 0u; combination < combinationsCount; ++combination ) {
+        for ( auto p = 0u; p < patternsCount_; ++p ) {
+            *evaluator.variables_[ p ] = isBitSet( combination, p );
+        }
+        if ( evaluator.expression_.value() > 0 ) {
+            truthTable_[ combination / 64 ] |= uint64_t{ 1 } << ( combination % 64 );
+        }
+    }
+
+    // Terminal nodes
+    nodes_.push_back( Node{ 0, FalseNode, FalseNode } );
+    nodes_.push_back( Node{ 0, TrueNode, TrueNode } );
+
+    UniqueNodes uniqueNodes;
+    root_ = buildNode( 0, 0, uniqueNodes );
+
+    LOG_INFO << "Compiled boolean expression for " << patternsCount_ << " patterns, "
+             << nodes_.size() << " decision nodes";
+}
+
+uint32_t CompiledBooleanExpression::buildNode( size_t level, uint32_t combination,
+                                               UniqueNodes& uniqueNodes )
+{
+    if ( level == evaluationOrder_.size() ) {
+        return lookup( combination ) ? TrueNode : FalseNode;
+    }
+
+    const auto pattern = static_cast<uint32_t>( evaluationOrder_[ level ] );
+    const auto low = buildNode( level + 1, combination, uniqueNodes );
+    const auto high = buildNode( level + 1, combination | ( 1u << pattern ), uniqueNodes );
+
+    if ( low == high ) {
+        return low;
+    }
+
+    // Nodes are built bottom-up, so equal subgraphs get equal ids
+    // if each (pattern, low, high) triple is stored only once.
+    const auto key = ( uint64_t{ pattern } << 48 ) | ( uint64_t{ low } << 24 ) | high;
+    const auto existing = uniqueNodes.find( key );
+    if ( existing != uniqueNodes.end() ) {
+        return existing->second;
+    }
+
+    const auto node = static_cast<uint32_t>( nodes_.size() );
+    nodes_.push_back( Node{ pattern, low, high } );
+    uniqueNodes.emplace( key, node );
+    return node;
+}
+
+bool CompiledBooleanExpression::lookup( uint32_t combination ) const
+{
+    return ( ( truthTable_[ combination / 64 ] >> ( combination % 64 ) ) & 1 ) == 1;
+}
+
+bool CompiledBooleanExpression::evaluate( std::string_view variables ) const
+{
+    return lookup( buildPatternCombination( variables ) );
+}
+
 BooleanExpressionEvaluator::BooleanExpressionEvaluator(
     const std::string& expression, const klogg::vector<RegularExpressionPattern>& patterns )
 {
@@ -65,22 +130,35 @@ BooleanExpressionEvaluator::BooleanExpressionEvaluator(
         exprtk::parser_error::update_error( error, expression );
         errorString_ = error.diagnostic + " at " + std::to_string( error.column_no );
     }
-    else if ( patterns.size() <= MaxPrecomputedPatterns ) {
-        const auto patternVariants = PrecomputedCombinations[ patterns.size() ];
-        for ( auto patternCombination = 0u; patternCombination < patternVariants;
-              ++patternCombination ) {
-            for ( auto p = 0u; p < patterns.size(); ++p ) {
-                *variables_[ p ] = isBitSet( patternCombination, p );
-            }
-            precomputedResults_[ patternCombination ] = expression_.value();
-            LOG_INFO << "precomputed result for " << patternCombination << " is "
-                     << ( precomputedResults_[ patternCombination ] > 0 );
-        }
+}
+
+BooleanExpressionEvaluator::BooleanExpressionEvaluator(
+    std::shared_ptr<const CompiledBooleanExpression> compiled )
+    : compiled_( std::move( compiled ) )
+{
+}
+
+std::shared_ptr<const CompiledBooleanExpression>
+BooleanExpressionEvaluator::compile( const klogg::vector<size_t>& evaluationOrder )
+{
+    if ( !isValid() || variables_.size() > CompiledBooleanExpression::MaxPatterns
+         || evaluationOrder.size() != variables_.size() ) {
+        return {};
     }
+
+    return std::make_shared<const CompiledBooleanExpression>( *this, evaluationOrder );
 }
 
 bool BooleanExpressionEvaluator::evaluate( std::string_view variables )
 {
+    if ( compiled_ ) {
+        if ( compiled_->patternsCount() != variables.size() ) {
+            LOG_ERROR << "Wrong number of matched patterns";
+            return false;
+        }
+        return compiled_->evaluate( variables );
+    }
+
     if ( !isValid() ) {
         return false;
     }
@@ -90,11 +168,6 @@ bool BooleanExpressionEvaluator::evaluate( std::string_view variables )
         return false;
     }
 
-    if ( variables.size() <= MaxPrecomputedPatterns ) {
-        const auto patternCombination = buildPatternCombination( variables );
-        return precomputedResults_[ patternCombination ] > 0;
-    }
-
     for ( auto index = 0u; index < variables_.size(); ++index ) {
         *variables_[ index ] = variables[ index ];
     }
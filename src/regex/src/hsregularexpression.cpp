@@ -122,18 +122,40 @@ HsPrefilterMatcher::HsPrefilterMatcher( const klogg::vector<RegularExpressionPat
     , hsMatcher_( std::move( hsMatcher ) )
 
 {
+    std::transform(
+        patterns_.cbegin(), patterns_.cend(), std::back_inserter( regexp_ ),
+        []( const auto& pattern ) { return static_cast<QRegularExpression>( pattern ); } );
+    std::transform( patterns_.cbegin(), patterns_.cend(), std::back_inserter( literals_ ),
+                    []( const auto& pattern ) { return RequiredLiterals( pattern ); } );
+}
+
+MatchedPatterns HsPrefilterMatcher::prefilter( const std::string_view& utf8Data ) const
+{
+    return hsMatcher_.match( utf8Data );
+}
+
+bool HsPrefilterMatcher::confirmPattern( size_t index, const std::string_view& utf8Data,
+                                         QString& utf16Data ) const
+{
+    if ( !literals_[ index ].mayMatch( utf8Data ) ) {
+        return false;
+    }
+
+    if ( utf16Data.isNull() ) {
+        utf16Data = QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) );
+    }
+
+    return regexp_[ index ].match( utf16Data ).hasMatch();
 }
 
 MatchedPatterns HsPrefilterMatcher::match( const std::string_view& utf8Data ) const
 {
-    MatchedPatterns matchingPatterns = hsMatcher_.match( utf8Data );
+    MatchedPatterns matchingPatterns = prefilter( utf8Data );
 
+    QString utf16Data;
     for ( size_t i = 0u; i < matchingPatterns.size(); ++i ) {
         if ( matchingPatterns[ i ] ) {
-            matchingPatterns[ i ]
-                = static_cast<QRegularExpression>( patterns_[ i ] )
-                      .match( QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) ) )
-                      .hasMatch();
+            matchingPatterns[ i ] = confirmPattern( i, utf8Data, utf16Data );
         }
     }
 
@@ -19,7 +19,9 @@
 
 #include <algorithm>
 #include <exception>
+#include <iterator>
 #include <memory>
+#include <numeric>
 #include <qregularexpression.h>
 #include <string>
 #include <variant>
@@ -108,6 +110,29 @@ parseBooleanExpressions( QString& pattern, bool isCaseSensitive, bool isPlainTex
     return subPatterns;
 }
 
+// Plain text is cheaper to check than regex, and regex with required
+// literals is usually rejected before running the regex engine.
+klogg::vector<size_t> cheapestFirstOrder( const klogg::vector<RegularExpressionPattern>& patterns )
+{
+    klogg::vector<int> costs;
+    costs.reserve( patterns.size() );
+    std::transform( patterns.cbegin(), patterns.cend(), std::back_inserter( costs ),
+                    []( const auto& pattern ) {
+                        if ( pattern.isPlainText ) {
+                            return 0;
+                        }
+                        return RequiredLiterals( pattern ).isEmpty() ? 2 : 1;
+                    } );
+
+    klogg::vector<size_t> order( patterns.size() );
+    std::iota( order.begin(), order.end(), 0u );
+    std::stable_sort( order.begin(), order.end(), [ &costs ]( const auto& lhs, const auto& rhs ) {
+        return costs[ lhs ] < costs[ rhs ];
+    } );
+
+    return order;
+}
+
 } // namespace
 
 RegularExpression::RegularExpression( const RegularExpressionPattern& pattern )
@@ -126,10 +151,13 @@ RegularExpression::RegularExpression( const RegularExpressionPattern& pattern )
                 errorString_ = QString::fromStdString( evaluator.errorString() );
                 return;
             }
+
+            compiledExpression_ = evaluator.compile( cheapestFirstOrder( subPatterns_ ) );
         }
         else {
             subPatterns_.emplace_back( pattern );
             expression_ = QString::fromStdString( subPatterns_.front().id() );
+            requiredLiterals_ = RequiredLiterals( pattern );
         }
 
         hsExpression_ = HsRegularExpression( subPatterns_ );
@@ -168,11 +196,52 @@ bool hasSingleMatch( std::string_view line, const MatcherVariant& matcher,
     return !result.empty() && result[ 0 ] > 0;
 }
 
+template <typename Matcher>
+bool evaluateCombination( std::string_view line, const Matcher& matcher,
+                          BooleanExpressionEvaluator& evaluator )
+{
+    return evaluator.evaluate( matcher.match( line ) );
+}
+
+// Engines that check patterns one by one run only patterns
+// that can still change the result of the expression
+bool evaluateCombination( std::string_view line, const DefaultRegularExpressionMatcher& matcher,
+                          BooleanExpressionEvaluator& evaluator )
+{
+    QString utf16Line;
+    return evaluator.evaluateLazy( [ &matcher, &line, &utf16Line ]( size_t index ) {
+        return matcher.matchPattern( index, line, utf16Line );
+    } );
+}
+
+#ifdef KLOGG_HAS_HS
+bool evaluateCombination( std::string_view line, const HsPrefilterMatcher& matcher,
+                          BooleanExpressionEvaluator& evaluator )
+{
+    const auto candidates = matcher.prefilter( line );
+    if ( candidates.empty() ) {
+        return evaluator.evaluate( candidates );
+    }
+
+    QString utf16Line;
+    return evaluator.evaluateLazy( [ &matcher, &candidates, &line, &utf16Line ]( size_t index ) {
+        return candidates[ index ] && matcher.confirmPattern( index, line, utf16Line );
+    } );
+}
+#endif
+
 bool hasCombinedMatch( std::string_view line, const MatcherVariant& matcher,
                        BooleanExpressionEvaluator* evaluator )
 {
-    auto result = std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher );
-    return evaluator && evaluator->evaluate( result );
+    if ( !evaluator ) {
+        return false;
+    }
+
+    return std::visit(
+        [ &line, evaluator ]( const auto& m ) {
+            return evaluateCombination( line, m, *evaluator );
+        },
+        matcher );
 }
 
 bool hasInverseSingleMatch( std::string_view line, const MatcherVariant& matcher,
@@ -194,6 +263,7 @@ PatternMatcher::PatternMatcher( const RegularExpression& expression )
     , isBooleanCombination_( expression.isBooleanCombination_ )
     , mainPatternId_( expression.subPatterns_.front().id() )
     , matcher_( expression.hsExpression_.createMatcher() )
+    , requiredLiterals_( expression.requiredLiterals_ )
 {
     const auto& config = Configuration::get();
     const auto useHyperscanEngine = config.regexpEngine() == RegexpEngine::Hyperscan;
@@ -202,8 +272,14 @@ PatternMatcher::PatternMatcher( const RegularExpression& expression )
     }
 
     if ( expression.isBooleanCombination_ ) {
-        evaluator_ = std::make_unique<BooleanExpressionEvaluator>(
-            expression.expression_.toStdString(), expression.subPatterns_ );
+        if ( expression.compiledExpression_ ) {
+            evaluator_
+                = std::make_unique<BooleanExpressionEvaluator>( expression.compiledExpression_ );
+        }
+        else {
+            evaluator_ = std::make_unique<BooleanExpressionEvaluator>(
+                expression.expression_.toStdString(), expression.subPatterns_ );
+        }
     }
 
     if ( !isBooleanCombination_ ) {
@@ -221,6 +297,15 @@ bool PatternMatcher::hasMatch( std::string_view line ) const
     return hasMatchImpl_( line, matcher_, evaluator_.get() );
 }
 
+std::optional<bool> PatternMatcher::precheckBlock( std::string_view utf8Block ) const
+{
+    if ( requiredLiterals_.isEmpty() || requiredLiterals_.mayMatch( utf8Block ) ) {
+        return {};
+    }
+
+    return isInverse_;
+}
+
 MultiRegularExpression::MultiRegularExpression(
     const klogg::vector<RegularExpressionPattern>& patterns )
     : patterns_( patterns )
@@ -245,15 +330,24 @@ MultiPatternMatcher::MultiPatternMatcher( const MultiRegularExpression& expressi
     : matcher_( expression.hsExpression_.createMatcher() )
     , patterns_( expression.patterns_ )
 {
+    const auto& config = Configuration::get();
+    const auto useHyperscanEngine = config.regexpEngine() == RegexpEngine::Hyperscan;
+    if ( !useHyperscanEngine ) {
+        matcher_ = DefaultRegularExpressionMatcher( patterns_ );
+    }
 }
 
 MultiPatternMatcher::~MultiPatternMatcher() = default;
 
+MatchedPatterns MultiPatternMatcher::matchingPatterns( std::string_view line ) const
+{
+    return std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher_ );
+}
+
 klogg::vector<std::pair<RegularExpressionPattern, bool>>
 MultiPatternMatcher::match( std::string_view line ) const
 {
-    const auto result
-        = std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher_ );
+    const auto result = matchingPatterns( line );
 
     klogg::vector<std::pair<RegularExpressionPattern, bool>> matchedPatterns;
     for ( size_t i = 0u; i < result.size(); ++i ) {
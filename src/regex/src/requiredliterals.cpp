@@ -0,0 +1,506 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define KLOGG_LITERALS_USE_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "log.h"
+
+#include "requiredliterals.h"
+
+namespace {
+
+// Literals shorter than this are not selective enough to pay for the scan
+constexpr size_t MinRequiredLiteralLength = 3;
+// Each additional literal is another pass over the data
+constexpr size_t MaxRequiredLiterals = 2;
+
+struct Quantifier {
+    int minCount;
+    int end;
+};
+
+bool isAsciiDigit( QChar c )
+{
+    return c >= QChar( '0' ) && c <= QChar( '9' );
+}
+
+bool isAsciiHexDigit( QChar c )
+{
+    return c.unicode() < 128 && std::isxdigit( c.unicode() );
+}
+
+bool isAsciiAlnum( QChar c )
+{
+    return c.unicode() < 128 && c.isLetterOrNumber();
+}
+
+std::optional<Quantifier> parseQuantifier( const QString& pattern, int pos )
+{
+    const auto c = pattern[ pos ];
+    if ( c == QChar( '*' ) || c == QChar( '?' ) ) {
+        return Quantifier{ 0, pos + 1 };
+    }
+    if ( c == QChar( '+' ) ) {
+        return Quantifier{ 1, pos + 1 };
+    }
+    if ( c != QChar( '{' ) ) {
+        return {};
+    }
+
+    // {n}, {n,}, {n,m} and {,m}
+    auto current = pos + 1;
+    int minCount = 0;
+    bool hasDigits = false;
+    while ( current < pattern.size() && isAsciiDigit( pattern[ current ] ) ) {
+        minCount = std::min( minCount * 10 + pattern[ current ].digitValue(), 1000 );
+        hasDigits = true;
+        ++current;
+    }
+    if ( current < pattern.size() && pattern[ current ] == QChar( ',' ) ) {
+        ++current;
+        while ( current < pattern.size() && isAsciiDigit( pattern[ current ] ) ) {
+            hasDigits = true;
+            ++current;
+        }
+    }
+    if ( !hasDigits || current >= pattern.size() || pattern[ current ] != QChar( '}' ) ) {
+        return {};
+    }
+
+    return Quantifier{ minCount, current + 1 };
+}
+
+int skipDelimited( const QString& pattern, int pos, QChar closing )
+{
+    const auto end = pattern.indexOf( closing, pos + 1 );
+    return end < 0 ? type_safe::narrow_cast<int>( pattern.size() )
+                   : type_safe::narrow_cast<int>( end + 1 );
+}
+
+// pos points to the char after backslash, returns position after the escape
+int skipEscape( const QString& pattern, int pos )
+{
+    const auto size = type_safe::narrow_cast<int>( pattern.size() );
+    if ( pos >= size ) {
+        return size;
+    }
+
+    const auto c = pattern[ pos ].toLatin1();
+    ++pos;
+
+    if ( pos < size ) {
+        const auto next = pattern[ pos ];
+        if ( c != '\0' && next == QChar( '{' ) && std::strchr( "xpPNgko", c ) ) {
+            return skipDelimited( pattern, pos, QChar( '}' ) );
+        }
+        if ( c != '\0' && next == QChar( '<' ) && std::strchr( "gk", c ) ) {
+            return skipDelimited( pattern, pos, QChar( '>' ) );
+        }
+        if ( c != '\0' && next == QChar( '\'' ) && std::strchr( "gk", c ) ) {
+            return skipDelimited( pattern, pos, QChar( '\'' ) );
+        }
+    }
+
+    switch ( c ) {
+    case 'x':
+        for ( auto i = 0; i < 2 && pos < size && isAsciiHexDigit( pattern[ pos ] ); ++i ) {
+            ++pos;
+        }
+        break;
+    case 'c':
+    case 'p':
+    case 'P':
+        pos = std::min( pos + 1, size );
+        break;
+    case 'g':
+        if ( pos < size && ( pattern[ pos ] == QChar( '-' ) || pattern[ pos ] == QChar( '+' ) ) ) {
+            ++pos;
+        }
+        while ( pos < size && isAsciiDigit( pattern[ pos ] ) ) {
+            ++pos;
+        }
+        break;
+    default:
+        if ( c >= '0' && c <= '9' ) {
+            while ( pos < size && isAsciiDigit( pattern[ pos ] ) ) {
+                ++pos;
+            }
+        }
+        break;
+    }
+
+    return pos;
+}
+
+// pos points to '[', returns position after the closing ']'
+int skipCharacterClass( const QString& pattern, int pos )
+{
+    const auto size = type_safe::narrow_cast<int>( pattern.size() );
+    ++pos;
+    if ( pos < size && pattern[ pos ] == QChar( '^' ) ) {
+        ++pos;
+    }
+    // ']' right after the opening bracket is a literal
+    if ( pos < size && pattern[ pos ] == QChar( ']' ) ) {
+        ++pos;
+    }
+
+    while ( pos < size ) {
+        const auto c = pattern[ pos ];
+        if ( c == QChar( '\\' ) ) {
+            pos += 2;
+        }
+        else if ( c == QChar( '[' ) && pos + 1 < size && pattern[ pos + 1 ] == QChar( ':' ) ) {
+            const auto end = pattern.indexOf( QLatin1String( ":]" ), pos + 2 );
+            pos = end < 0 ? size : type_safe::narrow_cast<int>( end + 2 );
+        }
+        else if ( c == QChar( ']' ) ) {
+            return pos + 1;
+        }
+        else {
+            ++pos;
+        }
+    }
+
+    return size;
+}
+
+// pos points to '(', returns position after the matching ')'
+int skipGroup( const QString& pattern, int pos )
+{
+    const auto size = type_safe::narrow_cast<int>( pattern.size() );
+    int depth = 0;
+    while ( pos < size ) {
+        const auto c = pattern[ pos ];
+        if ( c == QChar( '\\' ) ) {
+            pos += 2;
+        }
+        else if ( c == QChar( '[' ) ) {
+            pos = skipCharacterClass( pattern, pos );
+        }
+        else {
+            if ( c == QChar( '(' ) ) {
+                ++depth;
+            }
+            else if ( c == QChar( ')' ) && --depth == 0 ) {
+                return pos + 1;
+            }
+            ++pos;
+        }
+    }
+
+    return size;
+}
+
+void removeLastChar( QString& literal )
+{
+    if ( literal.isEmpty() ) {
+        return;
+    }
+
+    const auto charSize = ( literal.size() > 1 && literal.back().isLowSurrogate() ) ? 2 : 1;
+    literal.chop( charSize );
+}
+
+// Case insensitive matching is done only for ASCII, and even in ASCII
+// 'k' and 's' have non-ASCII case variants (Kelvin sign, long s).
+bool canMatchIgnoringAsciiCase( QChar c )
+{
+    if ( c.unicode() >= 128 ) {
+        return false;
+    }
+    const auto lower = c.toLower();
+    return lower != QChar( 'k' ) && lower != QChar( 's' );
+}
+
+klogg::vector<QString> splitForCaseInsensitiveSearch( const QString& literal )
+{
+    klogg::vector<QString> parts;
+    QString current;
+    for ( const auto c : literal ) {
+        if ( canMatchIgnoringAsciiCase( c ) ) {
+            current.append( c.toLower() );
+        }
+        else if ( !current.isEmpty() ) {
+            parts.push_back( std::exchange( current, {} ) );
+        }
+    }
+    if ( !current.isEmpty() ) {
+        parts.push_back( current );
+    }
+    return parts;
+}
+
+char toAsciiLower( char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>( c - 'A' + 'a' ) : c;
+}
+
+char toAsciiUpper( char c )
+{
+    return ( c >= 'a' && c <= 'z' ) ? static_cast<char>( c - 'a' + 'A' ) : c;
+}
+
+#ifdef KLOGG_LITERALS_USE_SSE2
+unsigned countTrailingZeros( unsigned mask )
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward( &index, mask );
+    return static_cast<unsigned>( index );
+#else
+    return static_cast<unsigned>( __builtin_ctz( mask ) );
+#endif
+}
+#endif
+
+} // namespace
+
+klogg::vector<QString> extractRequiredLiterals( const QString& regexPattern )
+{
+    // Inline options can change case sensitivity or enable extended syntax,
+    // quoted sequences can hide alternations from the simple parser below.
+    if ( regexPattern.contains( QLatin1String( "(?" ) )
+         || regexPattern.contains( QLatin1String( "\\Q" ) ) ) {
+        return {};
+    }
+
+    klogg::vector<QString> literals;
+    QString current;
+    bool lastAtomIsLiteral = false;
+
+    const auto finishLiteral = [ &literals, &current, &lastAtomIsLiteral ]() {
+        if ( !current.isEmpty() ) {
+            literals.push_back( std::exchange( current, {} ) );
+        }
+        lastAtomIsLiteral = false;
+    };
+
+    const auto size = type_safe::narrow_cast<int>( regexPattern.size() );
+    int pos = 0;
+    while ( pos < size ) {
+        const auto c = regexPattern[ pos ];
+
+        if ( const auto quantifier = parseQuantifier( regexPattern, pos ) ) {
+            if ( lastAtomIsLiteral && quantifier->minCount == 0 ) {
+                removeLastChar( current );
+            }
+            finishLiteral();
+            pos = quantifier->end;
+
+            // lazy and possessive modifiers
+            if ( pos < size
+                 && ( regexPattern[ pos ] == QChar( '?' )
+                      || regexPattern[ pos ] == QChar( '+' ) ) ) {
+                ++pos;
+            }
+            continue;
+        }
+
+        switch ( c.unicode() ) {
+        case '|':
+            // Alternation at top level: no literal is required
+            return {};
+        case ')':
+            // Unbalanced pattern, let regex engine report it
+            return {};
+        case '(':
+            finishLiteral();
+            pos = skipGroup( regexPattern, pos );
+            break;
+        case '[':
+            finishLiteral();
+            pos = skipCharacterClass( regexPattern, pos );
+            break;
+        case '\\':
+            if ( pos + 1 < size && !isAsciiAlnum( regexPattern[ pos + 1 ] )
+                 && !regexPattern[ pos + 1 ].isSurrogate() ) {
+                current.append( regexPattern[ pos + 1 ] );
+                lastAtomIsLiteral = true;
+                pos += 2;
+            }
+            else {
+                finishLiteral();
+                pos = skipEscape( regexPattern, pos + 1 );
+            }
+            break;
+        case '.':
+        case '^':
+        case '$':
+        case '{':
+        case '}':
+        case ']':
+            finishLiteral();
+            ++pos;
+            break;
+        default:
+            if ( c.isHighSurrogate() && pos + 1 < size
+                 && regexPattern[ pos + 1 ].isLowSurrogate() ) {
+                current.append( c );
+                current.append( regexPattern[ pos + 1 ] );
+                pos += 2;
+            }
+            else {
+                current.append( c );
+                ++pos;
+            }
+            lastAtomIsLiteral = true;
+            break;
+        }
+    }
+
+    finishLiteral();
+
+    return literals;
+}
+
+LiteralSearcher::LiteralSearcher( std::string literal, bool isCaseSensitive )
+    : literal_( std::move( literal ) )
+    , isCaseSensitive_( isCaseSensitive )
+{
+    if ( !isCaseSensitive_ ) {
+        std::transform( literal_.begin(), literal_.end(), literal_.begin(), toAsciiLower );
+    }
+
+    if ( !literal_.empty() ) {
+        firstLower_ = literal_.front();
+        lastLower_ = literal_.back();
+        firstUpper_ = isCaseSensitive_ ? firstLower_ : toAsciiUpper( firstLower_ );
+        lastUpper_ = isCaseSensitive_ ? lastLower_ : toAsciiUpper( lastLower_ );
+    }
+}
+
+bool LiteralSearcher::equalsAt( const char* data ) const
+{
+    if ( isCaseSensitive_ ) {
+        return std::memcmp( data, literal_.data(), literal_.size() ) == 0;
+    }
+
+    for ( auto i = 0u; i < literal_.size(); ++i ) {
+        if ( toAsciiLower( data[ i ] ) != literal_[ i ] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LiteralSearcher::isFoundIn( std::string_view utf8Data ) const
+{
+    const auto literalSize = literal_.size();
+    if ( literalSize == 0 ) {
+        return true;
+    }
+    if ( utf8Data.size() < literalSize ) {
+        return false;
+    }
+
+    const char* data = utf8Data.data();
+    const auto lastStart = utf8Data.size() - literalSize;
+    size_t pos = 0;
+
+#ifdef KLOGG_LITERALS_USE_SSE2
+    // Compare first and last bytes of the literal for 16 positions at once,
+    // full comparison is done only for candidates.
+    const auto firstLower = _mm_set1_epi8( firstLower_ );
+    const auto firstUpper = _mm_set1_epi8( firstUpper_ );
+    const auto lastLower = _mm_set1_epi8( lastLower_ );
+    const auto lastUpper = _mm_set1_epi8( lastUpper_ );
+
+    for ( ; pos + 16 <= lastStart + 1; pos += 16 ) {
+        const auto firstBytes
+            = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + pos ) );
+        const auto lastBytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>( data + pos + literalSize - 1 ) );
+
+        const auto firstMatches = _mm_or_si128( _mm_cmpeq_epi8( firstBytes, firstLower ),
+                                                _mm_cmpeq_epi8( firstBytes, firstUpper ) );
+        const auto lastMatches = _mm_or_si128( _mm_cmpeq_epi8( lastBytes, lastLower ),
+                                               _mm_cmpeq_epi8( lastBytes, lastUpper ) );
+
+        auto candidates = static_cast<unsigned>(
+            _mm_movemask_epi8( _mm_and_si128( firstMatches, lastMatches ) ) );
+
+        while ( candidates != 0 ) {
+            if ( equalsAt( data + pos + countTrailingZeros( candidates ) ) ) {
+                return true;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+#endif
+
+    for ( ; pos <= lastStart; ++pos ) {
+        const auto first = data[ pos ];
+        if ( ( first == firstLower_ || first == firstUpper_ ) && equalsAt( data + pos ) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+RequiredLiterals::RequiredLiterals( const RegularExpressionPattern& pattern )
+{
+    auto candidates = pattern.isPlainText ? klogg::vector<QString>{ pattern.pattern }
+                                          : extractRequiredLiterals( pattern.pattern );
+
+    if ( !pattern.isCaseSensitive ) {
+        klogg::vector<QString> caseInsensitiveCandidates;
+        for ( const auto& candidate : candidates ) {
+            const auto parts = splitForCaseInsensitiveSearch( candidate );
+            caseInsensitiveCandidates.insert( caseInsensitiveCandidates.end(), parts.begin(),
+                                              parts.end() );
+        }
+        candidates = std::move( caseInsensitiveCandidates );
+    }
+
+    klogg::vector<std::string> utf8Literals;
+    for ( const auto& candidate : candidates ) {
+        auto utf8Literal = candidate.toStdString();
+        if ( utf8Literal.size() >= MinRequiredLiteralLength ) {
+            utf8Literals.push_back( std::move( utf8Literal ) );
+        }
+    }
+
+    std::stable_sort(
+        utf8Literals.begin(), utf8Literals.end(),
+        []( const auto& lhs, const auto& rhs ) { return lhs.size() > rhs.size(); } );
+
+    if ( utf8Literals.size() > MaxRequiredLiterals ) {
+        utf8Literals.resize( MaxRequiredLiterals );
+    }
+
+    for ( auto& literal : utf8Literals ) {
+        LOG_DEBUG << "Required literal for " << pattern.pattern << ": " << literal;
+        literals_.emplace_back( std::move( literal ), pattern.isCaseSensitive );
+    }
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spanregularexpression.h"
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+
+#include <simdutf.h>
+
+#include "log.h"
+
+#ifdef KLOGG_HAS_HS
+#include "cpu_info.h"
+
+namespace {
+
+int collectSpanCallback( unsigned int id, unsigned long long from, unsigned long long to,
+                         unsigned int flags, void* context )
+{
+    Q_UNUSED( flags );
+
+    auto* spans = static_cast<MatchedSpans*>( context );
+    spans->push_back(
+        MatchedSpan{ id, static_cast<size_t>( from ), static_cast<size_t>( to ) } );
+
+    return 0;
+}
+
+hs_database_t* compileSpanDatabase( const klogg::vector<RegularExpressionPattern>& patterns )
+{
+    klogg::vector<QByteArray> utf8Patterns;
+    klogg::vector<const char*> patternPointers;
+    klogg::vector<unsigned> flags;
+    klogg::vector<unsigned> ids;
+
+    for ( auto index = 0u; index < patterns.size(); ++index ) {
+        const auto& pattern = patterns[ index ];
+        // Empty pattern matches nothing visible, and Hyperscan rejects it
+        if ( pattern.pattern.isEmpty() ) {
+            continue;
+        }
+
+        utf8Patterns.push_back( QRegularExpression::escape( pattern.pattern ).toUtf8() );
+
+        auto patternFlags = HS_FLAG_UTF8 | HS_FLAG_UCP | HS_FLAG_SOM_LEFTMOST;
+        if ( !pattern.isCaseSensitive ) {
+            patternFlags |= HS_FLAG_CASELESS;
+        }
+        flags.push_back( patternFlags );
+        ids.push_back( index );
+    }
+
+    if ( utf8Patterns.empty() ) {
+        return nullptr;
+    }
+
+    std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(),
+                    std::back_inserter( patternPointers ),
+                    []( const auto& utf8Pattern ) { return utf8Pattern.data(); } );
+
+    hs_database_t* db = nullptr;
+    hs_compile_error_t* error = nullptr;
+    const auto compileResult
+        = hs_compile_multi( patternPointers.data(), flags.data(), ids.data(),
+                            static_cast<unsigned>( ids.size() ), HS_MODE_BLOCK, nullptr, &db,
+                            &error );
+
+    if ( compileResult != HS_SUCCESS ) {
+        LOG_WARNING << "Failed to compile span database " << error->message
+                    << ", use qt regex engine";
+        hs_free_compile_error( error );
+        return nullptr;
+    }
+
+    return db;
+}
+
+} // namespace
+#endif
+
+SpanRegularExpression::SpanRegularExpression(
+    const klogg::vector<RegularExpressionPattern>& patterns )
+    : patterns_( patterns )
+{
+    for ( auto& pattern : patterns_ ) {
+        pattern.isPlainText = true;
+    }
+
+#ifdef KLOGG_HAS_HS
+    auto requiredInstructions = CpuInstructions::SSE2;
+    requiredInstructions |= CpuInstructions::SSSE3;
+    if ( !hasRequiredInstructions( supportedCpuInstructions(), requiredInstructions ) ) {
+        return;
+    }
+
+    database_ = HsDatabase{ makeUniqueResource<hs_database_t, hs_free_database>(
+        compileSpanDatabase, patterns_ ) };
+
+    if ( database_ ) {
+        scratch_ = makeUniqueResource<hs_scratch_t, hs_free_scratch>(
+            []( hs_database_t* db ) -> hs_scratch_t* {
+                hs_scratch_t* scratch = nullptr;
+                if ( hs_alloc_scratch( db, &scratch ) != HS_SUCCESS ) {
+                    LOG_ERROR << "Failed to allocate scratch";
+                    return nullptr;
+                }
+                return scratch;
+            },
+            database_.get() );
+    }
+
+    LOG_DEBUG << "Finished creating span database, patterns: " << patterns_.size()
+              << ", is db valid: " << ( scratch_ != nullptr );
+#endif
+}
+
+std::unique_ptr<SpanMatcher> SpanRegularExpression::createMatcher() const
+{
+    return std::make_unique<SpanMatcher>( *this );
+}
+
+SpanMatcher::SpanMatcher( const SpanRegularExpression& expression )
+{
+#ifdef KLOGG_HAS_HS
+    if ( expression.scratch_ ) {
+        database_ = expression.database_;
+        scratch_ = makeUniqueResource<hs_scratch_t, hs_free_scratch>(
+            []( hs_scratch_t* prototype ) -> hs_scratch_t* {
+                hs_scratch_t* scratch = nullptr;
+                if ( hs_clone_scratch( prototype, &scratch ) != HS_SUCCESS ) {
+                    LOG_ERROR << "hs_clone_scratch failed";
+                    return nullptr;
+                }
+                return scratch;
+            },
+            expression.scratch_.get() );
+    }
+#endif
+
+    std::transform(
+        expression.patterns_.cbegin(), expression.patterns_.cend(), std::back_inserter( regexp_ ),
+        []( const auto& pattern ) { return static_cast<QRegularExpression>( pattern ); } );
+}
+
+const MatchedSpans& SpanMatcher::match( const QString& line, std::string_view utf8Line )
+{
+    spans_.clear();
+
+#ifdef KLOGG_HAS_HS
+    if ( scan( utf8Line ) ) {
+        removeOverlappingSpans();
+        convertToColumns( utf8Line, static_cast<size_t>( line.size() ) );
+        return spans_;
+    }
+#else
+    Q_UNUSED( utf8Line );
+#endif
+
+    matchPatterns( line );
+    return spans_;
+}
+
+MatchedPatterns SpanMatcher::matchingPatterns( std::string_view utf8Line )
+{
+    MatchedPatterns matchedPatterns( regexp_.size(), 0 );
+    spans_.clear();
+
+#ifdef KLOGG_HAS_HS
+    if ( scan( utf8Line ) ) {
+        for ( const auto& span : spans_ ) {
+            matchedPatterns[ span.id ] = 1;
+        }
+        return matchedPatterns;
+    }
+#endif
+
+    const auto line = QString::fromUtf8( utf8Line.data(), klogg::isize( utf8Line ) );
+    for ( auto index = 0u; index < regexp_.size(); ++index ) {
+        if ( !regexp_[ index ].pattern().isEmpty() ) {
+            matchedPatterns[ index ] = regexp_[ index ].match( line ).hasMatch();
+        }
+    }
+
+    return matchedPatterns;
+}
+
+void SpanMatcher::matchPatterns( const QString& line )
+{
+    for ( auto index = 0u; index < regexp_.size(); ++index ) {
+        if ( regexp_[ index ].pattern().isEmpty() ) {
+            continue;
+        }
+
+        auto matchIterator = regexp_[ index ].globalMatch( line );
+        while ( matchIterator.hasNext() ) {
+            const auto match = matchIterator.next();
+            spans_.push_back( MatchedSpan{ index, static_cast<size_t>( match.capturedStart() ),
+                                           static_cast<size_t>( match.capturedEnd() ) } );
+        }
+    }
+}
+
+#ifdef KLOGG_HAS_HS
+bool SpanMatcher::scan( std::string_view utf8Line )
+{
+    if ( !scratch_ ) {
+        return false;
+    }
+
+    const auto scanResult
+        = hs_scan( database_.get(), utf8Line.data(), static_cast<unsigned>( utf8Line.size() ), 0,
+                   scratch_.get(), collectSpanCallback, static_cast<void*>( &spans_ ) );
+
+    if ( scanResult != HS_SUCCESS ) {
+        spans_.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void SpanMatcher::removeOverlappingSpans()
+{
+    // Hyperscan reports every occurrence, while globalMatch continues
+    // after the end of the previous match. Longer match wins at the same start.
+    std::sort( spans_.begin(), spans_.end(), []( const auto& lhs, const auto& rhs ) {
+        return std::make_tuple( lhs.id, lhs.from, rhs.to )
+               < std::make_tuple( rhs.id, rhs.from, lhs.to );
+    } );
+
+    auto kept = spans_.begin();
+    for ( auto span = spans_.begin(); span != spans_.end(); ++span ) {
+        if ( kept != spans_.begin() ) {
+            const auto& previous = *std::prev( kept );
+            if ( previous.id == span->id && span->from < previous.to ) {
+                continue;
+            }
+        }
+        *kept++ = *span;
+    }
+    spans_.erase( kept, spans_.end() );
+}
+
+void SpanMatcher::convertToColumns( std::string_view utf8Line, size_t utf16Size )
+{
+    // Other characters take more bytes in UTF-8 than in UTF-16,
+    // so offsets in a line of the same size are already columns
+    if ( spans_.empty() || utf8Line.size() == utf16Size ) {
+        return;
+    }
+
+    offsets_.clear();
+    for ( auto& span : spans_ ) {
+        offsets_.push_back( &span.from );
+        offsets_.push_back( &span.to );
+    }
+    std::sort( offsets_.begin(), offsets_.end(),
+               []( const size_t* lhs, const size_t* rhs ) { return *lhs < *rhs; } );
+
+    // Single pass over the line, counting UTF-16 units between sorted offsets
+    size_t byteOffset = 0;
+    size_t column = 0;
+    for ( auto* offset : offsets_ ) {
+        const auto nextByteOffset = *offset;
+        column += simdutf::utf16_length_from_utf8( utf8Line.data() + byteOffset,
+                                                   nextByteOffset - byteOffset );
+        byteOffset = nextByteOffset;
+        *offset = column;
+    }
+}
+#endif
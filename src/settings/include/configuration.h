@@ -43,6 +43,7 @@
 #include <QColor>
 #include <QFont>
 #include <QSettings>
+#include <QStringList>
 #include <qcolor.h>
 #include <string>
 #include <string_view>
@@ -199,6 +200,52 @@ class Configuration final : public Persistable<Configuration> {
     {
         searchResultsCacheLines_ = lines;
     }
+    unsigned searchResultsCacheSizeMb() const
+    {
+        return searchResultsCacheSizeMb_;
+    }
+    void setSearchResultsCacheSizeMb( unsigned sizeMb )
+    {
+        searchResultsCacheSizeMb_ = sizeMb;
+    }
+    // Keep an index of all lines matching the Quick Find pattern
+    bool useQuickFindIndex() const
+    {
+        return useQuickFindIndex_;
+    }
+    void setUseQuickFindIndex( bool enabled )
+    {
+        useQuickFindIndex_ = enabled;
+    }
+    // Pages of lines above and below the view highlighted in background,
+    // 0 highlights visible lines while painting
+    int highlightPrefetchPages() const
+    {
+        return highlightPrefetchPages_;
+    }
+    void setHighlightPrefetchPages( int pages )
+    {
+        highlightPrefetchPages_ = pages;
+    }
+    // Count lines matched by highlighters in background
+    // to show their density in the overview
+    bool useHighlightersDensity() const
+    {
+        return useHighlightersDensity_;
+    }
+    void setUseHighlightersDensity( bool enabled )
+    {
+        useHighlightersDensity_ = enabled;
+    }
+    // Timestamp layouts looked for at the beginning of lines when indexing
+    QStringList timestampFormats() const
+    {
+        return timestampFormats_;
+    }
+    void setTimestampFormats( const QStringList& formats )
+    {
+        timestampFormats_ = formats;
+    }
     int indexReadBufferSizeMb() const
     {
         return indexReadBufferSizeMb_;
@@ -573,6 +620,14 @@ class Configuration final : public Persistable<Configuration> {
     // Performance settings
     bool useSearchResultsCache_ = true;
     unsigned searchResultsCacheLines_ = 1000000;
+    unsigned searchResultsCacheSizeMb_ = 128;
+    bool useQuickFindIndex_ = true;
+    int highlightPrefetchPages_ = 2;
+    bool useHighlightersDensity_ = false;
+    QStringList timestampFormats_ = { "yyyy-MM-dd HH:mm:ss.zzz", "yyyy-MM-ddTHH:mm:ss.zzz",
+                                      "yyyy-MM-dd HH:mm:ss,zzz", "yyyy-MM-dd HH:mm:ss",
+                                      "yyyy-MM-ddTHH:mm:ss",     "yyyy/MM/dd HH:mm:ss",
+                                      "MMM dd HH:mm:ss" };
     bool useParallelSearch_ = true;
     int indexReadBufferSizeMb_ = 16;
     int searchReadBufferSizeLines_ = 10000;
@@ -234,6 +234,24 @@ void Configuration::retrieveFromStorage( QSettings& settings )
                                    .value( "perf.searchResultsCacheLines",
                                            DefaultConfiguration.searchResultsCacheLines_ )
                                    .toUInt();
+    searchResultsCacheSizeMb_ = settings
+                                    .value( "perf.searchResultsCacheSizeMb",
+                                            DefaultConfiguration.searchResultsCacheSizeMb_ )
+                                    .toUInt();
+    useQuickFindIndex_
+        = settings.value( "perf.useQuickFindIndex", DefaultConfiguration.useQuickFindIndex_ )
+              .toBool();
+    highlightPrefetchPages_ = settings
+                                  .value( "perf.highlightPrefetchPages",
+                                          DefaultConfiguration.highlightPrefetchPages_ )
+                                  .toInt();
+    useHighlightersDensity_ = settings
+                                  .value( "perf.useHighlightersDensity",
+                                          DefaultConfiguration.useHighlightersDensity_ )
+                                  .toBool();
+    timestampFormats_
+        = settings.value( "perf.timestampFormats", DefaultConfiguration.timestampFormats_ )
+              .toStringList();
     indexReadBufferSizeMb_
         = settings
               .value( "perf.indexReadBufferSizeMb", DefaultConfiguration.indexReadBufferSizeMb_ )
@@ -396,6 +414,11 @@ void Configuration::saveToStorage( QSettings& settings ) const
     settings.setValue( "perf.useParallelSearch", useParallelSearch_ );
     settings.setValue( "perf.useSearchResultsCache", useSearchResultsCache_ );
     settings.setValue( "perf.searchResultsCacheLines", searchResultsCacheLines_ );
+    settings.setValue( "perf.searchResultsCacheSizeMb", searchResultsCacheSizeMb_ );
+    settings.setValue( "perf.useQuickFindIndex", useQuickFindIndex_ );
+    settings.setValue( "perf.highlightPrefetchPages", highlightPrefetchPages_ );
+    settings.setValue( "perf.useHighlightersDensity", useHighlightersDensity_ );
+    settings.setValue( "perf.timestampFormats", timestampFormats_ );
     settings.setValue( "perf.indexReadBufferSizeMb", indexReadBufferSizeMb_ );
     settings.setValue( "perf.searchReadBufferSizeLines", searchReadBufferSizeLines_ );
     settings.setValue( "perf.searchThreadPoolSize", searchThreadPoolSize_ );
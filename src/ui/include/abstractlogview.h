@@ -42,7 +42,9 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <qchar.h>
 #include <string_view>
 #include <utility>
@@ -71,7 +73,14 @@
 class QMenu;
 class QAction;
 class QShortcut;
+class QSaveFile;
+class LogData;
+class LogFilteredData;
 class HighlightersMenu;
+class HighlightingContext;
+class HighlightCache;
+class WrappedLinesIndex;
+class SelectionCopier;
 
 // Utility class representing a buffer for number entered on the keyboard
 // The buffer keep at most 7 digits, and reset itself after a timeout.
@@ -127,6 +136,9 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     // Refresh the widget when the data set has changed.
     void updateData();
+    // Forget the QuickFind matches found so far, used when the file
+    // has been truncated or replaced.
+    void invalidateQuickFindIndex();
     // Instructs the widget to update it's content geometry,
     // used when the font is changed.
     void updateDisplaySize();
@@ -134,6 +146,9 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     LineNumber getTopLine() const;
     // Return the text of the current selection.
     QString getSelectedText() const;
+    // Copies the current selection to the clipboard,
+    // large ranges are copied in background with a progress dialog.
+    void copySelectedText( bool lineNumbers = false, bool updateSelection = false );
     // True for partial selection
     bool isPartialSelection() const;
     // Instructs the widget to select the whole text.
@@ -288,6 +303,11 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
   private Q_SLOTS:
     void handlePatternUpdated();
+    void handleQuickFindIndexUpdated();
+    void handleWrappedLinesIndexUpdated();
+    void handleHighlightedLinesReady( LineNumber first, LinesCount count );
+    void handleSelectionTooLargeForClipboard( LineNumber firstLine, LinesCount nbLines,
+                                              qint64 size );
     void addToSearch();
     void replaceSearch();
     void excludeFromSearch();
@@ -415,9 +435,24 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Our own QuickFind object
     QuickFind* quickFind_;
 
+    // Compiled highlighters reused between paints
+    std::unique_ptr<HighlightingContext> highlighting_;
+    // Highlights of lines around the view computed in background
+    std::unique_ptr<HighlightCache> highlightCache_;
+    // Rows taken by wrapped lines, used for scrolling in text wrap mode
+    std::unique_ptr<WrappedLinesIndex> wrappedLines_;
+    // Copies large selections to the clipboard
+    std::unique_ptr<SelectionCopier> selectionCopier_;
+
 #ifdef GLOGG_PERF_MEASURE_FPS
     // Performance measurement
     PerfCounter perfCounter_;
+    // Kinds of text area redraws within the measured second
+    struct RedrawCounts {
+        uint32_t full = 0;
+        uint32_t scrolled = 0;
+        uint32_t highlighted = 0;
+    } redrawCounts_;
 #endif
 
     // Vertical offset (in pixels) at which the first line of text is written
@@ -430,17 +465,19 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
         LineNumber first_line_;
         LineNumber last_line_;
         LineColumn first_column_;
+        uint64_t highlight_generation_;
+        // Rows drawn before their highlights were ready, relative to first_line_
+        QRect dirty_rows_;
     };
     struct PullToFollowCache {
         QPixmap pixmap_;
         LineLength nb_columns_;
     };
-    TextAreaCache textAreaCache_ = { {}, true, 0_lnum, 0_lnum, 0_lcol };
+    TextAreaCache textAreaCache_ = { {}, true, 0_lnum, 0_lnum, 0_lcol, 0, {} };
     PullToFollowCache pullToFollowCache_ = { {}, 0_length };
     QFontMetrics pixmapFontMetrics_;
 
     LinesCount getNbVisibleLines() const;
-    LinesCount getNbBottomWrappedVisibleLines() const;
     LineLength getNbVisibleCols() const;
 
     FilePosition convertCoordToFilePos( const QPoint& pos ) const;
@@ -468,6 +505,11 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     // Save specified lines in range [begin, end) to a file
     void saveLinesToFile( LineNumber begin, LineNumber end );
+    // Save lines byte for byte as they are in the source file,
+    // filteredData is null when saving lines of the source itself
+    void saveRawLinesToFile( QSaveFile& saveFile, const LogData& sourceData,
+                             const LogFilteredData* filteredData, LineNumber begin,
+                             LineNumber end );
 
     // Search functions (for n/N)
     using QuickFindSearchFn = void ( QuickFind::* )( Selection, QuickFindMatcher );
@@ -479,7 +521,9 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     int lineNumberToVerticalScroll( LineNumber line ) const;
     double verticalScrollMultiplicator() const;
 
-    void drawTextArea( QPaintDevice* paintDevice );
+    // Draws the lines intersecting dirtyRect, or all of them if it is null
+    void drawTextArea( QPaintDevice* paintDevice, const QRect& dirtyRect = {} );
+    QRect scrollTextAreaCache( int64_t scrolledLines );
     QPixmap drawPullToFollowBar( int width, qreal pixelRatio );
 
     void disableFollow();
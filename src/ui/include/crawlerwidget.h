@@ -89,6 +89,8 @@ class CrawlerWidget : public QSplitter,
     LineNumber getTopLine() const;
     // Get the selected text as a string (from the main window)
     QString getSelectedText() const;
+    // Copies the selected text of the view that has focus to the clipboard
+    void copySelectedText();
     // True for partial selection
     bool isPartialSelection() const;
 
@@ -123,6 +125,9 @@ class CrawlerWidget : public QSplitter,
 
     void focusSearchEdit();
     void goToLine();
+    // Use timestamps detected at the beginning of lines
+    void goToTime();
+    void setSearchTimeRange();
 
     // Instructs the widget to reconfigure itself because Config() has changed.
     void applyConfiguration();
@@ -334,6 +339,10 @@ class CrawlerWidget : public QSplitter,
     void changeTopViewSize( int32_t delta );
     void updatePredefinedFiltersWidget();
 
+    // Empty result with isAccepted set means the time was left empty
+    std::optional<int64_t> askForTime( const QString& title, const QString& label,
+                                       bool* isAccepted );
+
     // Reload predefined filters after changing settings
     void reloadPredefinedFilters() const;
 
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_HIGHLIGHTCACHE_H
+#define KLOGG_HIGHLIGHTCACHE_H
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "highlightedmatch.h"
+#include "highlighterset.h"
+#include "linetypes.h"
+
+class AbstractLogData;
+
+// Highlights of the lines around the view of a log, computed in background
+// so that painting does not have to match lines against the highlighters.
+// Lines are cached for one generation of the view's highlighting context,
+// together with the text they were computed for.
+// All methods are called from the GUI thread.
+class HighlightCache : public QObject {
+    Q_OBJECT
+
+  public:
+    struct LineHighlights {
+        QString text;
+        HighlighterMatchType type = HighlighterMatchType::NoMatch;
+        HighlightedMatchRanges matches;
+    };
+
+    explicit HighlightCache( const AbstractLogData& logData );
+    ~HighlightCache() override;
+
+    HighlightCache( const HighlightCache& ) = delete;
+    HighlightCache& operator=( const HighlightCache& ) = delete;
+
+    // Drops the cached lines if the context has been prepared again
+    void setContext( const HighlightingContext& context );
+
+    // Highlights of the line if they have been computed for the same text
+    const LineHighlights* find( LineNumber line, const QString& text );
+
+    // Highlights visible lines, then prefetchLines lines below and above them,
+    // in background. Cached lines outside of this window are dropped.
+    void request( LineNumber firstVisible, LinesCount visibleLines, LinesCount prefetchLines );
+
+    void stop();
+
+  Q_SIGNALS:
+    // Sent when highlights of some visible lines have been computed,
+    // the range covers all of them. Lines prefetched around the view
+    // are used when drawn and don't need a repaint.
+    void linesReady( LineNumber first, LinesCount count );
+
+  private Q_SLOTS:
+    void onHighlightingFinished();
+
+  private:
+    using LinesRange = std::pair<LineNumber, LinesCount>;
+
+    struct HighlightedLines {
+        uint64_t generation = 0;
+        bool isInterrupted = false;
+        klogg::vector<std::pair<LineNumber, LineHighlights>> lines;
+    };
+
+    // Ranges of not yet cached lines, visible ones if there are any
+    klogg::vector<LinesRange> missingLines() const;
+    void startHighlighting();
+
+  private:
+    const AbstractLogData& logData_;
+
+    uint64_t generation_ = 0;
+    std::shared_ptr<HighlightingContext> context_;
+
+    std::unordered_map<LineNumber::UnderlyingType, LineHighlights> lines_;
+
+    LinesRange visible_;
+    LinesRange window_;
+
+    AtomicFlag interruptRequested_;
+    QFutureWatcher<HighlightedLines> watcher_;
+};
+
+#endif
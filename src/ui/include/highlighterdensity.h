@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_HIGHLIGHTERDENSITY_H
+#define KLOGG_HIGHLIGHTERDENSITY_H
+
+#include <cstdint>
+#include <memory>
+
+#include <QColor>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QRegularExpression>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+class LogData;
+class HighlighterSet;
+struct CompiledHighlighterSet;
+
+// Number of lines matched by each highlighter of the active set in buckets
+// of consecutive lines of a log, counted in background to show where
+// highlighted lines are in the overview. Lines are matched as raw UTF-8
+// by the compiled highlighters of the set, so tabs are not expanded.
+// Regex highlighters are compiled as a prefilter, lines it reports
+// are decoded and confirmed by the regular expression of the highlighter.
+// When there are too many buckets, they are merged by pairs, so memory
+// does not depend on the size of the file.
+// Counting continues from the last counted line when lines are appended
+// and starts again when the active set is changed or the file shrinks.
+// Methods are called from the GUI thread.
+class HighlighterDensity : public QObject {
+    Q_OBJECT
+
+  public:
+    static constexpr uint64_t MaxBuckets = 4096;
+
+    explicit HighlighterDensity( const LogData& logData );
+    ~HighlighterDensity() override;
+
+    HighlighterDensity( const HighlighterDensity& ) = delete;
+    HighlighterDensity& operator=( const HighlighterDensity& ) = delete;
+
+    // Counts lines not counted yet, all lines if the active set has changed
+    void update();
+    void stop();
+
+    // Color of the highlighter matching most lines at each of height rows,
+    // lines of a file of linesInFile lines being spread evenly over rows.
+    // Color is invalid for rows without highlighted lines.
+    klogg::vector<QColor> rowColors( unsigned height, LinesCount linesInFile ) const;
+
+  Q_SIGNALS:
+    // Sent from time to time while counting and when counting is done
+    void densityUpdated();
+
+  private Q_SLOTS:
+    void onCountingFinished();
+
+  private:
+    struct Counts {
+        std::shared_ptr<const CompiledHighlighterSet> highlighters;
+        klogg::vector<QColor> colors;
+
+        uint64_t linesPerBucket = 1;
+        LinesCount countedLines;
+        // Lines of bucket b matched by highlighter h are at b * colors.size() + h
+        klogg::vector<uint32_t> matchedLines;
+        // Highlighters matched by the last counted line, it could be incomplete
+        klogg::vector<char> lastLineMatches;
+    };
+
+    using CountsSnapshot = std::shared_ptr<const Counts>;
+
+    void startCounting( const HighlighterSet& activeSet );
+    // Regexps are the ones of regex highlighters in order of compiled patterns
+    void count( Counts counts, const klogg::vector<QRegularExpression>& regexps );
+    void publish( Counts counts );
+
+  private:
+    const LogData& logData_;
+
+    bool isUpdatePending_ = false;
+    std::shared_ptr<const CompiledHighlighterSet> countingHighlighters_;
+
+    mutable Mutex mutex_;
+    CountsSnapshot counts_;
+
+    AtomicFlag interruptRequested_;
+    QFutureWatcher<void> countingWatcher_;
+};
+
+#endif
@@ -42,8 +42,10 @@
 #include <QColor>
 #include <QMetaType>
 #include <QRegularExpression>
+#include <QStringList>
 #include <memory>
 #include <optional>
+#include <vector>
 #include <qcolor.h>
 #include <qregularexpression.h>
 
@@ -52,6 +54,7 @@
 #include "persistable.h"
 #include "regularexpression.h"
 #include "regularexpressionpattern.h"
+#include "spanregularexpression.h"
 
 struct HighlightColor {
     QColor foreColor;
@@ -69,6 +72,9 @@ class Highlighter {
 
     bool matchLine( const QString& line, klogg::vector<HighlightedMatch>& matches ) const;
 
+    // Match at the passed columns of the line, in colors of the highlighter
+    HighlightedMatch spanMatch( const QString& line, LineColumn start, LineLength length ) const;
+
     // Accessor functions
     QString pattern() const;
     void setPattern( const QString& pattern );
@@ -97,6 +103,9 @@ class Highlighter {
     void retrieveFromStorage( QSettings& settings );
 
     RegularExpressionPattern expressionPattern() const;
+    // Plain text highlighters are matched by span scan instead of regular expression
+    bool isPlainText() const;
+    RegularExpressionPattern plainTextPattern() const;
 
     void compile() const;
 
@@ -118,6 +127,18 @@ class Highlighter {
 
 enum class HighlighterMatchType { NoMatch, WordMatch, LineMatch };
 
+// Highlighters of a set compiled together. Regular expressions are checked
+// by one prefilter scan and then matched one by one, plain text patterns
+// are found with their positions by one span scan.
+struct CompiledHighlighterSet {
+    // Indexes of highlighters in the set in the order of compiled patterns
+    klogg::vector<int> regexHighlighters;
+    klogg::vector<int> plainTextHighlighters;
+
+    std::unique_ptr<MultiRegularExpression> regexExpression;
+    std::unique_ptr<SpanRegularExpression> plainTextExpression;
+};
+
 // Represents an ordered set of filters to be applied to each line displayed.
 class HighlighterSet {
   public:
@@ -161,8 +182,75 @@ class HighlighterSet {
     // internal structure directly.
     friend class HighlighterSetEdit;
     friend class HighlighterSetCollection;
+    friend class HighlighterSetMatcher;
+    friend class HighlightingContext;
+    friend class HighlighterDensity;
+
+    mutable std::shared_ptr<const CompiledHighlighterSet> compiledExpression_;
+};
+
+// Matches lines against a highlighter set keeping the matchers of the
+// compiled set, with their scratch space, and the UTF-8 buffer between lines.
+// The matchers are created again only when the set has been compiled again.
+class HighlighterSetMatcher {
+  public:
+    HighlighterMatchType matchLine( const HighlighterSet& set, const QString& line,
+                                    HighlightedMatchRanges& matches );
 
-    mutable std::shared_ptr<MultiRegularExpression> compiledExpression_;
+  private:
+    std::shared_ptr<const CompiledHighlighterSet> expression_;
+    std::unique_ptr<MultiPatternMatcher> regexMatcher_;
+    std::unique_ptr<SpanMatcher> plainTextMatcher_;
+    klogg::vector<char> utf8Data_;
+    klogg::vector<HighlightedMatch> highlighterMatches_;
+
+    // Per highlighter of the set: matched by prefilter and range of its spans
+    MatchedPatterns matchedHighlighters_;
+    klogg::vector<std::pair<size_t, size_t>> highlighterSpans_;
+};
+
+// Highlighters used to draw the lines of a view: the active set, the main
+// search pattern and the quick highlighters. They are compiled once and
+// reused across lines and paints until the patterns or the colors change.
+// Each context has its own compiled regular expressions and matchers,
+// so clones can be used by other threads.
+class HighlightingContext {
+  public:
+    // Builds the highlighters again if their patterns or colors differ
+    // from the ones used for the previous paint, returns true if so.
+    bool prepare( const RegularExpressionPattern& searchPattern,
+                  const std::vector<QStringList>& quickHighlighterWords );
+
+    // Incremented each time the highlighters are built again
+    uint64_t generation() const
+    {
+        return generation_;
+    }
+
+    // Context with the same highlighters compiled again
+    std::unique_ptr<HighlightingContext> clone() const;
+
+    // Same as HighlighterSet::matchLine for the active set, with the matches
+    // of search pattern and quick highlighters added.
+    HighlighterMatchType matchLine( const QString& line, HighlightedMatchRanges& matches );
+
+  private:
+    HighlighterSet activeSet_;
+    HighlighterSetMatcher setMatcher_;
+
+    // Search pattern and quick highlighters
+    HighlighterSet overlaySet_;
+    HighlighterSetMatcher overlayMatcher_;
+
+    // Inputs the highlighters were built from
+    bool isPrepared_ = false;
+    uint64_t generation_ = 0;
+    RegularExpressionPattern searchPattern_;
+    bool highlightSearchPattern_ = false;
+    bool variateSearchPatternColors_ = false;
+    QColor searchPatternBackColor_;
+    std::vector<QStringList> quickHighlighterWords_;
+    klogg::vector<std::pair<QColor, QColor>> quickHighlighterColors_;
 };
 
 struct QuickHighlighter {
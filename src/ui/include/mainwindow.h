@@ -253,6 +253,8 @@ class MainWindow : public QMainWindow {
     QAction* copyAction;
     QAction* selectAllAction;
     QAction* goToLineAction;
+    QAction* goToTimeAction;
+    QAction* searchTimeRangeAction;
     QAction* findAction;
     QAction* clearLogAction;
     QAction* copyPathToClipboardAction;
@@ -44,6 +44,10 @@ extern const char* selectAllText;
 extern const char* selectAllStatusTip;
 extern const char* goToLineText;
 extern const char* goToLineStatusTip;
+extern const char* goToTimeText;
+extern const char* goToTimeStatusTip;
+extern const char* searchTimeRangeText;
+extern const char* searchTimeRangeStatusTip;
 extern const char* findText;
 extern const char* findStatusTip;
 extern const char* clearLogText;
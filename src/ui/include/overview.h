@@ -20,10 +20,21 @@
 #ifndef OVERVIEW_H
 #define OVERVIEW_H
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "containers.h"
 #include "linetypes.h"
+#include "searchresultarray.h"
+#include <QColor>
+#include <QFutureWatcher>
 #include <QList>
+#include <QObject>
 #include <QVector>
 
+class HighlighterDensity;
+class LogData;
 class LogFilteredData;
 
 // Class implementing the logic behind the matches overview bar.
@@ -31,8 +42,12 @@ class LogFilteredData;
 // a screen dependent set of coloured lines, which is cached.
 // This class is not a UI class, actual display is left to the client.
 //
-// This class is NOT thread-safe.
-class Overview {
+// Lines are computed in background by counting the lines of the
+// published result sets in each pixel row with rank queries.
+// Methods are called from the GUI thread.
+class Overview : public QObject {
+    Q_OBJECT
+
   public:
     // A line with a position in pixel and a weight (darkness)
     class WeightedLine {
@@ -50,6 +65,13 @@ class Overview {
             pos_ = pos;
             weight_ = 0;
         }
+        // Line standing for nbLines lines at the same position
+        WeightedLine( int pos, uint64_t nbLines )
+        {
+            pos_ = pos;
+            weight_ = static_cast<int>(
+                std::min( nbLines - 1, static_cast<uint64_t>( WEIGHT_STEPS - 1 ) ) );
+        }
 
         int position() const
         {
@@ -71,9 +93,15 @@ class Overview {
     };
 
     Overview();
+    ~Overview() override;
+
+    Overview( const Overview& ) = delete;
+    Overview& operator=( const Overview& ) = delete;
 
     // Associate the passed filteredData to this Overview
     void setFilteredData( const LogFilteredData* logFilteredData );
+    // Associate the file whose lines are counted for highlighters density
+    void setLogData( const LogData* logData );
     // Signal the overview its attached LogFilteredData has been changed and
     // the overview must be updated with the provided total number
     // of line of the file.
@@ -85,6 +113,13 @@ class Overview {
         dirty_ = visible;
     }
 
+    // Set the lines matching the QuickFind pattern, if they are known.
+    void setQuickFindMatches( SearchResultsSnapshot matches )
+    {
+        quickFindMatches_ = std::move( matches );
+        dirty_ = true;
+    }
+
     // Update the current position in the file (to draw the view line)
     void updateCurrentPosition( LineNumber firstLine, LineNumber lastLine )
     {
@@ -98,14 +133,20 @@ class Overview {
         return visible_;
     }
     // Signal the overview the height of the display has changed, triggering
-    // an update of its cache.
+    // an update of its cache in background.
     void updateView( unsigned height );
     // Returns a list of lines (between 0 and 'height') representing matches.
-    // (pointer returned is valid until next call to update*()
+    // (pointer returned is valid until linesUpdated() is sent)
     const klogg::vector<WeightedLine>* getMatchLines() const;
     // Returns a list of lines (between 0 and 'height') representing marks.
-    // (pointer returned is valid until next call to update*()
+    // (pointer returned is valid until linesUpdated() is sent)
     const klogg::vector<WeightedLine>* getMarkLines() const;
+    // Returns a list of lines (between 0 and 'height') representing QuickFind matches.
+    // (pointer returned is valid until linesUpdated() is sent)
+    const klogg::vector<WeightedLine>* getQuickFindLines() const;
+    // Returns the color of highlighters matching most lines at each row
+    // (between 0 and 'height'), invalid for rows without highlighted lines.
+    const klogg::vector<QColor>* getDensityColors() const;
     // Return a pair of lines (between 0 and 'height') representing the current view.
     std::pair<int, int> getViewLines() const;
 
@@ -114,9 +155,41 @@ class Overview {
     // Return the y coordinate corresponding to the passed line number.
     int yFromFileLine( LineNumber fileLine ) const;
 
+  Q_SIGNALS:
+    // Sent when lines computed in background can be drawn
+    void linesUpdated();
+
+  private Q_SLOTS:
+    void onLinesCalculated();
+    void onDensityUpdated();
+
   private:
+    // Overview lines of the result sets for a file size and a height
+    struct Lines {
+        SearchResultsSnapshot matches;
+        SearchResultsSnapshot marks;
+        SearchResultsSnapshot marksAndMatches;
+        SearchResultsSnapshot quickFindMatches;
+        bool showMatches = false;
+        bool showMarks = false;
+        LinesCount linesInFile;
+        unsigned height = 0;
+
+        klogg::vector<WeightedLine> matchLines;
+        klogg::vector<WeightedLine> markLines;
+        klogg::vector<WeightedLine> quickFindLines;
+    };
+
+    using LinesSnapshot = std::shared_ptr<const Lines>;
+
+    // Rows before the first one changed since previous lines are copied
+    static LinesSnapshot calculateLines( Lines lines, const LinesSnapshot& previous );
+    void startCalculation();
+
     // List of matches associated with this Overview.
     const LogFilteredData* logFilteredData_;
+    // Lines matching QuickFind pattern.
+    SearchResultsSnapshot quickFindMatches_;
     // Total number of lines in the file.
     LinesCount linesInFile_;
     // Whether the overview is visible.
@@ -128,12 +201,18 @@ class Overview {
     unsigned height_;
     // Does the cache (matchesLines, markLines) need to be recalculated.
     bool dirty_;
+    // Cache has to be recalculated again when current calculation is done
+    bool isCalculationPending_ = false;
+
+    // Lines representing matches and marks (are shared with the client)
+    LinesSnapshot lines_;
 
-    // List of lines representing matches and marks (are shared with the client)
-    klogg::vector<WeightedLine> matchLines_;
-    klogg::vector<WeightedLine> markLines_;
+    QFutureWatcher<LinesSnapshot> calculationWatcher_;
 
-    void recalculatesLines();
+    // Lines matched by highlighters, counted in background
+    std::unique_ptr<HighlighterDensity> density_;
+    klogg::vector<QColor> densityColors_;
+    bool isDensityDirty_ = true;
 };
 
 #endif
@@ -88,4 +88,14 @@ class QFNotificationProgress : public QFNotification {
     }
 };
 
+class QFNotificationMatchCount : public QFNotification {
+  public:
+    // Constructor taking the position of the found line among all matching lines
+    QFNotificationMatchCount( qulonglong matchIndex, qulonglong matchesCount )
+        : QFNotification(
+            QObject::tr( "Matching line %1 of %2" ).arg( matchIndex ).arg( matchesCount ) )
+    {
+    }
+};
+
 #endif
@@ -45,13 +45,18 @@
 #include <QPoint>
 #include <QTime>
 
+#include <memory>
+
 #include "atomicflag.h"
 #include "linetypes.h"
 #include "qfnotifications.h"
 #include "quickfindpattern.h"
+#include "searchresultarray.h"
 #include "selection.h"
 
 class QuickFindPattern;
+class QuickFindIndex;
+class QuickFindScanner;
 class AbstractLogData;
 
 // Handle "long processing" notifications to the UI.
@@ -100,6 +105,7 @@ class QuickFind : public QObject {
   public:
     // Construct a search
     explicit QuickFind( const AbstractLogData& logData );
+    ~QuickFind() override;
 
     // Set the starting point that will be used by the next search
     void setSearchStartPoint( QPoint startPoint );
@@ -107,6 +113,16 @@ class QuickFind : public QObject {
     // Make the object forget the 'no more match' flag.
     void resetLimits();
 
+    // Start indexing all lines matching the passed pattern, if
+    // the index is enabled and the searched data is a whole file.
+    void setIndexPattern( const QuickFindMatcher& matcher );
+    // Index lines added to the file
+    void updateIndex();
+    // Index the whole file again
+    void invalidateIndex();
+    // Lines indexed for the current pattern, empty pointer if there are none
+    SearchResultsSnapshot indexedMatches() const;
+
   public Q_SLOTS:
     // Used for incremental searches
     // Return the first occurrence of the passed pattern from the starting
@@ -138,6 +154,8 @@ class QuickFind : public QObject {
     void clearNotification();
     // Sent when search is completed
     void searchDone( bool hasMatch, Portion selection );
+    // Sent when the index of matching lines has changed
+    void indexUpdated();
 
   private Q_SLOTS:
     void sendNotification( QFNotification notification );
@@ -229,6 +247,19 @@ class QuickFind : public QObject {
     Portion doSearchBackward( const Selection& selection, const QuickFindMatcher& matcher );
     Portion doSearchBackward( const FilePosition& start_position, const Selection& selection,
                               const QuickFindMatcher& matcher );
+    // Searches whole lines starting at the passed one, which is updated
+    // to the matching line. Columns of the match are kept by the matcher.
+    bool searchLines( LineNumber& line, QFDirection direction, const QuickFindMatcher& matcher );
+    // Same using the index of matching lines
+    bool searchIndexedLines( const IndexedSearchResults& matches, LineNumber& line,
+                             QFDirection direction, const QuickFindMatcher& matcher );
+    // Replaces the notification with the position of the found line
+    // among all matching ones if it is known
+    void notifyMatchFound( LineNumber line, const QuickFindMatcher& matcher );
+
+    std::unique_ptr<QuickFindIndex> index_;
+    // Chunk scanner for the last searched pattern, used by one search at a time
+    std::unique_ptr<QuickFindScanner> scanner_;
 
     AtomicFlag interruptRequested_;
     QFuture<Portion> operationFuture_;
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_QUICKFINDINDEX_H
+#define KLOGG_QUICKFINDINDEX_H
+
+#include <memory>
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QRegularExpression>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+#include "searchresultarray.h"
+#include "synchronization.h"
+
+class LogData;
+class QuickFindMatcher;
+class QuickFindScanner;
+
+// Set of all lines of a log matching the Quick Find pattern.
+// It is built in background as soon as the pattern is set and extended
+// when the file grows, so next and previous matches are found by rank
+// and select instead of scanning the lines in between.
+// Methods are called from the GUI thread, except for completeMatches.
+class QuickFindIndex : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit QuickFindIndex( const LogData& logData );
+    ~QuickFindIndex() override;
+
+    // Starts indexing the lines for the passed matcher,
+    // an inactive one just clears the index
+    void setPattern( const QuickFindMatcher& matcher );
+    // Indexes lines appended to the file since the last pass
+    void update();
+    // Indexes the whole file again, e.g. after it has been truncated
+    void invalidate();
+    void stop();
+
+    // Lines matching the passed expression if the whole file has been
+    // indexed for it, empty pointer otherwise. Thread safe.
+    SearchResultsSnapshot completeMatches( const QRegularExpression& regexp ) const;
+    // Lines indexed so far for the current pattern
+    SearchResultsSnapshot matches() const;
+
+  Q_SIGNALS:
+    // Sent when a pass is finished and matches have changed
+    void indexUpdated();
+
+  private Q_SLOTS:
+    void onBuildFinished();
+
+  private:
+    void startBuild();
+    void clear();
+    void build( const QRegularExpression& regexp );
+
+  private:
+    const LogData& logData_;
+
+    bool isActive_ = false;
+    QRegularExpression regexp_;
+    bool isUpdatePending_ = false;
+
+    mutable Mutex mutex_;
+    QRegularExpression indexedRegexp_;
+    SearchResultsSnapshot matches_;
+    LinesCount indexedLines_;
+
+    // Used only by indexing thread. Scanner is kept while the pattern is
+    // the same, lines and their rank index are extended with appended lines
+    // and copied to a new snapshot only if they have changed.
+    std::unique_ptr<QuickFindScanner> scanner_;
+    SearchResultArray lines_;
+    SearchResultRankIndex linesIndex_;
+
+    AtomicFlag interruptRequested_;
+    QFutureWatcher<void> buildWatcher_;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_QUICKFINDSCANNER_H
+#define KLOGG_QUICKFINDSCANNER_H
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <QRegularExpression>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "linetypes.h"
+#include "regularexpression.h"
+#include "searchresultarray.h"
+
+class LogData;
+
+// Finds lines for Quick Find in chunks of raw lines of the log data.
+// Lines are matched as UTF-8 by the same matchers as the main search,
+// several chunks in parallel; the first hit in scan order wins.
+// Lines with tabs are expanded and matched by the regexp in the chunk,
+// as the expanded text the view shows may match differently.
+// Scanner is kept between searches for the same pattern.
+class QuickFindScanner {
+  public:
+    enum class Direction { Forward, Backward };
+
+    QuickFindScanner( const LogData& logData, const QRegularExpression& regexp );
+    ~QuickFindScanner();
+
+    QuickFindScanner( const QuickFindScanner& ) = delete;
+    QuickFindScanner& operator=( const QuickFindScanner& ) = delete;
+
+    bool isValid() const;
+
+    const QRegularExpression& regexp() const
+    {
+        return regexp_;
+    }
+
+    // Searches lines in [begin, end), from begin if going forward
+    // and from end if going backward. Progress is called with the position
+    // reached after each group of chunks.
+    OptionalLineNumber findMatch( LineNumber begin, LineNumber end, Direction direction,
+                                  const AtomicFlag& interruptRequested,
+                                  const std::function<void( LineNumber )>& progress ) const;
+
+    // Returns all matching lines in [begin, end), lines with tabs are
+    // confirmed on their expanded text so the set is exact.
+    SearchResultArray findAll( LineNumber begin, LineNumber end,
+                               const AtomicFlag& interruptRequested ) const;
+
+  private:
+    // Splits the next group of chunks off the not yet scanned lines,
+    // moving position past them in the scan direction
+    klogg::vector<std::pair<LineNumber, LineNumber>>
+    nextChunks( LineNumber& position, LineNumber begin, LineNumber end,
+                Direction direction ) const;
+
+  private:
+    const LogData& logData_;
+    QRegularExpression regexp_;
+    RegularExpression expression_;
+    // One matcher per chunk of a group
+    klogg::vector<std::unique_ptr<PatternMatcher>> matchers_;
+    LinesCount chunkSize_;
+};
+
+#endif
@@ -150,6 +150,9 @@ class Selection {
     // Returns the line selected or -1 if not a single line selection
     OptionalLineNumber selectedLine() const;
 
+    // Returns the first line of a range selection
+    OptionalLineNumber selectedRangeStart() const;
+
     // Returns the text selected from the passed AbstractLogData
     QString getSelectedText( const AbstractLogData* logData, bool lineNumbers = false ) const;
 
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SELECTIONCOPIER_H
+#define KLOGG_SELECTIONCOPIER_H
+
+#include <memory>
+
+#include <QFutureWatcher>
+#include <QObject>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+
+class AbstractLogData;
+class QTemporaryFile;
+
+// Copies large ranges of lines to the clipboard without building their
+// text in memory. A background job writes the lines chunk by chunk to a
+// temporary file in UTF-8, then the clipboard gets mime data that reads
+// the file only when the text is pasted.
+// Pasting reads the whole file into memory, so copies larger than
+// MaxClipboardBytes are not put to the clipboard.
+// Methods are called from the GUI thread.
+class SelectionCopier : public QObject {
+    Q_OBJECT
+
+  public:
+    // Smaller selections are copied as one string
+    static constexpr LinesCount::UnderlyingType MinStreamedLines = 100000;
+    // Larger copied text is not put to the clipboard
+    static constexpr qint64 MaxClipboardBytes = 1024LL * 1024 * 1024;
+
+    explicit SelectionCopier( const AbstractLogData& logData );
+    ~SelectionCopier() override;
+
+    SelectionCopier( const SelectionCopier& ) = delete;
+    SelectionCopier& operator=( const SelectionCopier& ) = delete;
+
+    // Stops the previous copy and starts copying nbLines lines from firstLine
+    void start( LineNumber firstLine, LinesCount nbLines, bool lineNumbers,
+                bool updateSelection );
+    // Cancels the copy, the clipboard is left unchanged
+    void stop();
+
+  Q_SIGNALS:
+    // Sent from the copying thread with the percent of lines written
+    void progressed( int percent );
+    // Sent when the copy is done or cancelled
+    void finished();
+    // Sent before finished if copied text takes more than MaxClipboardBytes,
+    // the clipboard is left unchanged
+    void tooLargeForClipboard( LineNumber firstLine, LinesCount nbLines, qint64 size );
+
+  private Q_SLOTS:
+    void onCopyFinished();
+
+  private:
+    bool copyLines( LineNumber firstLine, LinesCount nbLines, bool lineNumbers );
+
+  private:
+    const AbstractLogData& logData_;
+    LineNumber firstLine_;
+    LinesCount nbLines_;
+    bool updateSelection_ = false;
+    // Only used by the copying thread while it is running
+    std::shared_ptr<QTemporaryFile> file_;
+
+    AtomicFlag interruptRequested_;
+    QFutureWatcher<bool> copyWatcher_;
+};
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_WRAPPEDLINESINDEX_H
+#define KLOGG_WRAPPEDLINESINDEX_H
+
+#include <cstdint>
+
+#include <QFutureWatcher>
+#include <QObject>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+class AbstractLogData;
+class LogFilteredData;
+
+// Rows taken by the lines of a log when text is wrapped to a given width.
+// Only lines wrapped to several rows are stored, each with the total of
+// extra rows added by it and the lines before it, so converting between
+// lines and rows is a binary search. Lines not indexed yet count as one row.
+// The index is built in background and extended when lines are appended.
+// Lengths of the lines longer than the narrowest width indexed are kept,
+// so a wider width only wraps them again without reading the whole log.
+// Methods are called from the GUI thread.
+class WrappedLinesIndex : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit WrappedLinesIndex( const AbstractLogData& logData );
+    ~WrappedLinesIndex() override;
+
+    WrappedLinesIndex( const WrappedLinesIndex& ) = delete;
+    WrappedLinesIndex& operator=( const WrappedLinesIndex& ) = delete;
+
+    // Starts indexing for the passed width if it has changed,
+    // zero width stops indexing and clears the index
+    void setVisibleColumns( LineLength visibleColumns );
+    // Indexes lines changed since the last pass
+    void update();
+    void stop();
+
+    // Rows taken by the first nbLines lines
+    uint64_t totalRows( LinesCount nbLines ) const;
+    // First row of the line
+    uint64_t rowOfLine( LineNumber line ) const;
+    // Line drawn at the row
+    LineNumber lineOfRow( uint64_t row ) const;
+
+  Q_SIGNALS:
+    // Sent from time to time while indexing and when a pass is finished
+    void indexUpdated();
+
+  private Q_SLOTS:
+    void onBuildFinished();
+
+  private:
+    struct WrappedLine {
+        LineNumber::UnderlyingType line;
+        // Rows added to the first one by this line and all lines before it
+        uint64_t extraRows;
+    };
+
+    struct LongLine {
+        LineNumber::UnderlyingType line;
+        LineLength::UnderlyingType length;
+    };
+
+    void startBuild();
+    void clear();
+    void build( LineLength visibleColumns );
+    // Number of indexed lines that have not changed since indexing
+    LinesCount unchangedLines( LinesCount nbLines ) const;
+    // Line of the source log the passed line of indexed one is
+    LineNumber::UnderlyingType sourceLine( LinesCount::UnderlyingType line ) const;
+    // Extra rows of the lines before the passed one
+    uint64_t extraRowsBefore( LineNumber::UnderlyingType line ) const;
+
+  private:
+    const AbstractLogData& logData_;
+    // Lines of filtered data can change anywhere, other logs are appended
+    const LogFilteredData* const filteredData_;
+
+    LineLength visibleColumns_;
+    bool isUpdatePending_ = false;
+
+    mutable SharedMutex mutex_;
+    klogg::vector<WrappedLine> wrappedLines_;
+    LineLength indexedColumns_;
+    LinesCount indexedLines_;
+
+    // Used only by indexing thread
+    LineNumber::UnderlyingType lastIndexedSourceLine_ = 0;
+    klogg::vector<LongLine> longLines_;
+    LineLength longLinesColumns_;
+
+    AtomicFlag interruptRequested_;
+    QFutureWatcher<void> buildWatcher_;
+};
+
+#endif
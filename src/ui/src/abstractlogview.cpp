@@ -48,6 +48,7 @@
 #include <cmath>
 #include <complex>
 #include <cstdint>
+#include <cstdlib>
 #include <iterator>
 #include <limits>
 #include <memory>
@@ -66,6 +67,7 @@
 #include <QGestureEvent>
 #include <QInputDialog>
 #include <QMenu>
+#include <QMessageBox>
 #include <QPaintEvent>
 #include <QPainter>
 #include <QPalette>
@@ -86,14 +88,21 @@
 #include "active_screen.h"
 #include "clipboard.h"
 #include "configuration.h"
+#include "highlightcache.h"
 #include "highlighterset.h"
 #include "highlightersmenu.h"
 #include "log.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
 #include "overview.h"
 #include "quickfind.h"
 #include "quickfindpattern.h"
+#include "rawlineswriter.h"
+#include "readablesize.h"
 #include "regularexpressionpattern.h"
+#include "selectioncopier.h"
 #include "shortcuts.h"
+#include "wrappedlinesindex.h"
 
 #ifdef Q_OS_WIN
 
@@ -136,6 +145,10 @@ inline int countLeadingZeroes( uint64_t value )
 
 namespace {
 
+// Lines of the main view are saved in pieces of at most this size,
+// so that the progress dialog can be cancelled between them
+constexpr qint64 SaveChunkBytes = 64 * 1024 * 1024;
+
 int mapPullToFollowLength( int length );
 
 int intLog2( uint64_t x )
@@ -402,6 +415,10 @@ AbstractLogView::AbstractLogView( const AbstractLogData* newLogData,
     , searchEnd_( newLogData->getNbLine().get() )
     , quickFindPattern_( quickFindPattern )
     , quickFind_( new QuickFind( *newLogData ) )
+    , highlighting_( std::make_unique<HighlightingContext>() )
+    , highlightCache_( std::make_unique<HighlightCache>( *newLogData ) )
+    , wrappedLines_( std::make_unique<WrappedLinesIndex>( *newLogData ) )
+    , selectionCopier_( std::make_unique<SelectionCopier>( *newLogData ) )
     , pixmapFontMetrics_( this->font() )
 {
     setViewport( nullptr );
@@ -421,6 +438,17 @@ AbstractLogView::AbstractLogView( const AbstractLogData* newLogData,
 
     connect( quickFind_, &QuickFind::searchDone, this, &AbstractLogView::setQuickFindResult,
              Qt::QueuedConnection );
+    connect( quickFind_, &QuickFind::indexUpdated, this,
+             &AbstractLogView::handleQuickFindIndexUpdated );
+
+    connect( highlightCache_.get(), &HighlightCache::linesReady, this,
+             &AbstractLogView::handleHighlightedLinesReady );
+
+    connect( selectionCopier_.get(), &SelectionCopier::tooLargeForClipboard, this,
+             &AbstractLogView::handleSelectionTooLargeForClipboard, Qt::QueuedConnection );
+
+    connect( wrappedLines_.get(), &WrappedLinesIndex::indexUpdated, this,
+             &AbstractLogView::handleWrappedLinesIndexUpdated, Qt::QueuedConnection );
 
     connect( &followElasticHook_, SIGNAL( lengthChanged() ), this, SLOT( repaint() ) );
     connect( &followElasticHook_, SIGNAL( hooked( bool ) ), this,
@@ -1006,24 +1034,29 @@ bool AbstractLogView::event( QEvent* e )
     return QAbstractScrollArea::event( e );
 }
 
+// In text wrap mode the scroll bar counts rows instead of lines
 int AbstractLogView::lineNumberToVerticalScroll( LineNumber line ) const
 {
+    const auto row = useTextWrap_ ? wrappedLines_->rowOfLine( line ) : line.get();
     return static_cast<int>(
-        std::round( static_cast<double>( line.get() ) * verticalScrollMultiplicator() ) );
+        std::round( static_cast<double>( row ) * verticalScrollMultiplicator() ) );
 }
 
 LineNumber AbstractLogView::verticalScrollToLineNumber( int scrollPosition ) const
 {
-    return LineNumber( static_cast<LineNumber::UnderlyingType>(
-        std::round( static_cast<double>( scrollPosition ) / verticalScrollMultiplicator() ) ) );
+    const auto row = static_cast<uint64_t>(
+        std::round( static_cast<double>( scrollPosition ) / verticalScrollMultiplicator() ) );
+    return useTextWrap_ ? wrappedLines_->lineOfRow( row ) : LineNumber( row );
 }
 
 double AbstractLogView::verticalScrollMultiplicator() const
 {
+    const auto nbRows = useTextWrap_ ? wrappedLines_->totalRows( logData_->getNbLine() )
+                                     : logData_->getNbLine().get();
     return verticalScrollBar()->maximum() < std::numeric_limits<int>::max()
                ? 1.0
                : static_cast<double>( std::numeric_limits<int>::max() )
-                     / static_cast<double>( logData_->getNbLine().get() );
+                     / static_cast<double>( nbRows );
 }
 
 void AbstractLogView::scrollContentsBy( int dx, int dy )
@@ -1074,31 +1107,77 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
 
 #ifdef GLOGG_PERF_MEASURE_FPS
     static uint32_t maxline = logData_->getNbLine();
-    if ( !perfCounter_.addEvent() && logData_->getNbLine() > maxline ) {
-        LOG_WARNING << "Redraw per second: " << perfCounter_.readAndReset()
-                    << " lines: " << logData_->getNbLine();
+    if ( !perfCounter_.addEvent() ) {
+        const auto redraws = perfCounter_.readAndReset();
+        if ( logData_->getNbLine() > maxline ) {
+            LOG_WARNING << "Redraw per second: " << redraws
+                        << " lines: " << logData_->getNbLine();
+            maxline = logData_->getNbLine();
+        }
+        // Scrolled and highlighted redraws only draw some rows of the text area
+        LOG_WARNING << "Text area redraws per second: " << redrawCounts_.full << " full, "
+                    << redrawCounts_.scrolled << " scrolled, " << redrawCounts_.highlighted
+                    << " highlighted";
+        redrawCounts_ = {};
         perfCounter_.addEvent();
-        maxline = logData_->getNbLine();
     }
 #endif
 
     auto start = std::chrono::system_clock::now();
 
     // Can we use our cache?
-    auto deltaY = textAreaCache_.first_line_.get() - firstLine_.get();
+    highlighting_->prepare( searchPattern_, quickHighlighters_ );
+    const auto isCacheValid = !textAreaCache_.invalid_
+                              && textAreaCache_.first_column_ == firstCol_
+                              && textAreaCache_.highlight_generation_
+                                     == highlighting_->generation();
+    const auto scrolledLines = static_cast<int64_t>( firstLine_.get() )
+                               - static_cast<int64_t>( textAreaCache_.first_line_.get() );
+
+    const auto hasDirtyRows = !textAreaCache_.dirty_rows_.isNull();
+
+    if ( !isCacheValid || scrolledLines != 0 || hasDirtyRows ) {
+        // Lines still visible after scrolling are moved within the cache,
+        // only the exposed ones and the ones with new highlights are drawn
+        QRect dirtyRect;
+        auto isPartialRedraw = false;
+        if ( isCacheValid ) {
+            if ( scrolledLines != 0 ) {
+                dirtyRect = scrollTextAreaCache( scrolledLines );
+            }
+            isPartialRedraw = scrolledLines == 0 || !dirtyRect.isNull();
+        }
 
-    if ( textAreaCache_.invalid_ || ( textAreaCache_.first_column_ != firstCol_ ) ) {
-        // Force a full redraw
-        deltaY = std::numeric_limits<decltype( deltaY )>::max();
-    }
+        if ( isPartialRedraw && hasDirtyRows ) {
+            // Dirty rows have moved with the lines
+            const auto textAreaRect = QRect{ 0, 0, viewport()->width(),
+                                             static_cast<int>( getNbVisibleLines().get() )
+                                                 * charHeight_ };
+            dirtyRect |= textAreaCache_.dirty_rows_
+                             .translated( 0, -static_cast<int>( scrolledLines ) * charHeight_ )
+                             .intersected( textAreaRect );
+        }
 
-    if ( deltaY != 0 ) {
-        // Full or partial redraw
-        drawTextArea( &textAreaCache_.pixmap_ );
+#ifdef GLOGG_PERF_MEASURE_FPS
+        if ( !isPartialRedraw ) {
+            ++redrawCounts_.full;
+        }
+        else {
+            redrawCounts_.scrolled += scrolledLines != 0 ? 1 : 0;
+            redrawCounts_.highlighted += hasDirtyRows ? 1 : 0;
+        }
+#endif
+
+        // Full or partial redraw, rows with highlights may have scrolled away
+        if ( !isPartialRedraw || !dirtyRect.isEmpty() ) {
+            drawTextArea( &textAreaCache_.pixmap_, isPartialRedraw ? dirtyRect : QRect{} );
+        }
 
+        textAreaCache_.dirty_rows_ = {};
         textAreaCache_.invalid_ = false;
         textAreaCache_.first_line_ = firstLine_;
         textAreaCache_.first_column_ = firstCol_;
+        textAreaCache_.highlight_generation_ = highlighting_->generation();
 
         LOG_DEBUG << "End of writing "
                   << std::chrono::duration_cast<std::chrono::microseconds>(
@@ -1163,6 +1242,33 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                      .count();
 }
 
+// Scrolls the cached text area by whole lines and returns the area exposed
+// by scrolling, or a null rect if the cache can't be scrolled: wrapped lines
+// have different heights and fractional scaling would blur moved lines.
+QRect AbstractLogView::scrollTextAreaCache( int64_t scrolledLines )
+{
+    const auto nbVisibleLines = static_cast<int64_t>( getNbVisibleLines().get() );
+    if ( useTextWrap_ || std::abs( scrolledLines ) >= nbVisibleLines ) {
+        return {};
+    }
+
+    const auto lineHeight = charHeight_ * textAreaCache_.pixmap_.devicePixelRatio();
+    if ( lineHeight != std::floor( lineHeight ) ) {
+        return {};
+    }
+
+    // Pixmap is scrolled in device pixels
+    const auto exposedLines = static_cast<int>( std::abs( scrolledLines ) );
+    const auto scrolledPixels = static_cast<int>( lineHeight ) * exposedLines;
+    textAreaCache_.pixmap_.scroll( 0, scrolledLines > 0 ? -scrolledPixels : scrolledPixels,
+                                   textAreaCache_.pixmap_.rect() );
+
+    const auto exposedTop = scrolledLines > 0
+                                ? static_cast<int>( nbVisibleLines - exposedLines ) * charHeight_
+                                : 0;
+    return QRect{ 0, exposedTop, viewport()->width(), exposedLines * charHeight_ };
+}
+
 // These two functions are virtual and this implementation is clearly
 // only valid for a non-filtered display.
 // We count on the 'filtered' derived classes to override them.
@@ -1191,6 +1297,7 @@ void AbstractLogView::setOverview( Overview* overview, OverviewWidget* overviewW
                  &AbstractLogView::jumpToLine );
     }
     refreshOverview();
+    handleQuickFindIndexUpdated();
 }
 
 LineNumber AbstractLogView::getViewPosition() const
@@ -1292,8 +1399,10 @@ void AbstractLogView::followSet( bool checked )
 
 void AbstractLogView::textWrapSet( bool checked )
 {
+    const auto topLine = firstLine_;
     useTextWrap_ = checked;
     updateScrollBars();
+    verticalScrollBar()->setValue( lineNumberToVerticalScroll( topLine ) );
     forceRefresh();
 }
 
@@ -1318,9 +1427,56 @@ void AbstractLogView::handlePatternUpdated()
     LOG_DEBUG << "AbstractLogView::handlePatternUpdated()";
 
     quickFind_->resetLimits();
+    quickFind_->setIndexPattern( quickFindPattern_->getMatcher() );
     forceRefresh();
 }
 
+// Rows of some lines are known now, keep the same line at the top
+void AbstractLogView::handleWrappedLinesIndexUpdated()
+{
+    if ( !useTextWrap_ ) {
+        return;
+    }
+
+    const auto topLine = firstLine_;
+    updateScrollBars();
+    verticalScrollBar()->setValue( lineNumberToVerticalScroll( topLine ) );
+}
+
+// Only rows of the lines with new highlights are drawn again
+void AbstractLogView::handleHighlightedLinesReady( LineNumber first, LinesCount count )
+{
+    const auto cachedFirst = textAreaCache_.first_line_;
+    const auto cachedEnd = cachedFirst + getNbVisibleLines();
+    const auto end = first + count;
+    if ( end <= cachedFirst || first >= cachedEnd ) {
+        return;
+    }
+
+    // Rows of wrapped lines are not known here
+    if ( useTextWrap_ ) {
+        forceRefresh();
+        return;
+    }
+
+    const auto firstRow = static_cast<int>( ( qMax( first, cachedFirst ) - cachedFirst ).get() );
+    const auto endRow = static_cast<int>( ( qMin( end, cachedEnd ) - cachedFirst ).get() );
+    textAreaCache_.dirty_rows_ |= QRect{ 0, firstRow * charHeight_, viewport()->width(),
+                                         ( endRow - firstRow ) * charHeight_ };
+    update();
+}
+
+// Show the QuickFind matches in the overview
+void AbstractLogView::handleQuickFindIndexUpdated()
+{
+    if ( overview_ != nullptr ) {
+        overview_->setQuickFindMatches( quickFind_->indexedMatches() );
+        if ( overviewWidget_ != nullptr ) {
+            overviewWidget_->update();
+        }
+    }
+}
+
 // OR the current selection with the current search expression
 void AbstractLogView::addToSearch()
 {
@@ -1378,25 +1534,60 @@ void AbstractLogView::findPreviousSelected()
 // Copy the selection to the clipboard
 void AbstractLogView::copy()
 {
-
-    try {
-        auto text = selection_.getSelectedText( logData_ );
-        text.replace( QChar::Null, QChar::Space );
-        sendTextToClipboard( text );
-    } catch ( std::exception& err ) {
-        LOG_ERROR << "failed to copy data to clipboard " << err.what();
-    }
+    copySelectedText();
 }
 
 // Copy the selection with line numbers to the clipboard
 void AbstractLogView::copyWithLineNumbers()
 {
-    try {
-        auto text = selection_.getSelectedText( logData_, true );
-        text.replace( QChar::Null, QChar::Space );
-        sendTextToClipboard( text );
-    } catch ( std::exception& err ) {
-        LOG_ERROR << "failed to copy data to clipboard " << err.what();
+    copySelectedText( true );
+}
+
+void AbstractLogView::copySelectedText( bool lineNumbers, bool updateSelection )
+{
+    const auto rangeStart = selection_.selectedRangeStart();
+    const auto nbLines = selection_.getSelectedLinesCount();
+    if ( !rangeStart.has_value() || nbLines.get() < SelectionCopier::MinStreamedLines ) {
+        try {
+            auto text = selection_.getSelectedText( logData_, lineNumbers );
+            text.replace( QChar::Null, QChar::Space );
+            sendTextToClipboard( text, updateSelection );
+        } catch ( std::exception& err ) {
+            LOG_ERROR << "failed to copy data to clipboard " << err.what();
+        }
+        return;
+    }
+
+    // Dialog is modal, so only one copy runs at a time
+    auto* progressDialog = new QProgressDialog( this );
+    progressDialog->setAttribute( Qt::WA_DeleteOnClose );
+    progressDialog->setLabelText( tr( "Copying %1 lines to clipboard" ).arg( nbLines.get() ) );
+    progressDialog->setRange( 0, 100 );
+    progressDialog->setWindowModality( Qt::ApplicationModal );
+
+    connect( selectionCopier_.get(), &SelectionCopier::progressed, progressDialog,
+             &QProgressDialog::setValue );
+    connect( selectionCopier_.get(), &SelectionCopier::finished, progressDialog,
+             &QProgressDialog::close );
+    connect( progressDialog, &QProgressDialog::canceled, selectionCopier_.get(),
+             &SelectionCopier::stop );
+
+    progressDialog->open();
+    selectionCopier_->start( *rangeStart, nbLines, lineNumbers, updateSelection );
+}
+
+// Clipboard can't take the copied lines, they can be saved to a file instead
+void AbstractLogView::handleSelectionTooLargeForClipboard( LineNumber firstLine,
+                                                           LinesCount nbLines, qint64 size )
+{
+    const auto answer = QMessageBox::question(
+        this, tr( "Copy to clipboard" ),
+        tr( "Selected lines take %1, which is more than can be copied to the clipboard "
+            "(%2).\nSave them to a file instead?" )
+            .arg( readableSize( static_cast<uint64_t>( size ) ),
+                  readableSize( static_cast<uint64_t>( SelectionCopier::MaxClipboardBytes ) ) ) );
+    if ( answer == QMessageBox::Yes ) {
+        saveLinesToFile( firstLine, firstLine + nbLines );
     }
 }
 
@@ -1444,6 +1635,15 @@ void AbstractLogView::saveLinesToFile( LineNumber begin, LineNumber end )
         return;
     }
 
+    // Lines are shown as they are in the file if no prefilter changes them
+    const auto* filteredData = dynamic_cast<const LogFilteredData*>( logData_ );
+    const auto* sourceData = filteredData != nullptr ? filteredData->getSourceLogData()
+                                                     : dynamic_cast<const LogData*>( logData_ );
+    if ( sourceData != nullptr && !sourceData->hasPrefilter() ) {
+        saveRawLinesToFile( saveFile, *sourceData, filteredData, begin, end );
+        return;
+    }
+
     QProgressDialog progressDialog( this );
     progressDialog.setLabelText( tr( "Saving content to %1" ).arg( filename ) );
     klogg::vector<std::pair<LineNumber, LinesCount>> offsets;
@@ -1535,6 +1735,66 @@ void AbstractLogView::saveLinesToFile( LineNumber begin, LineNumber end )
     saveFileGraph.wait_for_all();
 }
 
+void AbstractLogView::saveRawLinesToFile( QSaveFile& saveFile, const LogData& sourceData,
+                                          const LogFilteredData* filteredData, LineNumber begin,
+                                          LineNumber end )
+{
+    RawLinesWriter writer( sourceData, saveFile );
+    if ( !writer.open() ) {
+        return;
+    }
+
+    // Filtered lines are resolved and gathered chunk by chunk,
+    // ranges of the source file are copied in pieces of limited size
+    const auto chunkSize = filteredData != nullptr ? 100'000_lcount : 10'000'000_lcount;
+    const auto chunkLinesFrom = [ & ]( LineNumber chunkStart ) {
+        auto lines = LinesCount( std::min( chunkSize.get(), ( end - chunkStart ).get() ) );
+        if ( filteredData != nullptr ) {
+            return lines;
+        }
+
+        while ( lines.get() > 1 ) {
+            const auto [ rangeBegin, rangeEnd ] = sourceData.getLinesByteRange( chunkStart, lines );
+            if ( rangeEnd - rangeBegin <= SaveChunkBytes ) {
+                break;
+            }
+            lines = LinesCount( lines.get() / 2 );
+        }
+        return lines;
+    };
+
+    // Modal dialog processes events when its value is set,
+    // so it can be cancelled between chunks
+    QProgressDialog progressDialog( this );
+    progressDialog.setLabelText( tr( "Saving content to %1" ).arg( saveFile.fileName() ) );
+    progressDialog.setRange( 0, 1000 );
+    progressDialog.setWindowModality( Qt::ApplicationModal );
+    progressDialog.setValue( 0 );
+
+    auto isWritten = true;
+    auto chunkLines = 0_lcount;
+    for ( auto chunkStart = begin; chunkStart < end && isWritten; chunkStart += chunkLines ) {
+        chunkLines = chunkLinesFrom( chunkStart );
+        isWritten = filteredData != nullptr
+                        ? writer.writeLines(
+                            filteredData->getMatchingLineNumbers( chunkStart, chunkLines ) )
+                        : writer.writeLines( chunkStart, chunkLines );
+
+        progressDialog.setValue( static_cast<int>( ( chunkStart + chunkLines - begin ).get()
+                                                   * 1000 / ( end - begin ).get() ) );
+        if ( progressDialog.wasCanceled() ) {
+            return;
+        }
+    }
+
+    if ( isWritten && writer.flush() ) {
+        saveFile.commit();
+    }
+    else {
+        LOG_ERROR << "Saving file write failed";
+    }
+}
+
 void AbstractLogView::updateSearchLimits()
 {
     forceRefresh();
@@ -1597,10 +1857,12 @@ void AbstractLogView::updateData()
     selection_.crop( lastLineNumber - 1_lcount );
 
     // Adapt the scroll bars to the new content
+    wrappedLines_->update();
     updateScrollBars();
 
     // Reset the QuickFind in case we have new stuff to search into
     quickFind_->resetLimits();
+    quickFind_->updateIndex();
 
     if ( followMode_ )
         jumpToBottom();
@@ -1615,6 +1877,11 @@ void AbstractLogView::updateData()
     forceRefresh();
 }
 
+void AbstractLogView::invalidateQuickFindIndex()
+{
+    quickFind_->invalidateIndex();
+}
+
 void AbstractLogView::updateFont( const QFont& font )
 {
     setFont( font );
@@ -2138,48 +2405,22 @@ void AbstractLogView::considerMouseHovering( int xPos, int yPos )
     }
 }
 
-LinesCount AbstractLogView::getNbBottomWrappedVisibleLines() const
+void AbstractLogView::updateScrollBars()
 {
     const LinesCount visibleLines = getNbVisibleLines();
     const LineLength visibleColumns = getNbVisibleCols();
-    if ( useTextWrap_ ) {
-        const auto totalLines = logData_->getNbLine();
-        LinesCount wrappedVisibleLines;
-        LinesCount unwrappedLines;
-        LineNumber unwrappedLineNumber{ logData_->getNbLine().get() - 1 };
-        while ( unwrappedLines < totalLines && unwrappedLines < visibleLines ) {
-            QString expandedLine = logData_->getExpandedLineString( unwrappedLineNumber );
-            WrappedString wrapped{ expandedLine, visibleColumns };
-            wrappedVisibleLines += LinesCount(
-                type_safe::narrow_cast<LinesCount::UnderlyingType>( wrapped.wrappedLinesCount() ) );
-            unwrappedLines++;
-            unwrappedLineNumber--;
-        }
 
-        LOG_INFO << "Bottom visible lines " << visibleLines.get() << " wrapped "
-                 << wrappedVisibleLines.get();
-        return wrappedVisibleLines;
-    }
-    else {
-        return visibleLines;
-    }
-}
+    wrappedLines_->setVisibleColumns( useTextWrap_ ? visibleColumns : 0_length );
+    const auto nbRows = useTextWrap_ ? wrappedLines_->totalRows( logData_->getNbLine() )
+                                     : logData_->getNbLine().get();
 
-void AbstractLogView::updateScrollBars()
-{
-    const LinesCount visibleLines = getNbVisibleLines();
-    const LineLength visibleColumns = getNbVisibleCols();
-    if ( logData_->getNbLine() < visibleLines ) {
+    if ( nbRows < visibleLines.get() ) {
         verticalScrollBar()->setRange( 0, 0 );
     }
     else {
-        const auto visibleWrappedLines = getNbBottomWrappedVisibleLines();
-        const auto wrappedLinesScrollAdjust = ( visibleWrappedLines - visibleLines ).get();
-
         verticalScrollBar()->setRange(
-            0, static_cast<int>( std::min( logData_->getNbLine().get() - visibleLines.get()
-                                               + LinesCount::UnderlyingType{ 1 }
-                                               + wrappedLinesScrollAdjust,
+            0, static_cast<int>( std::min( nbRows - visibleLines.get()
+                                               + LinesCount::UnderlyingType{ 1 },
                                            maxValue<LinesCount>().get() ) ) );
     }
 
@@ -2196,7 +2437,7 @@ void AbstractLogView::updateScrollBars()
         type_safe::narrow_cast<int>( visibleColumns.get() * 7 / 8 ) );
 }
 
-void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
+void AbstractLogView::drawTextArea( QPaintDevice* paintDevice, const QRect& dirtyRect )
 {
     // LOG_DEBUG << "devicePixelRatio: " << viewport()->devicePixelRatio();
     // LOG_DEBUG << "viewport size: " << viewport()->size().width();
@@ -2206,6 +2447,11 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     // LOG_DEBUG << "font: " << viewport()->font().family().toStdString();
     // LOG_DEBUG << "font painter: " << painter->font().family().toStdString();
 
+    const auto isPartialRedraw = !dirtyRect.isNull();
+    if ( isPartialRedraw ) {
+        painter->setClipRect( dirtyRect );
+    }
+
     const int fontHeight = charHeight_;
     const int fontAscent = painter->fontMetrics().ascent();
     const LineLength nbVisibleCols = getNbVisibleCols();
@@ -2216,8 +2462,6 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         = static_cast<int>( std::floor( paintDevice->width() / viewport()->devicePixelRatio() ) );
 
     const QPalette& palette = viewport()->palette();
-    const HighlighterSet& highlighterSet = HighlighterSetCollection::get().currentActiveSet();
-    const auto& quickHighlighters = HighlighterSetCollection::get().quickHighlighters();
     QColor foreColor, backColor;
 
     static const QBrush normalBulletBrush = QBrush( Qt::white );
@@ -2306,52 +2550,36 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     // Lines to write
     const auto logLines = logData_->getLines( firstLine_, nbLines );
 
-    const auto highlightPatternMatches = Configuration::get().mainSearchHighlight();
-    const auto variateHighlightPatternMatches = Configuration::get().variateMainSearchHighlight();
-
-    std::optional<Highlighter> patternHighlight;
-    if ( highlightPatternMatches && !searchPattern_.isBoolean && !searchPattern_.isExclude
-         && !searchPattern_.pattern.isEmpty() ) {
-        const auto mainSearchBackColor = Configuration::get().mainSearchBackColor();
-        patternHighlight = Highlighter{};
-        patternHighlight->setHighlightOnlyMatch( true );
-        patternHighlight->setVariateColors( variateHighlightPatternMatches );
-        patternHighlight->setPattern( searchPattern_.pattern );
-        patternHighlight->setIgnoreCase( !searchPattern_.isCaseSensitive );
-        patternHighlight->setUseRegex( !searchPattern_.isPlainText );
-
-        patternHighlight->setBackColor( mainSearchBackColor );
-        patternHighlight->setForeColor( Qt::black );
-    }
-
-    klogg::vector<Highlighter> additionalHighlighters;
-    for ( auto i = 0u; i < quickHighlighters_.size(); ++i ) {
-        const auto quickHighlighterIndex = static_cast<int>( i );
-        if ( quickHighlighterIndex >= quickHighlighters.size() ) {
-            LOG_WARNING << "Not enough quickHighlighters configured";
-            break;
-        }
-
-        const auto quickHighlighter = quickHighlighters.at( quickHighlighterIndex );
+    // Highlighters are compiled again only if patterns or colors have changed
+    highlighting_->prepare( searchPattern_, quickHighlighters_ );
 
-        std::transform( quickHighlighters_[ i ].begin(), quickHighlighters_[ i ].end(),
-                        std::back_inserter( additionalHighlighters ),
-                        [ quickHighlighter ]( const QString& word ) {
-                            Highlighter h{ word, false, true, quickHighlighter.color.foreColor,
-                                           quickHighlighter.color.backColor };
-                            h.setUseRegex( false );
-                            return h;
-                        } );
+    // Lines are highlighted in background and drawn without highlights
+    // until they are ready
+    const auto highlightPrefetchPages = Configuration::get().highlightPrefetchPages();
+    if ( highlightPrefetchPages > 0 ) {
+        highlightCache_->setContext( *highlighting_ );
     }
 
     // Position in pixel of the base line of the line to print
     int yPos = 0;
     wrappedLinesInfo_.clear();
     klogg::vector<std::pair<QColor, QColor>> highlightColors;
+    TabColumnMap tabColumns;
     for ( auto currentLine = 0_lcount; currentLine < nbLines; ++currentLine ) {
         const auto lineNumber = firstLine_ + currentLine;
         QString logLine = logLines[ currentLine.get() ];
 
+        // Lines moved within the cache are only needed for mouse handling,
+        // partial redraw is done without text wrap, one row per line.
+        if ( isPartialRedraw && !dirtyRect.intersects( QRect{ 0, yPos, 1, fontHeight } ) ) {
+            const QString expandedLine = untabify( std::move( logLine ) );
+            wrappedLinesInfo_.emplace_back( WrappedLineData{
+                lineNumber, 0,
+                WrappedString{ expandedLine, LineLength{ klogg::isize( expandedLine ) + 1 } } } );
+            yPos += fontHeight;
+            continue;
+        }
+
         const int xPos = contentStartPosX + ContentMarginWidth;
 
         HighlightedMatchRanges highlighterMatches;
@@ -2370,63 +2598,44 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                 foreColor = palette.brush( QPalette::Disabled, QPalette::Text ).color();
             }
             else {
-                const auto highlightType = highlighterSet.matchLine( logLine, highlighterMatches );
+                auto highlightType = HighlighterMatchType::NoMatch;
+                if ( highlightPrefetchPages > 0 ) {
+                    if ( const auto* cached = highlightCache_->find( lineNumber, logLine ) ) {
+                        highlightType = cached->type;
+                        highlighterMatches = cached->matches;
+                    }
+                }
+                else {
+                    highlightType = highlighting_->matchLine( logLine, highlighterMatches );
+                }
 
                 if ( highlightType == HighlighterMatchType::LineMatch ) {
                     // color applies to whole line
                     foreColor = highlighterMatches.front().foreColor();
                     backColor = highlighterMatches.front().backColor();
                 }
-
-                if ( patternHighlight ) {
-                    klogg::vector<HighlightedMatch> patternMatches;
-                    patternHighlight->matchLine( logLine, patternMatches );
-                    highlighterMatches.addMatches( patternMatches );
-                }
-
-                // highlighterMatches.reserve( additionalHighlighters.size() );
-                for ( const auto& highlighter : additionalHighlighters ) {
-                    klogg::vector<HighlightedMatch> patternMatches;
-                    highlighter.matchLine( logLine, patternMatches );
-                    highlighterMatches.addMatches( patternMatches );
-                }
             }
         }
 
-        const auto untabifyHighlight = [ &logLine ]( const auto& match ) {
-            const auto prefix = QStringView{ logLine }.left( match.startColumn().get() );
-            const auto matchPart
-                = QStringView{ logLine }.mid( match.startColumn().get(), match.size().get() );
-            const auto expandedPrefixLength = untabify( prefix.toString() ).size();
-            const LineLength startDelta
-                = LineLength{ type_safe::narrow_cast<LineLength::UnderlyingType>(
-                    expandedPrefixLength - prefix.size() ) };
-
-            const LineLength expandedMatchLength = LineLength{
-                untabify( matchPart.toString(),
-                          LineColumn{ type_safe::narrow_cast<LineColumn::UnderlyingType>(
-                              expandedPrefixLength ) } )
-                    .size()
-            };
-
-            const auto lengthDelta
-                = expandedMatchLength
-                  - LineLength{ type_safe::narrow_cast<LineLength::UnderlyingType>(
-                      matchPart.size() ) };
-
-            return HighlightedMatch{ match.startColumn() + startDelta, match.size() + lengthDelta,
-                                     match.foreColor(), match.backColor() };
+        // string to print, cut to fit the length and position of the view
+        const QString expandedLine = untabify( std::move( logLine ), 0_lcol, &tabColumns );
+
+        // Highlighters match the raw line, selection and quick find
+        // work with columns of the expanded one already
+        const auto untabifyHighlight = [ &tabColumns ]( const HighlightedMatch& match ) {
+            const auto start = tabColumns.expandedColumn( match.startColumn() );
+            const auto end = tabColumns.expandedColumn( match.startColumn() + match.size() );
+            return HighlightedMatch{ start, end - start, match.foreColor(), match.backColor() };
         };
 
         klogg::vector<HighlightedMatch> sortedHighlights = highlighterMatches.matches();
-        std::transform( sortedHighlights.begin(), sortedHighlights.end(), sortedHighlights.begin(),
-                        untabifyHighlight );
+        if ( !tabColumns.empty() ) {
+            std::transform( sortedHighlights.begin(), sortedHighlights.end(),
+                            sortedHighlights.begin(), untabifyHighlight );
+        }
 
         HighlightedMatchRanges allHighlights{ std::move( sortedHighlights ) };
 
-        // string to print, cut to fit the length and position of the view
-        const QString& expandedLine = untabify( std::move( logLine ) );
-
         // Has the line got elements to be highlighted
         klogg::vector<HighlightedMatch> quickFindMatches;
         quickFindPattern_->matchLine( expandedLine, quickFindMatches );
@@ -2571,6 +2780,13 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             break;
         }
     } // For each line
+
+    if ( highlightPrefetchPages > 0 ) {
+        highlightCache_->request(
+            firstLine_, nbLines,
+            LinesCount( nbLines.get() * static_cast<LinesCount::UnderlyingType>(
+                                            highlightPrefetchPages ) ) );
+    }
 }
 
 // Draw the "pull to follow" bar and return a pixmap.
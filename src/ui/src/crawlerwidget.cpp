@@ -58,6 +58,7 @@
 #include <QKeySequence>
 #include <QLineEdit>
 #include <QListView>
+#include <QMessageBox>
 #include <QShortcut>
 #include <QStandardItemModel>
 #include <QStringListModel>
@@ -181,6 +182,14 @@ QString CrawlerWidget::getSelectedText() const
         return logMainView_->getSelectedText();
 }
 
+void CrawlerWidget::copySelectedText()
+{
+    if ( filteredView_->hasFocus() )
+        filteredView_->copySelectedText( false, true );
+    else
+        logMainView_->copySelectedText( false, true );
+}
+
 bool CrawlerWidget::isPartialSelection() const
 {
     if ( filteredView_->hasFocus() )
@@ -310,6 +319,71 @@ void CrawlerWidget::goToLine()
     }
 }
 
+std::optional<int64_t> CrawlerWidget::askForTime( const QString& title, const QString& label,
+                                                  bool* isAccepted )
+{
+    const auto format = logData_->getTimestampFormat();
+    if ( format.isEmpty() ) {
+        QMessageBox::information( this, title, tr( "No timestamps found in this file" ) );
+        *isAccepted = false;
+        return {};
+    }
+
+    const auto time = QInputDialog::getText( this, title, QString( "%1 (%2)" ).arg( label, format ),
+                                             QLineEdit::Normal, {}, isAccepted );
+    if ( !*isAccepted || time.trimmed().isEmpty() ) {
+        return {};
+    }
+
+    const auto timestamp = logData_->parseTimestamp( time, currentLineNumber_ );
+    if ( !timestamp ) {
+        QMessageBox::warning( this, title, tr( "Time does not match format %1" ).arg( format ) );
+        *isAccepted = false;
+    }
+
+    return timestamp;
+}
+
+void CrawlerWidget::goToTime()
+{
+    bool isTimeSelected = false;
+    const auto timestamp = askForTime( tr( "Jump to time" ), tr( "Time" ), &isTimeSelected );
+    if ( !timestamp ) {
+        return;
+    }
+
+    const auto line = logData_->getLineForTimestamp( *timestamp );
+    const auto selectedLine
+        = line ? *line : LineNumber( logData_->getNbLine().get() ) - LinesCount( 1u );
+
+    filteredView_->trySelectLine( logFilteredData_->getLineIndexNumber( selectedLine ) );
+    logMainView_->trySelectLine( selectedLine );
+}
+
+void CrawlerWidget::setSearchTimeRange()
+{
+    bool isAccepted = false;
+    const auto from = askForTime( tr( "Search time range" ), tr( "From" ), &isAccepted );
+    if ( !isAccepted ) {
+        return;
+    }
+
+    const auto to = askForTime( tr( "Search time range" ), tr( "To" ), &isAccepted );
+    if ( !isAccepted ) {
+        return;
+    }
+
+    const auto endOfFile = LineNumber( logData_->getNbLine().get() );
+
+    const auto startLine
+        = from ? logData_->getLineForTimestamp( *from ).value_or( endOfFile ) : 0_lnum;
+    // Lines with the same time as the end of range are included
+    const auto endLine
+        = to ? logData_->getLineForTimestamp( *to + 1 ).value_or( endOfFile ) : endOfFile;
+
+    setSearchLimits( startLine, std::max( startLine, endLine ) );
+}
+
 //
 // Protected functions
 //
@@ -561,29 +635,23 @@ void CrawlerWidget::updateLineNumberHandler( LineNumber line, LinesCount nLines,
 
 void CrawlerWidget::markLinesFromMain( const klogg::vector<LineNumber>& lines )
 {
-    klogg::vector<LineNumber> alreadyMarkedLines;
-    alreadyMarkedLines.reserve( lines.size() );
-
-    bool markAdded = false;
+    klogg::vector<uint64_t> lineNumbers;
+    lineNumbers.reserve( lines.size() );
     for ( const auto& line : lines ) {
-        if ( line >= logData_->getNbLine() ) {
-            continue;
-        }
-
-        if ( !logFilteredData_->lineTypeByLine( line ).testFlag(
-                 AbstractLogData::LineTypeFlags::Mark ) ) {
-            logFilteredData_->addMark( line );
-            markAdded = true;
-        }
-        else {
-            alreadyMarkedLines.push_back( line );
+        if ( line < logData_->getNbLine() ) {
+            lineNumbers.push_back( line.get() );
         }
     }
 
-    if ( !markAdded ) {
-        for ( const auto& line : alreadyMarkedLines ) {
-            logFilteredData_->toggleMark( line );
-        }
+    SearchResultArray linesToMark;
+    linesToMark.addMany( lineNumbers.size(), lineNumbers.data() );
+
+    // Unmark lines only if all of them are already marked
+    if ( linesToMark.isSubsetOf( logFilteredData_->getMarkedLines()->lines ) ) {
+        logFilteredData_->removeMarks( linesToMark );
+    }
+    else {
+        logFilteredData_->addMarks( linesToMark );
     }
 
     // Recompute the content of both window.
@@ -741,6 +809,7 @@ void CrawlerWidget::fileChangedHandler( MonitoredFileStatus status )
     if ( status == MonitoredFileStatus::Truncated ) {
         // Clear all marks (TODO offer the option to keep them)
         logFilteredData_->clearMarks();
+        logMainView_->invalidateQuickFindIndex();
         if ( !searchInfoLine_->text().isEmpty() ) {
             // Invalidate the search
             constexpr auto DropCache = true;
@@ -976,8 +1045,11 @@ void CrawlerWidget::setup()
     filteredViewsData_[ filteredView_ ] = logFilteredData_;
     filteredView_->setContentsMargins( 2, 0, 2, 0 );
 
+    overview_.setLogData( logData_.get() );
     overviewWidget_->setOverview( &overview_ );
     overviewWidget_->setParent( logMainView_ );
+    connect( &overview_, &Overview::linesUpdated, overviewWidget_,
+             QOverload<>::of( &OverviewWidget::update ) );
 
     // Connect the search to the top view
     logMainView_->useNewFiltering( logFilteredData_.get() );
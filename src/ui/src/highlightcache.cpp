@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "highlightcache.h"
+
+#include <QtConcurrent>
+
+#include "abstractlogdata.h"
+#include "log.h"
+
+HighlightCache::HighlightCache( const AbstractLogData& logData )
+    : logData_( logData )
+{
+    connect( &watcher_, &QFutureWatcher<HighlightedLines>::finished, this,
+             &HighlightCache::onHighlightingFinished );
+}
+
+HighlightCache::~HighlightCache()
+{
+    stop();
+}
+
+void HighlightCache::setContext( const HighlightingContext& context )
+{
+    if ( context_ && context.generation() == generation_ ) {
+        return;
+    }
+
+    LOG_DEBUG << "Highlighting context changed, dropping " << lines_.size() << " lines";
+
+    // Running highlighting is discarded when finished
+    interruptRequested_.set();
+
+    generation_ = context.generation();
+    context_ = context.clone();
+    lines_.clear();
+}
+
+const HighlightCache::LineHighlights* HighlightCache::find( LineNumber line,
+                                                           const QString& text )
+{
+    const auto cached = lines_.find( line.get() );
+    if ( cached == lines_.end() ) {
+        return nullptr;
+    }
+
+    if ( cached->second.text != text ) {
+        // Line has changed, it will be highlighted again
+        lines_.erase( cached );
+        return nullptr;
+    }
+
+    return &cached->second;
+}
+
+void HighlightCache::request( LineNumber firstVisible, LinesCount visibleLines,
+                              LinesCount prefetchLines )
+{
+    const auto nbLines = logData_.getNbLine();
+    const auto clampCount = [ nbLines ]( LineNumber first, LinesCount count ) {
+        return first.get() >= nbLines.get() ? 0_lcount
+                                            : LinesCount( qMin( count.get(), nbLines.get()
+                                                                                 - first.get() ) );
+    };
+
+    const auto windowFirst = firstVisible.get() > prefetchLines.get()
+                                 ? firstVisible - prefetchLines
+                                 : 0_lnum;
+    const auto window = LinesRange{
+        windowFirst, clampCount( windowFirst, LinesCount( firstVisible.get() - windowFirst.get()
+                                                          + visibleLines.get()
+                                                          + prefetchLines.get() ) )
+    };
+    const auto visible = LinesRange{ firstVisible, clampCount( firstVisible, visibleLines ) };
+
+    if ( window != window_ ) {
+        for ( auto line = lines_.begin(); line != lines_.end(); ) {
+            if ( line->first < window.first.get()
+                 || line->first >= window.first.get() + window.second.get() ) {
+                line = lines_.erase( line );
+            }
+            else {
+                ++line;
+            }
+        }
+    }
+
+    if ( visible != visible_ && watcher_.isRunning() ) {
+        // Lines computed so far are kept, the rest is computed for the new window
+        interruptRequested_.set();
+    }
+
+    visible_ = visible;
+    window_ = window;
+
+    if ( !watcher_.isRunning() ) {
+        startHighlighting();
+    }
+}
+
+void HighlightCache::stop()
+{
+    interruptRequested_.set();
+    watcher_.waitForFinished();
+}
+
+klogg::vector<HighlightCache::LinesRange> HighlightCache::missingLines() const
+{
+    const auto addMissing = [ this ]( klogg::vector<LinesRange>& ranges, LineNumber first,
+                                      LineNumber end ) {
+        for ( auto line = first; line < end; ++line ) {
+            if ( lines_.count( line.get() ) > 0 ) {
+                continue;
+            }
+
+            if ( !ranges.empty()
+                 && ranges.back().first + ranges.back().second == line ) {
+                ++ranges.back().second;
+            }
+            else {
+                ranges.emplace_back( line, 1_lcount );
+            }
+        }
+    };
+
+    klogg::vector<LinesRange> ranges;
+    addMissing( ranges, visible_.first, visible_.first + visible_.second );
+    if ( !ranges.empty() ) {
+        return ranges;
+    }
+
+    // Lines below the view are the most likely to be shown next
+    addMissing( ranges, visible_.first + visible_.second, window_.first + window_.second );
+    addMissing( ranges, window_.first, visible_.first );
+    return ranges;
+}
+
+void HighlightCache::startHighlighting()
+{
+    const auto ranges = missingLines();
+    if ( ranges.empty() || !context_ ) {
+        return;
+    }
+
+    interruptRequested_.clear();
+
+    watcher_.setFuture( QtConcurrent::run(
+        [ this, ranges, context = context_, generation = generation_ ]() {
+            HighlightedLines result;
+            result.generation = generation;
+
+            for ( const auto& [ first, count ] : ranges ) {
+                const auto texts = logData_.getLines( first, count );
+                for ( auto index = 0u; index < texts.size(); ++index ) {
+                    if ( interruptRequested_ ) {
+                        result.isInterrupted = true;
+                        return result;
+                    }
+
+                    LineHighlights highlights;
+                    highlights.text = texts[ index ];
+                    highlights.type = context->matchLine( highlights.text, highlights.matches );
+                    result.lines.emplace_back( first + LinesCount( index ),
+                                               std::move( highlights ) );
+                }
+            }
+
+            return result;
+        } ) );
+}
+
+void HighlightCache::onHighlightingFinished()
+{
+    auto result = watcher_.result();
+
+    if ( result.generation == generation_ && !result.lines.empty() ) {
+        OptionalLineNumber firstVisible;
+        OptionalLineNumber lastVisible;
+        for ( auto& [ line, highlights ] : result.lines ) {
+            if ( line >= window_.first && line < window_.first + window_.second ) {
+                lines_[ line.get() ] = std::move( highlights );
+            }
+
+            if ( line >= visible_.first && line < visible_.first + visible_.second ) {
+                firstVisible = firstVisible ? qMin( *firstVisible, line ) : line;
+                lastVisible = lastVisible ? qMax( *lastVisible, line ) : line;
+            }
+        }
+
+        if ( firstVisible ) {
+            Q_EMIT linesReady( *firstVisible, *lastVisible - *firstVisible + 1_lcount );
+        }
+    }
+
+    // Lines past the end of a truncated file are never returned
+    if ( result.isInterrupted || !result.lines.empty() ) {
+        startHighlighting();
+    }
+}
@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "highlighterdensity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#include <QtConcurrent>
+
+#include "configuration.h"
+#include "highlighterset.h"
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+
+// Counts of lines counted so far are published at most this often
+constexpr auto ProgressInterval = std::chrono::milliseconds( 500 );
+
+// Merges buckets by pairs, so each of them has twice more lines
+void mergeBuckets( klogg::vector<uint32_t>& matchedLines, size_t nbHighlighters )
+{
+    const auto nbBuckets = matchedLines.size() / nbHighlighters;
+    for ( auto bucket = 0u; bucket < nbBuckets; ++bucket ) {
+        const auto target = ( bucket / 2 ) * nbHighlighters;
+        const auto source = bucket * nbHighlighters;
+        for ( auto highlighter = 0u; highlighter < nbHighlighters; ++highlighter ) {
+            matchedLines[ target + highlighter ]
+                = bucket % 2 == 0 ? matchedLines[ source + highlighter ]
+                                  : matchedLines[ target + highlighter ]
+                                        + matchedLines[ source + highlighter ];
+        }
+    }
+    matchedLines.resize( ( nbBuckets + 1 ) / 2 * nbHighlighters );
+}
+
+} // namespace
+
+HighlighterDensity::HighlighterDensity( const LogData& logData )
+    : logData_( logData )
+{
+    connect( &countingWatcher_, &QFutureWatcher<void>::finished, this,
+             &HighlighterDensity::onCountingFinished );
+}
+
+HighlighterDensity::~HighlighterDensity()
+{
+    stop();
+}
+
+void HighlighterDensity::update()
+{
+    const auto& activeSet = HighlighterSetCollection::get().currentActiveSet();
+    if ( activeSet.isEmpty() || !Configuration::get().useHighlightersDensity() ) {
+        if ( countingHighlighters_ != nullptr ) {
+            stop();
+            isUpdatePending_ = false;
+            countingHighlighters_.reset();
+            {
+                ScopedLock lock( mutex_ );
+                counts_.reset();
+            }
+            Q_EMIT densityUpdated();
+        }
+        return;
+    }
+
+    if ( !activeSet.compiledExpression_ ) {
+        activeSet.compile();
+    }
+
+    if ( countingWatcher_.isRunning() ) {
+        // Counts for the previous set are not needed anymore
+        if ( countingHighlighters_ != activeSet.compiledExpression_ ) {
+            interruptRequested_.set();
+        }
+        isUpdatePending_ = true;
+        return;
+    }
+
+    {
+        ScopedLock lock( mutex_ );
+        if ( counts_ != nullptr && counts_->highlighters == activeSet.compiledExpression_
+             && counts_->countedLines == logData_.getNbLine() ) {
+            return;
+        }
+    }
+
+    startCounting( activeSet );
+}
+
+void HighlighterDensity::stop()
+{
+    interruptRequested_.set();
+    countingWatcher_.waitForFinished();
+}
+
+klogg::vector<QColor> HighlighterDensity::rowColors( unsigned height,
+                                                     LinesCount linesInFile ) const
+{
+    klogg::vector<QColor> colors( height );
+
+    CountsSnapshot counts;
+    {
+        ScopedLock lock( mutex_ );
+        counts = counts_;
+    }
+
+    if ( counts == nullptr || counts->colors.empty() || linesInFile.get() == 0 ) {
+        return colors;
+    }
+
+    const auto nbHighlighters = counts->colors.size();
+    const auto nbBuckets
+        = static_cast<uint64_t>( counts->matchedLines.size() / nbHighlighters );
+    const auto linesBeforeRow = [ height, linesInFile ]( uint64_t row ) {
+        return ( row * linesInFile.get() + height - 1 ) / height;
+    };
+
+    klogg::vector<uint64_t> rowLines( nbHighlighters );
+    for ( auto row = 0u; row < height; ++row ) {
+        const auto firstLine = linesBeforeRow( row );
+        const auto endLine = linesBeforeRow( row + 1 );
+        if ( firstLine >= endLine ) {
+            continue;
+        }
+
+        // Buckets partially in the row are counted as a whole
+        const auto firstBucket = firstLine / counts->linesPerBucket;
+        const auto endBucket = std::min( ( endLine - 1 ) / counts->linesPerBucket + 1, nbBuckets );
+
+        std::fill( rowLines.begin(), rowLines.end(), 0 );
+        for ( auto bucket = firstBucket; bucket < endBucket; ++bucket ) {
+            for ( auto highlighter = 0u; highlighter < nbHighlighters; ++highlighter ) {
+                rowLines[ highlighter ]
+                    += counts->matchedLines[ bucket * nbHighlighters + highlighter ];
+            }
+        }
+
+        // First highlighter of the set wins a tie, as it does when drawing lines
+        const auto dominant = std::max_element( rowLines.begin(), rowLines.end() );
+        if ( *dominant > 0 ) {
+            colors[ row ] = counts->colors[ static_cast<size_t>(
+                std::distance( rowLines.begin(), dominant ) ) ];
+        }
+    }
+
+    return colors;
+}
+
+void HighlighterDensity::onCountingFinished()
+{
+    Q_EMIT densityUpdated();
+
+    if ( isUpdatePending_ ) {
+        isUpdatePending_ = false;
+        update();
+    }
+}
+
+void HighlighterDensity::startCounting( const HighlighterSet& activeSet )
+{
+    Counts counts;
+    {
+        ScopedLock lock( mutex_ );
+        if ( counts_ != nullptr && counts_->highlighters == activeSet.compiledExpression_ ) {
+            counts = *counts_;
+        }
+    }
+
+    if ( counts.highlighters == nullptr ) {
+        counts.highlighters = activeSet.compiledExpression_;
+        for ( const auto& highlighter : activeSet.highlighterList_ ) {
+            counts.colors.push_back( highlighter.backColor() );
+        }
+    }
+
+    klogg::vector<QRegularExpression> regexps;
+    for ( const auto highlighter : counts.highlighters->regexHighlighters ) {
+        regexps.push_back( static_cast<QRegularExpression>(
+            activeSet.highlighterList_[ highlighter ].expressionPattern() ) );
+        regexps.back().optimize();
+    }
+
+    countingHighlighters_ = counts.highlighters;
+    interruptRequested_.clear();
+    countingWatcher_.setFuture(
+        QtConcurrent::run( [ this, counts = std::move( counts ),
+                             regexps = std::move( regexps ) ]() mutable {
+            count( std::move( counts ), regexps );
+        } ) );
+}
+
+void HighlighterDensity::count( Counts counts,
+                                const klogg::vector<QRegularExpression>& regexps )
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto nbLines = logData_.getNbLine();
+    const auto nbHighlighters = counts.colors.size();
+
+    if ( nbLines < counts.countedLines ) {
+        counts.linesPerBucket = 1;
+        counts.countedLines = 0_lcount;
+        counts.matchedLines.clear();
+        counts.lastLineMatches.clear();
+    }
+
+    const auto bucketOffset = [ &counts, nbHighlighters ]( uint64_t line ) {
+        return line / counts.linesPerBucket * nbHighlighters;
+    };
+
+    // The last counted line could have been incomplete
+    auto begin = 0_lnum;
+    if ( counts.countedLines.get() > 0 ) {
+        begin = LineNumber( counts.countedLines.get() - 1 );
+        const auto offset = bucketOffset( begin.get() );
+        for ( auto highlighter = 0u; highlighter < nbHighlighters; ++highlighter ) {
+            counts.matchedLines[ offset + highlighter ]
+                -= static_cast<uint32_t>( counts.lastLineMatches[ highlighter ] );
+        }
+        counts.countedLines = LinesCount( begin.get() );
+    }
+
+    const auto& highlighters = *counts.highlighters;
+    const auto regexMatcher = highlighters.regexExpression
+                                  ? highlighters.regexExpression->createMatcher()
+                                  : nullptr;
+    const auto plainTextMatcher = highlighters.plainTextExpression
+                                      ? highlighters.plainTextExpression->createMatcher()
+                                      : nullptr;
+
+    const auto chunkSize = static_cast<LinesCount::UnderlyingType>(
+        qMax( 1, Configuration::get().searchReadBufferSizeLines() ) );
+
+    klogg::vector<char> lineMatches( nbHighlighters );
+    auto lastProgress = startTime;
+    while ( counts.countedLines < nbLines ) {
+        if ( interruptRequested_ ) {
+            return;
+        }
+
+        const auto chunkStart = LineNumber( counts.countedLines.get() );
+        const auto rawLines = logData_.getLinesRaw(
+            chunkStart, LinesCount( std::min( chunkSize, nbLines.get() - chunkStart.get() ) ) );
+        const auto& lines = rawLines.buildUtf8View();
+        if ( lines.empty() ) {
+            break;
+        }
+
+        for ( auto index = 0u; index < lines.size(); ++index ) {
+            const auto line = chunkStart.get() + index;
+            while ( line / counts.linesPerBucket >= MaxBuckets ) {
+                mergeBuckets( counts.matchedLines, nbHighlighters );
+                counts.linesPerBucket *= 2;
+            }
+
+            const auto offset = bucketOffset( line );
+            if ( counts.matchedLines.size() < offset + nbHighlighters ) {
+                counts.matchedLines.resize( offset + nbHighlighters );
+            }
+
+            std::fill( lineMatches.begin(), lineMatches.end(), 0 );
+            if ( regexMatcher ) {
+                const auto matchedPatterns = regexMatcher->matchingPatterns( lines[ index ] );
+
+                // Prefilter may report lines the pattern doesn't match
+                QString lineText;
+                for ( auto pattern = 0u; pattern < matchedPatterns.size(); ++pattern ) {
+                    if ( !matchedPatterns[ pattern ] ) {
+                        continue;
+                    }
+
+                    if ( lineText.isNull() ) {
+                        auto line = lines[ index ];
+                        if ( !line.empty() && line.back() == '\r' ) {
+                            line.remove_suffix( 1 );
+                        }
+                        lineText = QString::fromUtf8( line.data(), klogg::isize( line ) );
+                    }
+
+                    if ( regexps[ pattern ].match( lineText ).hasMatch() ) {
+                        lineMatches[ static_cast<size_t>(
+                            highlighters.regexHighlighters[ pattern ] ) ] = 1;
+                    }
+                }
+            }
+            if ( plainTextMatcher ) {
+                const auto matchedPatterns = plainTextMatcher->matchingPatterns( lines[ index ] );
+                for ( auto pattern = 0u; pattern < matchedPatterns.size(); ++pattern ) {
+                    if ( matchedPatterns[ pattern ] ) {
+                        lineMatches[ static_cast<size_t>(
+                            highlighters.plainTextHighlighters[ pattern ] ) ] = 1;
+                    }
+                }
+            }
+
+            for ( auto highlighter = 0u; highlighter < nbHighlighters; ++highlighter ) {
+                counts.matchedLines[ offset + highlighter ]
+                    += static_cast<uint32_t>( lineMatches[ highlighter ] );
+            }
+        }
+
+        counts.lastLineMatches = lineMatches;
+        counts.countedLines = LinesCount( chunkStart.get() + lines.size() );
+
+        const auto now = std::chrono::steady_clock::now();
+        if ( now - lastProgress > ProgressInterval ) {
+            publish( counts );
+            lastProgress = now;
+            Q_EMIT densityUpdated();
+        }
+    }
+
+    LOG_INFO << "Highlighters density counted " << ( counts.countedLines.get() - begin.get() )
+             << " lines in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startTime )
+                    .count()
+             << " ms, " << counts.linesPerBucket << " lines per bucket";
+
+    publish( std::move( counts ) );
+}
+
+void HighlighterDensity::publish( Counts counts )
+{
+    auto snapshot = std::make_shared<const Counts>( std::move( counts ) );
+
+    ScopedLock lock( mutex_ );
+    counts_ = std::move( snapshot );
+}
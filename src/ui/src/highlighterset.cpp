@@ -49,6 +49,7 @@
 
 #include <simdutf.h>
 
+#include "configuration.h"
 #include "containers.h"
 #include "crc32.h"
 #include "highlightersetedit.h"
@@ -185,6 +186,16 @@ RegularExpressionPattern Highlighter::expressionPattern() const
     return result;
 }
 
+bool Highlighter::isPlainText() const
+{
+    return !useRegex_ && !regexp_.pattern().isEmpty();
+}
+
+RegularExpressionPattern Highlighter::plainTextPattern() const
+{
+    return RegularExpressionPattern{ regexp_.pattern(), !ignoreCase(), false, false, true };
+}
+
 void Highlighter::compile() const
 {
     const auto pattern
@@ -229,6 +240,16 @@ bool Highlighter::matchLine( const QString& line, klogg::vector<HighlightedMatch
     return ( !matches.empty() );
 }
 
+HighlightedMatch Highlighter::spanMatch( const QString& line, LineColumn start,
+                                         LineLength length ) const
+{
+    const auto colors = variateColors_ && highlightOnlyMatch_
+                            ? vairateColors( line.mid( start.get(), length.get() ) )
+                            : std::make_pair( color_.foreColor, color_.backColor );
+
+    return HighlightedMatch{ start, length, colors.first, colors.second };
+}
+
 HighlighterSet HighlighterSet::createNewSet( const QString& name )
 {
     return HighlighterSet{ name };
@@ -257,44 +278,120 @@ bool HighlighterSet::isEmpty() const
 
 void HighlighterSet::compile() const
 {
-    klogg::vector<RegularExpressionPattern> patterns(
-        static_cast<size_t>( highlighterList_.size() ) );
-    std::transform( highlighterList_.begin(), highlighterList_.end(), patterns.begin(),
-                    []( const Highlighter& hl ) { return hl.expressionPattern(); } );
+    auto compiled = std::make_shared<CompiledHighlighterSet>();
+
+    klogg::vector<RegularExpressionPattern> regexPatterns;
+    klogg::vector<RegularExpressionPattern> plainTextPatterns;
+    for ( int index = 0; index < highlighterList_.size(); ++index ) {
+        const auto& highlighter = highlighterList_[ index ];
+        if ( highlighter.isPlainText() ) {
+            compiled->plainTextHighlighters.push_back( index );
+            plainTextPatterns.push_back( highlighter.plainTextPattern() );
+        }
+        else {
+            compiled->regexHighlighters.push_back( index );
+            regexPatterns.push_back( highlighter.expressionPattern() );
+        }
+    }
+
+    if ( !regexPatterns.empty() ) {
+        compiled->regexExpression = std::make_unique<MultiRegularExpression>( regexPatterns );
+    }
+    if ( !plainTextPatterns.empty() ) {
+        compiled->plainTextExpression
+            = std::make_unique<SpanRegularExpression>( plainTextPatterns );
+    }
 
-    compiledExpression_ = std::make_shared<MultiRegularExpression>( patterns );
+    compiledExpression_ = std::move( compiled );
 }
 
 HighlighterMatchType HighlighterSet::matchLine( const QString& line,
                                                 HighlightedMatchRanges& matches ) const
 {
-    if ( highlighterList_.empty() ) {
+    HighlighterSetMatcher matcher;
+    return matcher.matchLine( *this, line, matches );
+}
+
+HighlighterMatchType HighlighterSetMatcher::matchLine( const HighlighterSet& set,
+                                                       const QString& line,
+                                                       HighlightedMatchRanges& matches )
+{
+    const auto& highlighterList = set.highlighterList_;
+    if ( highlighterList.empty() ) {
         return HighlighterMatchType::NoMatch;
     }
 
-    if ( !compiledExpression_ ) {
-        compile();
+    if ( !set.compiledExpression_ ) {
+        set.compile();
     }
 
-    klogg::vector<char> utf8Data( static_cast<size_t>( line.size() * 4 ) );
+    if ( expression_ != set.compiledExpression_ ) {
+        expression_ = set.compiledExpression_;
+        regexMatcher_ = expression_->regexExpression
+                            ? expression_->regexExpression->createMatcher()
+                            : nullptr;
+        plainTextMatcher_ = expression_->plainTextExpression
+                                ? expression_->plainTextExpression->createMatcher()
+                                : nullptr;
+    }
+
+    const auto maxUtf8Size = static_cast<size_t>( line.size() * 4 );
+    if ( utf8Data_.size() < maxUtf8Size ) {
+        utf8Data_.resize( maxUtf8Size );
+    }
     const auto resultSize
         = simdutf::convert_utf16_to_utf8( reinterpret_cast<const char16_t*>( line.utf16() ),
-                                          static_cast<size_t>( line.size() ), utf8Data.data() );
+                                          static_cast<size_t>( line.size() ), utf8Data_.data() );
+
+    const auto utf8Line = std::string_view{ utf8Data_.data(), resultSize };
+
+    matchedHighlighters_.assign( static_cast<size_t>( highlighterList.size() ), 0 );
+    highlighterSpans_.assign( static_cast<size_t>( highlighterList.size() ), { 0, 0 } );
 
-    auto matcher = compiledExpression_->createMatcher();
-    klogg::vector<std::pair<RegularExpressionPattern, bool>> matchedPatterns
-        = matcher->match( std::string_view{ utf8Data.data(), resultSize } );
+    if ( regexMatcher_ ) {
+        const auto matchedPatterns = regexMatcher_->matchingPatterns( utf8Line );
+        for ( auto pattern = 0u; pattern < matchedPatterns.size(); ++pattern ) {
+            const auto index = static_cast<size_t>( expression_->regexHighlighters[ pattern ] );
+            matchedHighlighters_[ index ] = matchedPatterns[ pattern ];
+        }
+    }
+
+    // Spans come sorted by pattern, so spans of a highlighter are contiguous
+    static const MatchedSpans NoSpans;
+    const auto& spans
+        = plainTextMatcher_ ? plainTextMatcher_->match( line, utf8Line ) : NoSpans;
+    for ( auto span = 0u; span < spans.size(); ++span ) {
+        const auto index
+            = static_cast<size_t>( expression_->plainTextHighlighters[ spans[ span ].id ] );
+        if ( !matchedHighlighters_[ index ] ) {
+            matchedHighlighters_[ index ] = true;
+            highlighterSpans_[ index ].first = span;
+        }
+        highlighterSpans_[ index ].second = span + 1;
+    }
 
     auto matchType = HighlighterMatchType::NoMatch;
 
-    for ( int index = static_cast<int>( highlighterList_.size() ) - 1; index >= 0; --index ) {
-        const Highlighter& hl = highlighterList_[ index ];
-        if ( !matchedPatterns[ static_cast<size_t>( index ) ].second ) {
+    for ( int index = static_cast<int>( highlighterList.size() ) - 1; index >= 0; --index ) {
+        const Highlighter& hl = highlighterList[ index ];
+        const auto& highlighterSpans = highlighterSpans_[ static_cast<size_t>( index ) ];
+        if ( !matchedHighlighters_[ static_cast<size_t>( index ) ] ) {
             continue;
         }
 
-        klogg::vector<HighlightedMatch> thisMatches;
-        if ( !hl.matchLine( line, thisMatches ) ) {
+        if ( highlighterSpans.first != highlighterSpans.second ) {
+            if ( hl.highlightOnlyMatch() ) {
+                highlighterMatches_.clear();
+                for ( auto spanIndex = highlighterSpans.first;
+                      spanIndex < highlighterSpans.second; ++spanIndex ) {
+                    const auto& span = spans[ spanIndex ];
+                    highlighterMatches_.push_back( hl.spanMatch(
+                        line, LineColumn{ static_cast<qsizetype>( span.from ) },
+                        LineLength{ static_cast<qsizetype>( span.to - span.from ) } ) );
+                }
+            }
+        }
+        else if ( !hl.matchLine( line, highlighterMatches_ ) ) {
             continue;
         }
 
@@ -302,7 +399,7 @@ HighlighterMatchType HighlighterSet::matchLine( const QString& line,
             if ( matchType != HighlighterMatchType::LineMatch ) {
                 matchType = HighlighterMatchType::WordMatch;
             }
-            matches.addMatches( thisMatches );
+            matches.addMatches( highlighterMatches_ );
         }
         else {
             matchType = HighlighterMatchType::LineMatch;
@@ -315,6 +412,139 @@ HighlighterMatchType HighlighterSet::matchLine( const QString& line,
     return matchType;
 }
 
+namespace {
+
+// Copy with its own compiled regular expression, copies of a highlighter
+// share the lazily compiled one otherwise
+Highlighter compiledCopy( const Highlighter& highlighter )
+{
+    Highlighter copy = highlighter;
+    copy.compile();
+    return copy;
+}
+
+} // namespace
+
+bool HighlightingContext::prepare( const RegularExpressionPattern& searchPattern,
+                                   const std::vector<QStringList>& quickHighlighterWords )
+{
+    const auto& config = Configuration::get();
+    const auto highlightSearchPattern = config.mainSearchHighlight() && !searchPattern.isBoolean
+                                        && !searchPattern.isExclude
+                                        && !searchPattern.pattern.isEmpty();
+    const auto variateSearchPatternColors = config.variateMainSearchHighlight();
+    const auto searchPatternBackColor = config.mainSearchBackColor();
+
+    const auto quickHighlighters = HighlighterSetCollection::get().quickHighlighters();
+    klogg::vector<std::pair<QColor, QColor>> quickHighlighterColors;
+    for ( const auto& quickHighlighter : quickHighlighters ) {
+        quickHighlighterColors.emplace_back( quickHighlighter.color.foreColor,
+                                             quickHighlighter.color.backColor );
+    }
+
+    // Combined set is compiled again each time it changes
+    const auto& activeSet = HighlighterSetCollection::get().currentActiveSet();
+    if ( !activeSet.compiledExpression_ && !activeSet.isEmpty() ) {
+        activeSet.compile();
+    }
+
+    if ( isPrepared_ && activeSet.compiledExpression_ == activeSet_.compiledExpression_
+         && searchPattern == searchPattern_ && highlightSearchPattern == highlightSearchPattern_
+         && variateSearchPatternColors == variateSearchPatternColors_
+         && searchPatternBackColor == searchPatternBackColor_
+         && quickHighlighterWords == quickHighlighterWords_
+         && quickHighlighterColors == quickHighlighterColors_ ) {
+        return false;
+    }
+
+    isPrepared_ = true;
+    ++generation_;
+    searchPattern_ = searchPattern;
+    highlightSearchPattern_ = highlightSearchPattern;
+    variateSearchPatternColors_ = variateSearchPatternColors;
+    searchPatternBackColor_ = searchPatternBackColor;
+    quickHighlighterWords_ = quickHighlighterWords;
+    quickHighlighterColors_ = std::move( quickHighlighterColors );
+
+    activeSet_.highlighterList_.clear();
+    for ( const auto& highlighter : activeSet.highlighterList_ ) {
+        activeSet_.highlighterList_.append( compiledCopy( highlighter ) );
+    }
+    activeSet_.compiledExpression_ = activeSet.compiledExpression_;
+
+    // Overlay highlighters are matched in reverse order of the list,
+    // search pattern goes first and then quick highlighters
+    overlaySet_.highlighterList_.clear();
+    if ( highlightSearchPattern_ ) {
+        Highlighter highlighter;
+        highlighter.setHighlightOnlyMatch( true );
+        highlighter.setVariateColors( variateSearchPatternColors_ );
+        highlighter.setPattern( searchPattern_.pattern );
+        highlighter.setIgnoreCase( !searchPattern_.isCaseSensitive );
+        highlighter.setUseRegex( !searchPattern_.isPlainText );
+
+        highlighter.setBackColor( searchPatternBackColor_ );
+        highlighter.setForeColor( Qt::black );
+        overlaySet_.highlighterList_.prepend( compiledCopy( highlighter ) );
+    }
+
+    for ( auto i = 0u; i < quickHighlighterWords_.size(); ++i ) {
+        const auto quickHighlighterIndex = static_cast<int>( i );
+        if ( quickHighlighterIndex >= quickHighlighters.size() ) {
+            LOG_WARNING << "Not enough quickHighlighters configured";
+            break;
+        }
+
+        const auto& color = quickHighlighters.at( quickHighlighterIndex ).color;
+        for ( const auto& word : quickHighlighterWords_[ i ] ) {
+            Highlighter highlighter{ word, false, true, color.foreColor, color.backColor };
+            highlighter.setUseRegex( false );
+            overlaySet_.highlighterList_.prepend( compiledCopy( highlighter ) );
+        }
+    }
+    overlaySet_.compile();
+
+    return true;
+}
+
+std::unique_ptr<HighlightingContext> HighlightingContext::clone() const
+{
+    auto context = std::make_unique<HighlightingContext>();
+
+    context->isPrepared_ = isPrepared_;
+    context->generation_ = generation_;
+    context->searchPattern_ = searchPattern_;
+    context->highlightSearchPattern_ = highlightSearchPattern_;
+    context->variateSearchPatternColors_ = variateSearchPatternColors_;
+    context->searchPatternBackColor_ = searchPatternBackColor_;
+    context->quickHighlighterWords_ = quickHighlighterWords_;
+    context->quickHighlighterColors_ = quickHighlighterColors_;
+
+    // Compiled set is never changed, matchers with scratch are per context
+    for ( const auto& highlighter : activeSet_.highlighterList_ ) {
+        context->activeSet_.highlighterList_.append( compiledCopy( highlighter ) );
+    }
+    context->activeSet_.compiledExpression_ = activeSet_.compiledExpression_;
+
+    for ( const auto& highlighter : overlaySet_.highlighterList_ ) {
+        context->overlaySet_.highlighterList_.append( compiledCopy( highlighter ) );
+    }
+    context->overlaySet_.compiledExpression_ = overlaySet_.compiledExpression_;
+
+    return context;
+}
+
+HighlighterMatchType HighlightingContext::matchLine( const QString& line,
+                                                     HighlightedMatchRanges& matches )
+{
+    const auto matchType = setMatcher_.matchLine( activeSet_, line, matches );
+
+    // Overlay highlighters only add matches, they don't change the line type
+    overlayMatcher_.matchLine( overlaySet_, line, matches );
+
+    return matchType;
+}
+
 //
 // Persistable virtual functions implementation
 //
@@ -337,6 +337,12 @@ void MainWindow::reTranslateUI()
     goToLineAction->setText( transAction( action::goToLineText ) );
     goToLineAction->setStatusTip( transAction( action::goToLineStatusTip ) );
 
+    goToTimeAction->setText( transAction( action::goToTimeText ) );
+    goToTimeAction->setStatusTip( transAction( action::goToTimeStatusTip ) );
+
+    searchTimeRangeAction->setText( transAction( action::searchTimeRangeText ) );
+    searchTimeRangeAction->setStatusTip( transAction( action::searchTimeRangeStatusTip ) );
+
     findAction->setText( transAction( action::findText ) );
     findAction->setStatusTip( transAction( action::findStatusTip ) );
 
@@ -511,6 +517,15 @@ void MainWindow::createActions()
     goToLineAction->setStatusTip( tr( action::goToLineStatusTip ) );
     signalMux_.connect( goToLineAction, SIGNAL( triggered() ), SLOT( goToLine() ) );
 
+    goToTimeAction = new QAction( tr( action::goToTimeText ), this );
+    goToTimeAction->setStatusTip( tr( action::goToTimeStatusTip ) );
+    signalMux_.connect( goToTimeAction, SIGNAL( triggered() ), SLOT( goToTime() ) );
+
+    searchTimeRangeAction = new QAction( tr( action::searchTimeRangeText ), this );
+    searchTimeRangeAction->setStatusTip( tr( action::searchTimeRangeStatusTip ) );
+    signalMux_.connect( searchTimeRangeAction, SIGNAL( triggered() ),
+                        SLOT( setSearchTimeRange() ) );
+
     findAction = new QAction( tr( action::findText ), this );
     findAction->setStatusTip( tr( action::findStatusTip ) );
     connect( findAction, &QAction::triggered, this, [ this ]( auto ) { this->find(); } );
@@ -774,6 +789,8 @@ void MainWindow::createMenus()
     editMenu->addAction( findAction );
     editMenu->addSeparator();
     editMenu->addAction( goToLineAction );
+    editMenu->addAction( goToTimeAction );
+    editMenu->addAction( searchTimeRangeAction );
     editMenu->addSeparator();
     editMenu->addAction( copyPathToClipboardAction );
     editMenu->addAction( openContainingFolderAction );
@@ -1083,10 +1100,7 @@ void MainWindow::copy()
         }
 
         if ( auto current = currentCrawlerWidget(); current != nullptr ) {
-            auto text = current->getSelectedText();
-            text.replace( QChar::Null, QChar::Space );
-
-            sendTextToClipboard( text, true );
+            current->copySelectedText();
         }
     } catch ( std::exception& err ) {
         LOG_ERROR << "failed to copy data to clipboard " << err.what();
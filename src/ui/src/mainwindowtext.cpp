@@ -44,6 +44,12 @@ const char* action::selectAllStatusTip = QT_TR_NOOP( "Select all the text" );
 const char* action::goToLineText = QT_TR_NOOP( "Go to line..." );
 const char* action::goToLineStatusTip
     = QT_TR_NOOP( "Scrolls selected main view to specified line" );
+const char* action::goToTimeText = QT_TR_NOOP( "Go to time..." );
+const char* action::goToTimeStatusTip
+    = QT_TR_NOOP( "Scrolls selected main view to the first line at specified time" );
+const char* action::searchTimeRangeText = QT_TR_NOOP( "Search time range..." );
+const char* action::searchTimeRangeStatusTip
+    = QT_TR_NOOP( "Limits search to lines within specified time range" );
 const char* action::findText = QT_TR_NOOP( "&Find..." );
 const char* action::findStatusTip = QT_TR_NOOP( "Find the text" );
 const char* action::clearLogText = QT_TR_NOOP( "Clear file..." );
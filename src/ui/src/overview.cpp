@@ -21,6 +21,9 @@
 // It provides support for drawing the match overview sidebar but
 // the actual drawing is done in AbstractLogView which uses this class.
 
+#include <QtConcurrent>
+
+#include "highlighterdensity.h"
 #include "linetypes.h"
 #include "log.h"
 
@@ -28,14 +31,100 @@
 
 #include "overview.h"
 
+namespace {
+
+// Lines of the file drawn at rows before the passed one,
+// the row of a line is line * height / linesInFile
+uint64_t linesBeforeRow( unsigned row, uint64_t linesInFile, unsigned height )
+{
+    return ( row * linesInFile + height - 1 ) / height;
+}
+
+int rowOfLine( uint64_t line, uint64_t linesInFile, unsigned height )
+{
+    return static_cast<int>( line * height / linesInFile );
+}
+
+// Number of lines of the set in each row starting at firstRow
+klogg::vector<uint64_t> countLinesInRows( const SearchResultsSnapshot& results,
+                                          uint64_t linesInFile, unsigned height,
+                                          unsigned firstRow )
+{
+    klogg::vector<uint64_t> counts( height - firstRow );
+    if ( results == nullptr || results->cardinality() == 0 ) {
+        return counts;
+    }
+
+    const auto linesBefore = [ &results ]( uint64_t line ) -> uint64_t {
+        return line > 0 ? results->rank( line - 1 ) : 0;
+    };
+
+    auto previousCount = linesBefore( linesBeforeRow( firstRow, linesInFile, height ) );
+    for ( auto row = firstRow; row < height && previousCount < results->cardinality(); ++row ) {
+        const auto count = linesBefore( linesBeforeRow( row + 1, linesInFile, height ) );
+        counts[ row - firstRow ] = count - previousCount;
+        previousCount = count;
+    }
+
+    return counts;
+}
+
+// Number of first rows having the same lines of current set as of previous one.
+// That is the case if lines have only been added after the last previous line.
+unsigned unchangedRows( const SearchResultsSnapshot& previous,
+                        const SearchResultsSnapshot& current, uint64_t linesInFile,
+                        unsigned height )
+{
+    if ( previous == current ) {
+        return height;
+    }
+
+    if ( previous == nullptr || current == nullptr || previous->cardinality() == 0 ) {
+        return 0;
+    }
+
+    const auto lastLine = previous->lines.maximum();
+    if ( current->rank( lastLine ) != previous->cardinality()
+         || !previous->lines.isSubsetOf( current->lines ) ) {
+        return 0;
+    }
+
+    return static_cast<unsigned>( rowOfLine( lastLine, linesInFile, height ) );
+}
+
+void replaceRows( klogg::vector<Overview::WeightedLine>& lines, unsigned firstRow,
+                  const klogg::vector<uint64_t>& counts )
+{
+    lines.erase( std::find_if( lines.begin(), lines.end(),
+                               [ firstRow ]( const Overview::WeightedLine& line ) {
+                                   return line.position() >= static_cast<int>( firstRow );
+                               } ),
+                 lines.end() );
+
+    for ( auto index = 0u; index < counts.size(); ++index ) {
+        if ( counts[ index ] > 0 ) {
+            lines.emplace_back( static_cast<int>( firstRow + index ), counts[ index ] );
+        }
+    }
+}
+
+} // namespace
+
 Overview::Overview()
-    : matchLines_()
-    , markLines_()
+    : lines_( std::make_shared<const Lines>() )
 {
     logFilteredData_ = nullptr;
     height_ = 0;
     dirty_ = true;
     visible_ = false;
+
+    connect( &calculationWatcher_, &QFutureWatcher<LinesSnapshot>::finished, this,
+             &Overview::onLinesCalculated );
+}
+
+Overview::~Overview()
+{
+    calculationWatcher_.waitForFinished();
 }
 
 void Overview::setFilteredData( const LogFilteredData* logFilteredData )
@@ -46,32 +135,69 @@ void Overview::setFilteredData( const LogFilteredData* logFilteredData )
     dirty_ = true;
 }
 
+void Overview::setLogData( const LogData* logData )
+{
+    density_ = std::make_unique<HighlighterDensity>( *logData );
+    connect( density_.get(), &HighlighterDensity::densityUpdated, this,
+             &Overview::onDensityUpdated );
+
+    densityColors_.clear();
+    isDensityDirty_ = true;
+}
+
 void Overview::updateData( LinesCount totalNbLine )
 {
     LOG_INFO << "OverviewWidget::updateData " << totalNbLine;
 
     linesInFile_ = totalNbLine;
     dirty_ = true;
+    isDensityDirty_ = true;
 }
 
 void Overview::updateView( unsigned height )
 {
+    // Only counts lines not counted yet, if any
+    if ( density_ != nullptr ) {
+        density_->update();
+
+        if ( isDensityDirty_ || height != height_ ) {
+            densityColors_ = density_->rowColors( height, linesInFile_ );
+            isDensityDirty_ = false;
+        }
+    }
+
     // We don't touch the cache if the height hasn't changed
     if ( ( height != height_ ) || ( dirty_ == true ) ) {
         height_ = height;
+        dirty_ = false;
 
-        recalculatesLines();
+        if ( calculationWatcher_.isRunning() ) {
+            isCalculationPending_ = true;
+        }
+        else {
+            startCalculation();
+        }
     }
 }
 
 const klogg::vector<Overview::WeightedLine>* Overview::getMatchLines() const
 {
-    return &matchLines_;
+    return &lines_->matchLines;
 }
 
 const klogg::vector<Overview::WeightedLine>* Overview::getMarkLines() const
 {
-    return &markLines_;
+    return &lines_->markLines;
+}
+
+const klogg::vector<Overview::WeightedLine>* Overview::getQuickFindLines() const
+{
+    return &lines_->quickFindLines;
+}
+
+const klogg::vector<QColor>* Overview::getDensityColors() const
+{
+    return &densityColors_;
 }
 
 std::pair<int, int> Overview::getViewLines() const
@@ -106,44 +232,117 @@ int Overview::yFromFileLine( LineNumber fileLine ) const
     return position;
 }
 
+void Overview::onLinesCalculated()
+{
+    lines_ = calculationWatcher_.result();
+    Q_EMIT linesUpdated();
+
+    if ( isCalculationPending_ ) {
+        isCalculationPending_ = false;
+        startCalculation();
+    }
+}
+
+void Overview::onDensityUpdated()
+{
+    isDensityDirty_ = true;
+    Q_EMIT linesUpdated();
+}
+
 // Update the internal cache
-void Overview::recalculatesLines()
+void Overview::startCalculation()
 {
     LOG_INFO << "OverviewWidget::recalculatesLines";
 
+    Lines lines;
+    lines.linesInFile = linesInFile_;
+    lines.height = height_;
+    lines.quickFindMatches = quickFindMatches_;
+
     if ( logFilteredData_ != nullptr ) {
-        matchLines_.clear();
-        markLines_.clear();
-
-        if ( linesInFile_.get() > 0 ) {
-            logFilteredData_->iterateOverLines( [ this ]( LineNumber line ) {
-                const auto lineType = logFilteredData_->lineTypeByLine( line );
-                const auto position = yFromFileLine( line );
-                if ( lineType.testFlag( LogFilteredData::LineTypeFlags::Match ) ) {
-                    if ( ( !matchLines_.empty() ) && matchLines_.back().position() == position ) {
-                        // If the line is already there, we increase its weight
-                        matchLines_.back().load();
-                    }
-                    else {
-                        // If not we just add it
-                        matchLines_.emplace_back( position );
-                    }
-                }
-                else {
-                    if ( ( !markLines_.empty() ) && markLines_.back().position() == position ) {
-                        // If the line is already there, we increase its weight
-                        markLines_.back().load();
-                    }
-                    else {
-                        // If not we just add it
-                        markLines_.emplace_back( position );
-                    }
-                }
-            } );
-        }
+        // Lines not visible in filtered view are not shown in overview either,
+        // marks also matching are drawn as matches
+        const auto visibility = logFilteredData_->visibility();
+        lines.showMatches = visibility.testFlag( LogFilteredData::VisibilityFlags::Matches );
+        lines.showMarks = visibility.testFlag( LogFilteredData::VisibilityFlags::Marks )
+                          || !lines.showMatches;
+
+        lines.matches = logFilteredData_->getMatchingLines();
+        lines.marks = logFilteredData_->getMarkedLines();
+        lines.marksAndMatches = logFilteredData_->getMarkedAndMatchingLines();
     }
     else
         LOG_INFO << "Overview::recalculatesLines: logFilteredData_ == NULL";
 
-    dirty_ = false;
+    calculationWatcher_.setFuture( QtConcurrent::run(
+        [ lines = std::move( lines ), previous = lines_ ]() mutable {
+            return calculateLines( std::move( lines ), previous );
+        } ) );
+}
+
+Overview::LinesSnapshot Overview::calculateLines( Lines lines, const LinesSnapshot& previous )
+{
+    const auto linesInFile = lines.linesInFile.get();
+    const auto height = lines.height;
+    if ( linesInFile == 0 || height == 0 ) {
+        return std::make_shared<const Lines>( std::move( lines ) );
+    }
+
+    const auto isSameLayout
+        = previous->linesInFile == lines.linesInFile && previous->height == height;
+    const auto isSameFilter = isSameLayout && previous->showMatches == lines.showMatches
+                              && previous->showMarks == lines.showMarks;
+
+    const auto rowsKept = [ linesInFile, height ]( bool canKeep,
+                                                   const SearchResultsSnapshot& previousResults,
+                                                   const SearchResultsSnapshot& results ) {
+        return canKeep ? unchangedRows( previousResults, results, linesInFile, height ) : 0u;
+    };
+
+    // Marks are drawn for marked lines not matching, counted in the union
+    auto firstRow = rowsKept( isSameFilter, previous->matches, lines.matches );
+    if ( lines.showMarks ) {
+        firstRow = std::min(
+            firstRow, rowsKept( isSameFilter, previous->marksAndMatches, lines.marksAndMatches ) );
+    }
+    if ( !lines.showMatches ) {
+        firstRow = std::min( firstRow, rowsKept( isSameFilter, previous->marks, lines.marks ) );
+    }
+
+    if ( firstRow > 0 ) {
+        lines.matchLines = previous->matchLines;
+        lines.markLines = previous->markLines;
+    }
+
+    auto matchCounts = countLinesInRows( lines.matches, linesInFile, height, firstRow );
+    klogg::vector<uint64_t> markCounts( matchCounts.size() );
+    if ( lines.showMarks ) {
+        const auto allCounts = countLinesInRows( lines.marksAndMatches, linesInFile, height,
+                                                 firstRow );
+        const auto markedCounts = lines.showMatches ? klogg::vector<uint64_t>{}
+                                                    : countLinesInRows( lines.marks, linesInFile,
+                                                                        height, firstRow );
+
+        for ( auto index = 0u; index < markCounts.size(); ++index ) {
+            markCounts[ index ] = allCounts[ index ] - matchCounts[ index ];
+            if ( !lines.showMatches ) {
+                // Only marked lines are visible, those also matching are drawn as matches
+                matchCounts[ index ] = markedCounts[ index ] - markCounts[ index ];
+            }
+        }
+    }
+
+    replaceRows( lines.matchLines, firstRow, matchCounts );
+    replaceRows( lines.markLines, firstRow, markCounts );
+
+    const auto firstQuickFindRow
+        = rowsKept( isSameLayout, previous->quickFindMatches, lines.quickFindMatches );
+    if ( firstQuickFindRow > 0 ) {
+        lines.quickFindLines = previous->quickFindLines;
+    }
+    replaceRows( lines.quickFindLines, firstQuickFindRow,
+                 countLinesInRows( lines.quickFindMatches, linesInFile, height,
+                                   firstQuickFindRow ) );
+
+    return std::make_shared<const Lines>( std::move( lines ) );
 }
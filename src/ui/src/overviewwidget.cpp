@@ -143,6 +143,7 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
 {
     static const QColor match_color( "red" );
     static const QColor mark_color( "dodgerblue" );
+    static const QColor quickfind_color( "orange" );
 
     static const QPixmap highlight_pixmap[] = {
         QPixmap( highlight_xpm[ 0 ] ), QPixmap( highlight_xpm[ 1 ] ), QPixmap( highlight_xpm[ 2 ] ),
@@ -163,6 +164,16 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
         painter.setPen( palette().color( QPalette::Text ) );
         painter.drawLine( 0, 0, 0, height() );
 
+        // The highlighters density, in the margin
+        const auto densityColors = *( overview_->getDensityColors() );
+        for ( auto row = 0u; row < densityColors.size(); ++row ) {
+            if ( densityColors[ row ].isValid() ) {
+                painter.setPen( densityColors[ row ] );
+                painter.drawLine( 1, static_cast<int>( row ), LINE_MARGIN,
+                                  static_cast<int>( row ) );
+            }
+        }
+
         // The 'match' lines
         painter.setPen( match_color );
         const auto matchLines = *( overview_->getMatchLines() );
@@ -185,6 +196,16 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
                               line.position() );
         }
 
+        // The 'quickfind' lines
+        painter.setPen( quickfind_color );
+        const auto quickFindLines = *( overview_->getQuickFindLines() );
+        for ( const auto& line : quickFindLines ) {
+            painter.setOpacity( ( 1.0 / Overview::WeightedLine::WEIGHT_STEPS )
+                                * ( line.weight() + 1 ) );
+            painter.drawLine( 1 + LINE_MARGIN, line.position(), width() - LINE_MARGIN - 1,
+                              line.position() );
+        }
+
         // The 'view' lines
         painter.setOpacity( 1 );
         painter.setPen( palette().color( QPalette::Text ) );
@@ -45,10 +45,14 @@
 #include <QtConcurrent>
 
 #include "abstractlogdata.h"
+#include "configuration.h"
 #include "dispatch_to.h"
 #include "linetypes.h"
 #include "log.h"
+#include "logdata.h"
+#include "quickfindindex.h"
 #include "quickfindpattern.h"
+#include "quickfindscanner.h"
 #include "selection.h"
 
 #include "quickfind.h"
@@ -128,6 +132,42 @@ QuickFind::QuickFind( const AbstractLogData& logData )
 
     connect( &operationWatcher_, &QFutureWatcher<Portion>::finished, this,
              &QuickFind::onSearchFutureReady );
+
+    if ( Configuration::get().useQuickFindIndex() ) {
+        if ( const auto* sourceData = dynamic_cast<const LogData*>( &logData_ ) ) {
+            index_ = std::make_unique<QuickFindIndex>( *sourceData );
+            connect( index_.get(), &QuickFindIndex::indexUpdated, this,
+                     &QuickFind::indexUpdated );
+        }
+    }
+}
+
+QuickFind::~QuickFind() = default;
+
+void QuickFind::setIndexPattern( const QuickFindMatcher& matcher )
+{
+    if ( index_ ) {
+        index_->setPattern( matcher );
+    }
+}
+
+void QuickFind::updateIndex()
+{
+    if ( index_ ) {
+        index_->update();
+    }
+}
+
+void QuickFind::invalidateIndex()
+{
+    if ( index_ ) {
+        index_->invalidate();
+    }
+}
+
+SearchResultsSnapshot QuickFind::indexedMatches() const
+{
+    return index_ ? index_->matches() : SearchResultsSnapshot{};
 }
 
 Selection QuickFind::incrementalSearchStop()
@@ -162,6 +202,10 @@ void QuickFind::stopSearch()
     LOG_INFO << "Stop search for quickfind " << this;
     interruptRequested_.set();
     operationWatcher_.waitForFinished();
+
+    if ( index_ ) {
+        index_->stop();
+    }
 }
 
 void QuickFind::onSearchFutureReady()
@@ -318,28 +362,15 @@ Portion QuickFind::doSearchForward( const FilePosition& start_position, const Se
     else {
         searchingNotifier_.reset();
         // And then the rest of the file
-        const auto nb_lines = logData_.getNbLine();
         ++line;
-        while ( line < nb_lines ) {
-            if ( matcher.isLineMatching( logData_.getExpandedLineString( line ) ) ) {
-                std::tie( found_start_col, found_end_col ) = matcher.getLastMatch();
-                found = true;
-                break;
-            }
-            ++line;
-
-            // See if we need to notify of the ongoing search
-            searchingNotifier_.ping( line, nb_lines, false );
-
-            if ( interruptRequested_ ) {
-                break;
-            }
+        if ( searchLines( line, Forward, matcher ) ) {
+            std::tie( found_start_col, found_end_col ) = matcher.getLastMatch();
+            found = true;
         }
     }
 
     if ( found ) {
-        // Clear any notification
-        Q_EMIT clearNotification();
+        notifyMatchFound( line, matcher );
 
         return Portion{ line, found_start_col, found_end_col };
     }
@@ -402,34 +433,17 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
     else {
         searchingNotifier_.reset();
         // And then the rest of the file
-        const auto nb_lines = logData_.getNbLine();
         if ( line > 0_lnum ) {
             --line;
-            while ( true ) {
-                if ( matcher.isLineMatchingBackward( logData_.getExpandedLineString( line ) ) ) {
-                    std::tie( start_col, end_col ) = matcher.getLastMatch();
-                    found = true;
-                    break;
-                }
-                if ( line == 0_lnum ) {
-                    break;
-                }
-
-                --line;
-
-                // See if we need to notify of the ongoing search
-                searchingNotifier_.ping( line, nb_lines, true );
-
-                if ( interruptRequested_ ) {
-                    break;
-                }
+            if ( searchLines( line, Backward, matcher ) ) {
+                std::tie( start_col, end_col ) = matcher.getLastMatch();
+                found = true;
             }
         }
     }
 
     if ( found ) {
-        // Clear any notification
-        Q_EMIT clearNotification();
+        notifyMatchFound( line, matcher );
 
         return Portion{ line, start_col, end_col };
     }
@@ -451,6 +465,147 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
     }
 }
 
+bool QuickFind::searchLines( LineNumber& line, QFDirection direction,
+                             const QuickFindMatcher& matcher )
+{
+    const auto nb_lines = logData_.getNbLine();
+    const auto isBackward = direction == Backward;
+
+    if ( index_ ) {
+        if ( const auto matches = index_->completeMatches( matcher.regexp() ) ) {
+            return searchIndexedLines( *matches, line, direction, matcher );
+        }
+    }
+
+    const auto isLineMatching = [ this, &matcher, isBackward ]( LineNumber lineNumber ) {
+        const auto text = logData_.getExpandedLineString( lineNumber );
+        return isBackward ? matcher.isLineMatchingBackward( text )
+                          : matcher.isLineMatching( text );
+    };
+
+    // Lines of the whole file are scanned in chunks, only the lines
+    // found there are decoded and matched again to get the columns
+    if ( const auto* sourceData = dynamic_cast<const LogData*>( &logData_ ) ) {
+        if ( !scanner_ || scanner_->regexp() != matcher.regexp() ) {
+            scanner_ = std::make_unique<QuickFindScanner>( *sourceData, matcher.regexp() );
+        }
+
+        if ( scanner_->isValid() ) {
+            auto begin = isBackward ? 0_lnum : line;
+            auto end = isBackward ? line + 1_lcount : LineNumber( nb_lines.get() );
+            const auto scanDirection = isBackward ? QuickFindScanner::Direction::Backward
+                                                  : QuickFindScanner::Direction::Forward;
+
+            while ( begin < end ) {
+                const auto found = scanner_->findMatch(
+                    begin, end, scanDirection, interruptRequested_,
+                    [ this, nb_lines, isBackward ]( LineNumber position ) {
+                        searchingNotifier_.ping( position, nb_lines, isBackward );
+                    } );
+
+                if ( !found.has_value() ) {
+                    return false;
+                }
+
+                if ( isLineMatching( *found ) ) {
+                    line = *found;
+                    return true;
+                }
+
+                // Regex engines of the scan and of the view may disagree
+                if ( isBackward ) {
+                    end = *found;
+                }
+                else {
+                    begin = *found + 1_lcount;
+                }
+            }
+
+            return false;
+        }
+    }
+
+    while ( line < nb_lines ) {
+        if ( isLineMatching( line ) ) {
+            return true;
+        }
+
+        if ( isBackward ) {
+            if ( line == 0_lnum ) {
+                break;
+            }
+            --line;
+        }
+        else {
+            ++line;
+        }
+
+        // See if we need to notify of the ongoing search
+        searchingNotifier_.ping( line, nb_lines, isBackward );
+
+        if ( interruptRequested_ ) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+bool QuickFind::searchIndexedLines( const IndexedSearchResults& matches, LineNumber& line,
+                                    QFDirection direction, const QuickFindMatcher& matcher )
+{
+    const auto isBackward = direction == Backward;
+
+    // Rank of the first indexed line to look at
+    uint64_t rank = 0;
+    if ( isBackward ) {
+        rank = matches.rank( line.get() );
+        if ( rank == 0 ) {
+            return false;
+        }
+        --rank;
+    }
+    else if ( line.get() > 0 ) {
+        rank = matches.rank( line.get() - 1 );
+    }
+
+    // Indexed lines are matched again to get the columns
+    uint64_t candidate = 0;
+    while ( !interruptRequested_ && matches.select( rank, &candidate ) ) {
+        const auto text = logData_.getExpandedLineString( LineNumber( candidate ) );
+        if ( isBackward ? matcher.isLineMatchingBackward( text )
+                        : matcher.isLineMatching( text ) ) {
+            line = LineNumber( candidate );
+            return true;
+        }
+
+        if ( isBackward ) {
+            if ( rank == 0 ) {
+                break;
+            }
+            --rank;
+        }
+        else {
+            ++rank;
+        }
+    }
+
+    return false;
+}
+
+void QuickFind::notifyMatchFound( LineNumber line, const QuickFindMatcher& matcher )
+{
+    const auto matches = index_ ? index_->completeMatches( matcher.regexp() ) : nullptr;
+    if ( matches && matches->lines.contains( line.get() ) ) {
+        sendNotification( QFNotificationMatchCount( matches->rank( line.get() ),
+                                                    matches->cardinality() ) );
+    }
+    else {
+        // Clear any notification
+        Q_EMIT clearNotification();
+    }
+}
+
 void QuickFind::resetLimits()
 {
     lastMatch_.reset();
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quickfindindex.h"
+
+#include <chrono>
+
+#include <QtConcurrent>
+
+#include "log.h"
+#include "logdata.h"
+#include "quickfindpattern.h"
+#include "quickfindscanner.h"
+
+QuickFindIndex::QuickFindIndex( const LogData& logData )
+    : logData_( logData )
+{
+    connect( &buildWatcher_, &QFutureWatcher<void>::finished, this,
+             &QuickFindIndex::onBuildFinished );
+}
+
+QuickFindIndex::~QuickFindIndex()
+{
+    stop();
+}
+
+void QuickFindIndex::setPattern( const QuickFindMatcher& matcher )
+{
+    if ( matcher.isActive() == isActive_ && ( !isActive_ || matcher.regexp() == regexp_ ) ) {
+        return;
+    }
+
+    stop();
+    isUpdatePending_ = false;
+
+    isActive_ = matcher.isActive();
+    regexp_ = matcher.regexp();
+    clear();
+    Q_EMIT indexUpdated();
+
+    if ( isActive_ ) {
+        startBuild();
+    }
+}
+
+void QuickFindIndex::update()
+{
+    if ( !isActive_ ) {
+        return;
+    }
+
+    if ( buildWatcher_.isRunning() ) {
+        isUpdatePending_ = true;
+    }
+    else {
+        startBuild();
+    }
+}
+
+void QuickFindIndex::invalidate()
+{
+    stop();
+    isUpdatePending_ = false;
+
+    clear();
+    Q_EMIT indexUpdated();
+
+    if ( isActive_ ) {
+        startBuild();
+    }
+}
+
+void QuickFindIndex::stop()
+{
+    interruptRequested_.set();
+    buildWatcher_.waitForFinished();
+}
+
+SearchResultsSnapshot QuickFindIndex::completeMatches( const QRegularExpression& regexp ) const
+{
+    const auto nbLines = logData_.getNbLine();
+
+    ScopedLock lock( mutex_ );
+    if ( matches_ == nullptr || indexedRegexp_ != regexp || indexedLines_ != nbLines ) {
+        return {};
+    }
+    return matches_;
+}
+
+SearchResultsSnapshot QuickFindIndex::matches() const
+{
+    ScopedLock lock( mutex_ );
+    return matches_;
+}
+
+void QuickFindIndex::onBuildFinished()
+{
+    Q_EMIT indexUpdated();
+
+    if ( isUpdatePending_ && isActive_ ) {
+        isUpdatePending_ = false;
+        startBuild();
+    }
+}
+
+void QuickFindIndex::startBuild()
+{
+    interruptRequested_.clear();
+    buildWatcher_.setFuture(
+        QtConcurrent::run( [ this, regexp = regexp_ ]() { build( regexp ); } ) );
+}
+
+void QuickFindIndex::clear()
+{
+    ScopedLock lock( mutex_ );
+    indexedRegexp_ = {};
+    matches_.reset();
+    indexedLines_ = 0_lcount;
+}
+
+void QuickFindIndex::build( const QRegularExpression& regexp )
+{
+    if ( scanner_ == nullptr || scanner_->regexp() != regexp ) {
+        scanner_ = std::make_unique<QuickFindScanner>( logData_, regexp );
+    }
+
+    if ( !scanner_->isValid() ) {
+        return;
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    auto indexedLines = 0_lcount;
+    {
+        ScopedLock lock( mutex_ );
+        if ( matches_ != nullptr && indexedRegexp_ == regexp ) {
+            indexedLines = indexedLines_;
+        }
+    }
+
+    const auto nbLines = logData_.getNbLine();
+    if ( nbLines < indexedLines ) {
+        indexedLines = 0_lcount;
+    }
+
+    if ( indexedLines.get() == 0 ) {
+        lines_ = {};
+        linesIndex_.clear();
+    }
+
+    // The last indexed line could have been incomplete,
+    // it is the largest value of the set if it has matched
+    auto begin = 0_lnum;
+    auto hasMatchedLast = false;
+    if ( indexedLines.get() > 0 ) {
+        begin = LineNumber( indexedLines.get() - 1 );
+        hasMatchedLast = lines_.contains( begin.get() );
+        if ( hasMatchedLast ) {
+            lines_.remove( begin.get() );
+            linesIndex_.removeLast( lines_ );
+        }
+    }
+
+    auto found = scanner_->findAll( begin, LineNumber( nbLines.get() ), interruptRequested_ );
+    if ( interruptRequested_ ) {
+        // Lines stay the same as in the published snapshot
+        if ( hasMatchedLast ) {
+            lines_.add( begin.get() );
+            linesIndex_.extend( lines_ );
+        }
+        return;
+    }
+
+    const auto isLastMatched = found.contains( begin.get() );
+    const auto isChanged = begin.get() == 0 || hasMatchedLast != isLastMatched
+                           || found.cardinality() > ( isLastMatched ? 1u : 0u );
+    if ( !found.isEmpty() ) {
+        lines_ |= found;
+        if ( begin.get() == 0 ) {
+            lines_.runOptimize();
+        }
+        linesIndex_.extend( lines_ );
+    }
+
+    LOG_INFO << "Quick find index has " << linesIndex_.cardinality() << " matches in "
+             << nbLines << " lines, indexed " << ( nbLines.get() - begin.get() )
+             << " lines in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startTime )
+                    .count()
+             << " ms";
+
+    auto indexedMatches = isChanged
+                              ? std::make_shared<const IndexedSearchResults>( lines_, linesIndex_ )
+                              : SearchResultsSnapshot{};
+
+    ScopedLock lock( mutex_ );
+    indexedRegexp_ = regexp;
+    if ( indexedMatches != nullptr ) {
+        matches_ = std::move( indexedMatches );
+    }
+    indexedLines_ = nbLines;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quickfindscanner.h"
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include <tbb/info.h>
+#include <tbb/parallel_for.h>
+
+#include "configuration.h"
+#include "log.h"
+#include "logdata.h"
+#include "logfiltereddataworker.h"
+
+namespace {
+
+constexpr size_t NoChunk = std::numeric_limits<size_t>::max();
+
+size_t getMatchingThreadsCount( const Configuration& config )
+{
+    if ( !config.useParallelSearch() ) {
+        return 1;
+    }
+    const auto configuredThreadPoolSize = config.searchThreadPoolSize();
+    return static_cast<size_t>( qMax( 1, configuredThreadPoolSize == 0
+                                             ? tbb::info::default_concurrency()
+                                             : configuredThreadPoolSize ) );
+}
+
+RegularExpressionPattern toPattern( const QRegularExpression& regexp )
+{
+    const auto isCaseSensitive
+        = !regexp.patternOptions().testFlag( QRegularExpression::CaseInsensitiveOption );
+    return RegularExpressionPattern( regexp.pattern(), isCaseSensitive, false, false, false );
+}
+
+bool hasTabs( std::string_view text )
+{
+    return !text.empty() && std::memchr( text.data(), '\t', text.size() ) != nullptr;
+}
+
+// Matches decoded line of the chunk as the view shows it, with tabs expanded
+bool isExpandedLineMatching( const QRegularExpression& regexp, std::string_view line )
+{
+    if ( !line.empty() && line.back() == '\r' ) {
+        line.remove_suffix( 1 );
+    }
+
+    return regexp.match( untabify( QString::fromUtf8( line.data(), klogg::isize( line ) ) ) )
+        .hasMatch();
+}
+
+// Lines are views into one buffer, so the whole chunk can be
+// checked for required literals and tabs at once
+std::string_view wholeBlock( const klogg::vector<std::string_view>& lines )
+{
+    const auto blockBegin = lines.front().data();
+    const auto blockEnd = lines.back().data() + lines.back().size();
+    return std::less<>{}( blockBegin, blockEnd )
+               ? std::string_view( blockBegin, static_cast<size_t>( blockEnd - blockBegin ) )
+               : std::string_view{};
+}
+
+// Lowers the chunk index if the passed one comes earlier in scan order
+void updateFirstHit( std::atomic<size_t>& firstHit, size_t chunk )
+{
+    auto current = firstHit.load();
+    while ( chunk < current && !firstHit.compare_exchange_weak( current, chunk ) ) {
+    }
+}
+
+} // namespace
+
+QuickFindScanner::QuickFindScanner( const LogData& logData, const QRegularExpression& regexp )
+    : logData_( logData )
+    , regexp_( regexp )
+    , expression_( toPattern( regexp ) )
+{
+    const auto& config = Configuration::get();
+    chunkSize_ = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        qMax( 1, config.searchReadBufferSizeLines() ) ) );
+
+    if ( expression_.isValid() ) {
+        const auto threadsCount = getMatchingThreadsCount( config );
+        for ( auto index = 0u; index < threadsCount; ++index ) {
+            matchers_.push_back( expression_.createMatcher() );
+        }
+    }
+    else {
+        LOG_WARNING << "Quick find pattern can't be used for chunk scan: "
+                    << expression_.errorString();
+    }
+}
+
+QuickFindScanner::~QuickFindScanner() = default;
+
+bool QuickFindScanner::isValid() const
+{
+    return !matchers_.empty();
+}
+
+OptionalLineNumber
+QuickFindScanner::findMatch( LineNumber begin, LineNumber end, Direction direction,
+                             const AtomicFlag& interruptRequested,
+                             const std::function<void( LineNumber )>& progress ) const
+{
+    const auto isBackward = direction == Direction::Backward;
+
+    // Start of not yet scanned lines if going forward, their end otherwise
+    auto position = isBackward ? end : begin;
+
+    while ( isBackward ? position > begin : position < end ) {
+        const auto ranges = nextChunks( position, begin, end, direction );
+
+        std::atomic<size_t> firstHit{ NoChunk };
+        klogg::vector<OptionalLineNumber> hits( ranges.size() );
+
+        tbb::parallel_for( size_t{ 0 }, ranges.size(), [ & ]( size_t chunk ) {
+            if ( firstHit.load() < chunk || interruptRequested ) {
+                return;
+            }
+
+            const auto& [ rangeStart, rangeEnd ] = ranges[ chunk ];
+            const auto rawLines = logData_.getLinesRaw( rangeStart, rangeEnd - rangeStart );
+            const auto& lines = rawLines.buildUtf8View();
+            if ( lines.empty() ) {
+                return;
+            }
+
+            const auto& matcher = *matchers_[ chunk ];
+
+            const auto block = wholeBlock( lines );
+            const auto blockResult = matcher.precheckBlock( block );
+            if ( blockResult.has_value() && !*blockResult && !hasTabs( block ) ) {
+                return;
+            }
+
+            for ( auto index = 0u; index < lines.size(); ++index ) {
+                const auto offset = isBackward ? lines.size() - 1 - index : index;
+                const auto& line = lines[ offset ];
+
+                // Expanded text of lines with tabs is matched as the view shows it
+                const auto isMatching
+                    = hasTabs( line )
+                          ? isExpandedLineMatching( regexp_, line )
+                          : ( blockResult.has_value() ? *blockResult : matcher.hasMatch( line ) );
+                if ( isMatching ) {
+                    hits[ chunk ] = rangeStart + LinesCount( offset );
+                    updateFirstHit( firstHit, chunk );
+                    return;
+                }
+
+                // Stop when an earlier chunk has a hit
+                if ( index % 1024 == 0 && ( firstHit.load() < chunk || interruptRequested ) ) {
+                    return;
+                }
+            }
+        } );
+
+        if ( interruptRequested ) {
+            return {};
+        }
+
+        const auto hitChunk = firstHit.load();
+        if ( hitChunk != NoChunk ) {
+            return hits[ hitChunk ];
+        }
+
+        if ( progress ) {
+            progress( position );
+        }
+    }
+
+    return {};
+}
+
+SearchResultArray QuickFindScanner::findAll( LineNumber begin, LineNumber end,
+                                             const AtomicFlag& interruptRequested ) const
+{
+    auto results = SearchResultArray::forLines( LinesCount( end.get() ) );
+
+    auto position = begin;
+    while ( position < end && !interruptRequested ) {
+        const auto ranges = nextChunks( position, begin, end, Direction::Forward );
+        klogg::vector<SearchResultArray> chunkResults( ranges.size() );
+
+        tbb::parallel_for( size_t{ 0 }, ranges.size(), [ & ]( size_t chunk ) {
+            if ( interruptRequested ) {
+                return;
+            }
+
+            const auto& [ rangeStart, rangeEnd ] = ranges[ chunk ];
+            const auto rawLines = logData_.getLinesRaw( rangeStart, rangeEnd - rangeStart );
+            const auto& lines = rawLines.buildUtf8View();
+            if ( lines.empty() ) {
+                return;
+            }
+
+            const auto& matcher = *matchers_[ chunk ];
+
+            const auto block = wholeBlock( lines );
+            const auto blockResult = matcher.precheckBlock( block );
+            if ( blockResult.has_value() && !*blockResult && !hasTabs( block ) ) {
+                return;
+            }
+
+            SearchResultsBuilder matchingLines;
+            for ( auto index = 0u; index < lines.size(); ++index ) {
+                const auto& line = lines[ index ];
+                const auto lineNumber = rangeStart + LinesCount( index );
+
+                // Expanded text of lines with tabs is matched as the view shows it
+                const auto isMatching
+                    = hasTabs( line )
+                          ? isExpandedLineMatching( regexp_, line )
+                          : ( blockResult.has_value() ? *blockResult : matcher.hasMatch( line ) );
+                if ( isMatching ) {
+                    matchingLines.add( lineNumber );
+                }
+            }
+            chunkResults[ chunk ] = matchingLines.finish();
+        } );
+
+        for ( const auto& chunkResult : chunkResults ) {
+            results |= chunkResult;
+        }
+    }
+
+    return results;
+}
+
+klogg::vector<std::pair<LineNumber, LineNumber>>
+QuickFindScanner::nextChunks( LineNumber& position, LineNumber begin, LineNumber end,
+                              Direction direction ) const
+{
+    klogg::vector<std::pair<LineNumber, LineNumber>> ranges;
+    while ( ranges.size() < matchers_.size() ) {
+        if ( direction == Direction::Backward && position > begin ) {
+            const auto rangeStart
+                = position - LinesCount( qMin( chunkSize_.get(), ( position - begin ).get() ) );
+            ranges.emplace_back( rangeStart, position );
+            position = rangeStart;
+        }
+        else if ( direction == Direction::Forward && position < end ) {
+            const auto rangeEnd
+                = position + LinesCount( qMin( chunkSize_.get(), ( end - position ).get() ) );
+            ranges.emplace_back( position, rangeEnd );
+            position = rangeEnd;
+        }
+        else {
+            break;
+        }
+    }
+    return ranges;
+}
@@ -133,6 +133,11 @@ OptionalLineNumber Selection::selectedLine() const
     return selectedLine_;
 }
 
+OptionalLineNumber Selection::selectedRangeStart() const
+{
+    return selectedRange_.startLine;
+}
+
 klogg::vector<LineNumber> Selection::getLines() const
 {
     klogg::vector<LineNumber> selection;
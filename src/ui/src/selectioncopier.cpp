@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "selectioncopier.h"
+
+#include <algorithm>
+
+#include <QApplication>
+#include <QClipboard>
+#include <QMimeData>
+#include <QTemporaryFile>
+#include <QtConcurrent>
+
+#include "abstractlogdata.h"
+#include "log.h"
+
+namespace {
+
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+
+// Copied text kept in a temporary file, it is read only when requested
+class FileMimeData : public QMimeData {
+  public:
+    explicit FileMimeData( std::shared_ptr<QTemporaryFile> file )
+        : file_( std::move( file ) )
+    {
+    }
+
+    QStringList formats() const override
+    {
+        return { QStringLiteral( "text/plain;charset=utf-8" ), QStringLiteral( "text/plain" ) };
+    }
+
+  protected:
+#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
+    QVariant retrieveData( const QString& mimeType, QVariant::Type ) const override
+#else
+    QVariant retrieveData( const QString& mimeType, QMetaType ) const override
+#endif
+    {
+        if ( !formats().contains( mimeType ) || !file_->seek( 0 ) ) {
+            return {};
+        }
+
+        // Kept as UTF-8 bytes, Qt converts them if a string is requested
+        return file_->readAll();
+    }
+
+  private:
+    std::shared_ptr<QTemporaryFile> file_;
+};
+
+} // namespace
+
+SelectionCopier::SelectionCopier( const AbstractLogData& logData )
+    : logData_( logData )
+{
+    connect( &copyWatcher_, &QFutureWatcher<bool>::finished, this,
+             &SelectionCopier::onCopyFinished );
+}
+
+SelectionCopier::~SelectionCopier()
+{
+    stop();
+}
+
+void SelectionCopier::start( LineNumber firstLine, LinesCount nbLines, bool lineNumbers,
+                             bool updateSelection )
+{
+    stop();
+
+    file_ = std::make_shared<QTemporaryFile>();
+    if ( !file_->open() ) {
+        LOG_ERROR << "Failed to create temporary file for copied lines";
+        file_.reset();
+        Q_EMIT finished();
+        return;
+    }
+
+    LOG_INFO << "Copying " << nbLines << " lines through " << file_->fileName();
+
+    firstLine_ = firstLine;
+    nbLines_ = nbLines;
+    updateSelection_ = updateSelection;
+    interruptRequested_.clear();
+    copyWatcher_.setFuture( QtConcurrent::run( [ this, firstLine, nbLines, lineNumbers ]() {
+        return copyLines( firstLine, nbLines, lineNumbers );
+    } ) );
+}
+
+void SelectionCopier::stop()
+{
+    interruptRequested_.set();
+    copyWatcher_.waitForFinished();
+}
+
+void SelectionCopier::onCopyFinished()
+{
+    auto file = std::move( file_ );
+    auto* clipboard = QApplication::clipboard();
+
+    if ( !copyWatcher_.result() || interruptRequested_ ) {
+        LOG_INFO << "Copy of lines cancelled";
+    }
+    else if ( !clipboard ) {
+        LOG_WARNING << "Unable to access the clipboard.";
+    }
+    else if ( file->size() > MaxClipboardBytes ) {
+        LOG_WARNING << "Copied lines take " << file->size() << " bytes, too many for clipboard";
+        Q_EMIT tooLargeForClipboard( firstLine_, nbLines_, file->size() );
+    }
+    else {
+        // Clipboard owns its mime data, each mode gets its own one
+        clipboard->setMimeData( new FileMimeData( file ), QClipboard::Clipboard );
+        if ( updateSelection_ && clipboard->supportsSelection() ) {
+            clipboard->setMimeData( new FileMimeData( file ), QClipboard::Selection );
+        }
+    }
+
+    Q_EMIT finished();
+}
+
+bool SelectionCopier::copyLines( LineNumber firstLine, LinesCount nbLines, bool lineNumbers )
+{
+#if defined( Q_OS_WIN )
+    const auto lineSeparator = QStringLiteral( "\r\n" );
+#else
+    const auto lineSeparator = QStringLiteral( "\n" );
+#endif
+
+    const auto endLine = firstLine.get() + nbLines.get();
+    auto lastPercent = 0;
+
+    for ( auto chunkStart = firstLine.get(); chunkStart < endLine; chunkStart += ChunkLines ) {
+        if ( interruptRequested_ ) {
+            return false;
+        }
+
+        const auto chunkLines = std::min<LinesCount::UnderlyingType>( ChunkLines,
+                                                                      endLine - chunkStart );
+        const auto lines
+            = logData_.getLines( LineNumber( chunkStart ), LinesCount( chunkLines ) );
+
+        QString text;
+        for ( auto index = 0u; index < lines.size(); ++index ) {
+            const auto line = LineNumber( chunkStart + index );
+            if ( line > firstLine ) {
+                text.append( lineSeparator );
+            }
+            if ( lineNumbers ) {
+                text.append(
+                    QStringLiteral( "%1: " ).arg( logData_.getLineNumber( line ).get() ) );
+            }
+            text.append( lines[ index ] );
+        }
+        text.replace( QChar::Null, QChar::Space );
+
+        const auto encodedText = text.toUtf8();
+        if ( file_->write( encodedText ) != encodedText.size() ) {
+            LOG_ERROR << "Failed to write copied lines to " << file_->fileName();
+            return false;
+        }
+
+        const auto percent = static_cast<int>( ( chunkStart + chunkLines - firstLine.get() )
+                                               * 100 / nbLines.get() );
+        if ( percent != lastPercent ) {
+            lastPercent = percent;
+            Q_EMIT progressed( percent );
+        }
+    }
+
+    return file_->flush();
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wrappedlinesindex.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <QtConcurrent>
+
+#include "abstractlogdata.h"
+#include "log.h"
+#include "logfiltereddata.h"
+#include "wrappedstring.h"
+
+namespace {
+
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+
+// Characters read at once, chunks of long lines have fewer of them
+constexpr LineLength::UnderlyingType ChunkChars = 4 * 1024 * 1024;
+
+// Rows of lines indexed so far are published at most this often
+constexpr auto ProgressInterval = std::chrono::milliseconds( 250 );
+
+// Long lines are read one by one when the width grows, if there are more
+// of them than this part of all lines, the whole log is read instead
+constexpr LinesCount::UnderlyingType LongLinesShare = 8;
+
+} // namespace
+
+WrappedLinesIndex::WrappedLinesIndex( const AbstractLogData& logData )
+    : logData_( logData )
+    , filteredData_( dynamic_cast<const LogFilteredData*>( &logData ) )
+{
+    connect( &buildWatcher_, &QFutureWatcher<void>::finished, this,
+             &WrappedLinesIndex::onBuildFinished );
+}
+
+WrappedLinesIndex::~WrappedLinesIndex()
+{
+    stop();
+}
+
+void WrappedLinesIndex::setVisibleColumns( LineLength visibleColumns )
+{
+    if ( visibleColumns == visibleColumns_ ) {
+        return;
+    }
+
+    stop();
+    isUpdatePending_ = false;
+    visibleColumns_ = visibleColumns;
+
+    if ( visibleColumns_.get() > 0 ) {
+        startBuild();
+    }
+    else {
+        clear();
+    }
+}
+
+void WrappedLinesIndex::update()
+{
+    if ( visibleColumns_.get() == 0 ) {
+        return;
+    }
+
+    if ( buildWatcher_.isRunning() ) {
+        isUpdatePending_ = true;
+    }
+    else {
+        startBuild();
+    }
+}
+
+void WrappedLinesIndex::stop()
+{
+    interruptRequested_.set();
+    buildWatcher_.waitForFinished();
+}
+
+uint64_t WrappedLinesIndex::totalRows( LinesCount nbLines ) const
+{
+    SharedLock lock( mutex_ );
+    return nbLines.get() + extraRowsBefore( nbLines.get() );
+}
+
+uint64_t WrappedLinesIndex::rowOfLine( LineNumber line ) const
+{
+    SharedLock lock( mutex_ );
+    return line.get() + extraRowsBefore( line.get() );
+}
+
+LineNumber WrappedLinesIndex::lineOfRow( uint64_t row ) const
+{
+    SharedLock lock( mutex_ );
+
+    const auto firstRow = [ this ]( size_t index ) {
+        return wrappedLines_[ index ].line
+               + ( index > 0 ? wrappedLines_[ index - 1 ].extraRows : 0 );
+    };
+
+    // First wrapped line starting after the row
+    size_t low = 0;
+    size_t high = wrappedLines_.size();
+    while ( low < high ) {
+        const auto middle = low + ( high - low ) / 2;
+        if ( firstRow( middle ) <= row ) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if ( low == 0 ) {
+        return LineNumber( row );
+    }
+
+    // Rows after the last one of the wrapped line belong to one row lines
+    const auto& wrapped = wrappedLines_[ low - 1 ];
+    return LineNumber( row <= wrapped.line + wrapped.extraRows ? wrapped.line
+                                                               : row - wrapped.extraRows );
+}
+
+void WrappedLinesIndex::onBuildFinished()
+{
+    Q_EMIT indexUpdated();
+
+    if ( isUpdatePending_ && visibleColumns_.get() > 0 ) {
+        isUpdatePending_ = false;
+        startBuild();
+    }
+}
+
+void WrappedLinesIndex::startBuild()
+{
+    interruptRequested_.clear();
+    buildWatcher_.setFuture( QtConcurrent::run(
+        [ this, visibleColumns = visibleColumns_ ]() { build( visibleColumns ); } ) );
+}
+
+void WrappedLinesIndex::clear()
+{
+    UniqueLock lock( mutex_ );
+    wrappedLines_.clear();
+    indexedColumns_ = 0_length;
+    indexedLines_ = 0_lcount;
+    lastIndexedSourceLine_ = 0;
+    longLines_.clear();
+    longLinesColumns_ = 0_length;
+}
+
+LinesCount WrappedLinesIndex::unchangedLines( LinesCount nbLines ) const
+{
+    if ( indexedLines_.get() == 0 || indexedLines_ > nbLines ) {
+        return 0_lcount;
+    }
+
+    // Lines added or removed before the last indexed one move it
+    const auto lastLine = indexedLines_.get() - 1;
+    if ( sourceLine( lastLine ) != lastIndexedSourceLine_ ) {
+        return 0_lcount;
+    }
+
+    // The last indexed line could have been incomplete
+    return LinesCount( lastLine );
+}
+
+LineNumber::UnderlyingType WrappedLinesIndex::sourceLine( LinesCount::UnderlyingType line ) const
+{
+    return filteredData_ != nullptr
+               ? filteredData_->getMatchingLineNumber( LineNumber( line ) ).get()
+               : line;
+}
+
+uint64_t WrappedLinesIndex::extraRowsBefore( LineNumber::UnderlyingType line ) const
+{
+    const auto next = std::lower_bound(
+        wrappedLines_.begin(), wrappedLines_.end(), line,
+        []( const WrappedLine& wrapped, LineNumber::UnderlyingType value ) {
+            return wrapped.line < value;
+        } );
+
+    return next == wrappedLines_.begin() ? 0 : std::prev( next )->extraRows;
+}
+
+void WrappedLinesIndex::build( LineLength visibleColumns )
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto nbLines = logData_.getNbLine();
+
+    auto begin = LineNumber( unchangedLines( nbLines ).get() );
+    while ( !longLines_.empty() && longLines_.back().line >= begin.get() ) {
+        longLines_.pop_back();
+    }
+
+    const auto isWidthChanged = indexedColumns_ != visibleColumns;
+    if ( isWidthChanged && visibleColumns >= longLinesColumns_ ) {
+        const auto linesToWrap = std::count_if(
+            longLines_.begin(), longLines_.end(), [ visibleColumns ]( const LongLine& line ) {
+                return line.length > visibleColumns.get();
+            } );
+        if ( static_cast<uint64_t>( linesToWrap ) > begin.get() / LongLinesShare ) {
+            begin = 0_lnum;
+        }
+    }
+    else if ( isWidthChanged ) {
+        begin = 0_lnum;
+    }
+
+    if ( begin.get() == 0 ) {
+        longLines_.clear();
+        longLinesColumns_ = visibleColumns;
+    }
+
+    // Index is replaced on the first publishing if the width has changed,
+    // otherwise lines from the beginning are added to it
+    auto isReplacing = isWidthChanged || begin.get() == 0;
+    auto publishedExtraRows = uint64_t{ 0 };
+    if ( !isReplacing ) {
+        // The line indexed again takes one row until it is published
+        UniqueLock lock( mutex_ );
+        while ( !wrappedLines_.empty() && wrappedLines_.back().line >= begin.get() ) {
+            wrappedLines_.pop_back();
+        }
+        publishedExtraRows = wrappedLines_.empty() ? 0 : wrappedLines_.back().extraRows;
+    }
+
+    klogg::vector<WrappedLine> lines;
+    const auto addLine = [ &lines, &publishedExtraRows ]( LineNumber::UnderlyingType line,
+                                                          size_t rows ) {
+        const auto extraRows = lines.empty() ? publishedExtraRows : lines.back().extraRows;
+        lines.push_back( WrappedLine{ line, extraRows + rows - 1 } );
+    };
+
+    const auto publish = [ this, &lines, &isReplacing, &publishedExtraRows,
+                           visibleColumns ]( LinesCount indexedLines ) {
+        const auto lastSourceLine
+            = indexedLines.get() > 0 ? sourceLine( indexedLines.get() - 1 ) : 0;
+
+        UniqueLock lock( mutex_ );
+        if ( isReplacing ) {
+            wrappedLines_ = std::move( lines );
+            isReplacing = false;
+        }
+        else {
+            wrappedLines_.insert( wrappedLines_.end(), lines.begin(), lines.end() );
+        }
+        lines.clear();
+        publishedExtraRows = wrappedLines_.empty() ? 0 : wrappedLines_.back().extraRows;
+
+        indexedColumns_ = visibleColumns;
+        indexedLines_ = indexedLines;
+        lastIndexedSourceLine_ = lastSourceLine;
+    };
+
+    const auto isInterrupted = [ this, &isReplacing, begin ] {
+        if ( !interruptRequested_ ) {
+            return false;
+        }
+
+        // Long lines are collected from the beginning again
+        if ( isReplacing && begin.get() == 0 ) {
+            UniqueLock lock( mutex_ );
+            indexedLines_ = 0_lcount;
+        }
+        return true;
+    };
+
+    // Only lines known to be long are wrapped again to the new width
+    auto nbWrappedAgain = uint64_t{ 0 };
+    if ( isReplacing ) {
+        for ( const auto& longLine : longLines_ ) {
+            if ( longLine.length <= visibleColumns.get() ) {
+                continue;
+            }
+            if ( isInterrupted() ) {
+                return;
+            }
+            ++nbWrappedAgain;
+
+            const auto rows = WrappedString{
+                logData_.getExpandedLineString( LineNumber( longLine.line ) ), visibleColumns
+            }.wrappedLinesCount();
+            if ( rows > 1 ) {
+                addLine( longLine.line, rows );
+            }
+        }
+    }
+
+    auto lastProgress = startTime;
+    auto chunkStart = begin;
+    const auto chunkLinesFor = []( LineLength::UnderlyingType lineLength ) {
+        const auto lines = ChunkChars / std::max( LineLength::UnderlyingType{ 1 }, lineLength );
+        return std::clamp( static_cast<LinesCount::UnderlyingType>( lines ),
+                           LinesCount::UnderlyingType{ 1 }, ChunkLines );
+    };
+    // The first chunk is read assuming all lines are the longest one
+    auto maxChunkLines = chunkLinesFor( logData_.getMaxLength().get() );
+    while ( chunkStart.get() < nbLines.get() ) {
+        if ( isInterrupted() ) {
+            return;
+        }
+
+        const auto chunkLines
+            = LinesCount( std::min( maxChunkLines, nbLines.get() - chunkStart.get() ) );
+        const auto expandedLines = logData_.getExpandedLines( chunkStart, chunkLines );
+
+        auto chunkChars = LineLength::UnderlyingType{ 0 };
+        for ( auto index = 0u; index < expandedLines.size(); ++index ) {
+            if ( isInterrupted() ) {
+                return;
+            }
+
+            const auto& expandedLine = expandedLines[ index ];
+            chunkChars += expandedLine.size();
+            const auto line = chunkStart.get() + index;
+            const auto length = static_cast<LineLength::UnderlyingType>( expandedLine.size() );
+            if ( length > longLinesColumns_.get() ) {
+                longLines_.push_back( LongLine{ line, length } );
+            }
+
+            // Lines fitting the width take one row
+            if ( length <= visibleColumns.get() ) {
+                continue;
+            }
+
+            const auto rows = WrappedString{ expandedLine, visibleColumns }.wrappedLinesCount();
+            if ( rows > 1 ) {
+                addLine( line, rows );
+            }
+        }
+        chunkStart = chunkStart + chunkLines;
+
+        // Next chunk is expected to have lines as long as this one
+        const auto averageLength
+            = chunkChars / static_cast<LineLength::UnderlyingType>( chunkLines.get() );
+        maxChunkLines = chunkLinesFor( averageLength );
+
+        // Lines before the indexed ones don't change, they can be used already
+        const auto now = std::chrono::steady_clock::now();
+        if ( now - lastProgress > ProgressInterval ) {
+            publish( LinesCount( chunkStart.get() ) );
+            lastProgress = now;
+            Q_EMIT indexUpdated();
+        }
+    }
+
+    publish( nbLines );
+
+    LOG_INFO << "Wrapped lines index has " << wrappedLines_.size() << " wrapped lines in "
+             << nbLines << " lines, wrapped again " << nbWrappedAgain << " long lines, indexed "
+             << ( nbLines.get() - begin.get() ) << " lines in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startTime )
+                    .count()
+             << " ms";
+}
@@ -209,6 +209,81 @@ SCENARIO( "marks in filtered log data", "[logdata]" )
                 }
             }
         }
+
+        WHEN( "Marking lines in bulk" )
+        {
+            const auto lineLength
+                = LineLength{ logDataLoader.log_data.getExpandedLineString( 10_lnum ).size() };
+
+            SearchResultArray lines;
+            lines.addRange( 10, 20 );
+            lines.add( static_cast<uint64_t>( SL_NB_LINES + 25 ) );
+            filtered_data->addMarks( lines );
+
+            THEN( "Marks inside file are added" )
+            {
+                REQUIRE( filtered_data->getNbMarks() == 10_lcount );
+                REQUIRE( filtered_data->getMaxLength() == lineLength );
+            }
+
+            AND_WHEN( "Adding overlapping marks" )
+            {
+                SearchResultArray more;
+                more.addRange( 15, 30 );
+                filtered_data->addMarks( more );
+
+                THEN( "Marks are the union" )
+                {
+                    REQUIRE( filtered_data->getNbMarks() == 20_lcount );
+                    REQUIRE( filtered_data->lineTypeByLine( 29_lnum ).testFlag(
+                        LineTypeFlags::Mark ) );
+                }
+            }
+
+            AND_WHEN( "Removing some marks" )
+            {
+                SearchResultArray removed;
+                removed.addRange( 5, 15 );
+                filtered_data->removeMarks( removed );
+
+                THEN( "Only marked lines are removed" )
+                {
+                    REQUIRE( filtered_data->getNbMarks() == 5_lcount );
+                    REQUIRE_FALSE( filtered_data->lineTypeByLine( 14_lnum ).testFlag(
+                        LineTypeFlags::Mark ) );
+                    REQUIRE( filtered_data->getMaxLength() == lineLength );
+                }
+            }
+
+            AND_WHEN( "Toggling partly marked lines" )
+            {
+                SearchResultArray toggled;
+                toggled.addRange( 15, 25 );
+                filtered_data->toggleMarks( toggled );
+
+                THEN( "Marked lines are unmarked and the rest marked" )
+                {
+                    REQUIRE( filtered_data->getNbMarks() == 10_lcount );
+                    REQUIRE( filtered_data->lineTypeByLine( 14_lnum ).testFlag(
+                        LineTypeFlags::Mark ) );
+                    REQUIRE_FALSE( filtered_data->lineTypeByLine( 15_lnum ).testFlag(
+                        LineTypeFlags::Mark ) );
+                    REQUIRE( filtered_data->lineTypeByLine( 24_lnum ).testFlag(
+                        LineTypeFlags::Mark ) );
+                }
+            }
+
+            AND_WHEN( "Toggling all marked lines" )
+            {
+                filtered_data->toggleMarks( lines );
+
+                THEN( "All marks are removed" )
+                {
+                    REQUIRE( filtered_data->getNbMarks() == 0_lcount );
+                    REQUIRE( filtered_data->getMaxLength() == 0_length );
+                }
+            }
+        }
     }
 }
 
@@ -20,6 +20,7 @@
 #include <catch2/catch.hpp>
 
 #include "regularexpression.h"
+#include "spanregularexpression.h"
 
 SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
 {
@@ -65,3 +66,136 @@ SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
         REQUIRE_FALSE( expression.isValid() );
     }
 }
+
+SCENARIO( "Required literals extraction", "[patternmatcher]" )
+{
+    WHEN( "Pattern has mandatory literals" )
+    {
+        const auto literals = extractRequiredLiterals( "ERROR.*timeout=\\d+" );
+        REQUIRE( literals.size() == 2 );
+        REQUIRE( literals[ 0 ] == "ERROR" );
+        REQUIRE( literals[ 1 ] == "timeout=" );
+    }
+
+    WHEN( "Pattern has optional characters" )
+    {
+        const auto literals = extractRequiredLiterals( "abcd?ef(gh)*x\\.y{0,2}" );
+        REQUIRE( literals.size() == 3 );
+        REQUIRE( literals[ 0 ] == "abc" );
+        REQUIRE( literals[ 1 ] == "ef" );
+        REQUIRE( literals[ 2 ] == "x." );
+    }
+
+    WHEN( "Pattern has top level alternation" )
+    {
+        REQUIRE( extractRequiredLiterals( "error|warning" ).empty() );
+    }
+
+    WHEN( "Pattern has inline options" )
+    {
+        REQUIRE( extractRequiredLiterals( "(?i)error" ).empty() );
+    }
+}
+
+SCENARIO( "Pattern matcher with required literals", "[patternmatcher]" )
+{
+    RegularExpression expression(
+        RegularExpressionPattern( "error.*timeout=\\d+", false, false, false, false ) );
+    const auto matcher = expression.createMatcher();
+
+    WHEN( "Block lacks required literal" )
+    {
+        const auto result = matcher->precheckBlock( "ERROR: connection lost\nok\n" );
+        REQUIRE( result.has_value() );
+        REQUIRE_FALSE( *result );
+    }
+
+    WHEN( "Block has required literals" )
+    {
+        std::string_view line = "Error: TIMEOUT=30";
+        REQUIRE_FALSE( matcher->precheckBlock( line ).has_value() );
+        REQUIRE( matcher->hasMatch( line ) );
+    }
+
+    WHEN( "Exclude pattern block lacks required literal" )
+    {
+        RegularExpression excludeExpression(
+            RegularExpressionPattern( "timeout", true, true, false, false ) );
+        const auto excludeMatcher = excludeExpression.createMatcher();
+        const auto result = excludeMatcher->precheckBlock( "all good\nstill good" );
+        REQUIRE( result.has_value() );
+        REQUIRE( *result );
+    }
+}
+
+SCENARIO( "Pattern matcher with many boolean sub-patterns", "[patternmatcher]" )
+{
+    RegularExpression expression( RegularExpressionPattern(
+        "(\"alpha\" & \"beta\") | (\"gamma\" & !\"delta\") | (\"eps.*lon\" & \"zeta\")", false,
+        false, true, false ) );
+    const auto matcher = expression.createMatcher();
+
+    WHEN( "First conjunction matches" )
+    {
+        REQUIRE( matcher->hasMatch( "alpha and beta" ) );
+    }
+
+    WHEN( "Negated sub-pattern matches" )
+    {
+        REQUIRE_FALSE( matcher->hasMatch( "gamma with delta" ) );
+        REQUIRE( matcher->hasMatch( "gamma alone" ) );
+    }
+
+    WHEN( "Regular expression sub-pattern matches" )
+    {
+        REQUIRE( matcher->hasMatch( "epsilon and zeta" ) );
+        REQUIRE_FALSE( matcher->hasMatch( "epsilon and alpha" ) );
+    }
+}
+
+SCENARIO( "Span matcher for plain text patterns", "[patternmatcher]" )
+{
+    SpanRegularExpression expression( klogg::vector<RegularExpressionPattern>{
+        RegularExpressionPattern( "aa", true, false, false, true ),
+        RegularExpressionPattern( "a.b", false, false, false, true ) } );
+    const auto matcher = expression.createMatcher();
+
+    const auto match = [ &matcher ]( const QString& line ) {
+        const auto utf8Line = line.toUtf8();
+        return matcher->match( line, std::string_view{ utf8Line.data(),
+                                                       static_cast<size_t>( utf8Line.size() ) } );
+    };
+
+    WHEN( "Pattern occurrences overlap" )
+    {
+        const auto spans = match( "aaaaa" );
+        REQUIRE( spans.size() == 2 );
+        REQUIRE( spans[ 0 ].from == 0 );
+        REQUIRE( spans[ 0 ].to == 2 );
+        REQUIRE( spans[ 1 ].from == 2 );
+        REQUIRE( spans[ 1 ].to == 4 );
+    }
+
+    WHEN( "Pattern has special characters" )
+    {
+        REQUIRE( match( "axb" ).empty() );
+
+        const auto spans = match( "A.B" );
+        REQUIRE( spans.size() == 1 );
+        REQUIRE( spans[ 0 ].id == 1 );
+    }
+
+    WHEN( "Line has multibyte characters" )
+    {
+        // Two characters of the BMP and one surrogate pair before the patterns
+        const auto spans
+            = match( QString::fromUtf8( "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80 aa a.b" ) );
+        REQUIRE( spans.size() == 2 );
+        REQUIRE( spans[ 0 ].id == 0 );
+        REQUIRE( spans[ 0 ].from == 5 );
+        REQUIRE( spans[ 0 ].to == 7 );
+        REQUIRE( spans[ 1 ].id == 1 );
+        REQUIRE( spans[ 1 ].from == 8 );
+        REQUIRE( spans[ 1 ].to == 11 );
+    }
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "searchresultarray.h"
+
+namespace {
+
+std::vector<uint64_t> valuesOf( const SearchResultArray& array )
+{
+    std::vector<uint64_t> values;
+    array.iterate(
+        []( uint64_t value, void* context ) -> bool {
+            static_cast<std::vector<uint64_t>*>( context )->push_back( value );
+            return true;
+        },
+        static_cast<void*>( &values ) );
+    return values;
+}
+
+void requireIndexMatches( const SearchResultArray& array, const SearchResultRankIndex& index )
+{
+    const auto values = valuesOf( array );
+    REQUIRE( index.cardinality() == values.size() );
+
+    for ( auto rank = 0u; rank < values.size(); ++rank ) {
+        uint64_t element = 0;
+        REQUIRE( index.select( array, rank, &element ) );
+        REQUIRE( element == values[ rank ] );
+        REQUIRE( index.rank( array, values[ rank ] ) == rank + 1 );
+        REQUIRE( index.rank( array, values[ rank ] + 1 ) == array.rank( values[ rank ] + 1 ) );
+    }
+
+    uint64_t element = 0;
+    REQUIRE_FALSE( index.select( array, values.size(), &element ) );
+}
+
+SearchResultArray roundTrip( const SearchResultArray& array )
+{
+    std::vector<char> buffer( array.getSizeInBytes() );
+    REQUIRE( array.write( buffer.data() ) == buffer.size() );
+    return SearchResultArray::readSafe( buffer.data(), buffer.size() );
+}
+
+} // namespace
+
+SCENARIO( "Search result array", "[searchresultarray]" )
+{
+    GIVEN( "Array of narrow values" )
+    {
+        SearchResultArray array;
+        array.addRange( 10, 20 );
+        const std::vector<uint64_t> singles = { 1, 100, 70000 };
+        array.addMany( singles.size(), singles.data() );
+
+        REQUIRE_FALSE( array.isWide() );
+        REQUIRE( array.cardinality() == 13 );
+        REQUIRE( array.minimum() == 1 );
+        REQUIRE( array.maximum() == 70000 );
+
+        THEN( "Rank and select are consistent" )
+        {
+            REQUIRE( array.rank( 0 ) == 0 );
+            REQUIRE( array.rank( 15 ) == 7 );
+            REQUIRE( array.rank( 70000 ) == 13 );
+
+            uint64_t element = 0;
+            REQUIRE( array.select( 1, &element ) );
+            REQUIRE( element == 10 );
+            REQUIRE( array.select( 12, &element ) );
+            REQUIRE( element == 70000 );
+            REQUIRE_FALSE( array.select( 13, &element ) );
+        }
+
+        WHEN( "Line above 32 bits is added" )
+        {
+            const uint64_t wideLine = uint64_t{ std::numeric_limits<uint32_t>::max() } + 5;
+            array.add( wideLine );
+
+            THEN( "Array becomes wide and keeps its values" )
+            {
+                REQUIRE( array.isWide() );
+                REQUIRE( array.cardinality() == 14 );
+                REQUIRE( array.contains( 70000 ) );
+                REQUIRE( array.maximum() == wideLine );
+                REQUIRE( array.rank( wideLine ) == 14 );
+            }
+
+            THEN( "Wide array is restored from serialized data" )
+            {
+                const auto restored = roundTrip( array );
+                REQUIRE( restored.isWide() );
+                REQUIRE( valuesOf( restored ) == valuesOf( array ) );
+            }
+        }
+
+        WHEN( "Narrow array is combined with a wide one" )
+        {
+            auto wide = SearchResultArray::forLines(
+                LinesCount( uint64_t{ std::numeric_limits<uint32_t>::max() } + 10 ) );
+            wide.add( 5 );
+            array |= wide;
+
+            THEN( "Result is wide" )
+            {
+                REQUIRE( array.isWide() );
+                REQUIRE( array.cardinality() == 14 );
+                REQUIRE( array.contains( 5 ) );
+            }
+        }
+
+        THEN( "Narrow array is restored from serialized data" )
+        {
+            const auto restored = roundTrip( array );
+            REQUIRE_FALSE( restored.isWide() );
+            REQUIRE( valuesOf( restored ) == valuesOf( array ) );
+        }
+
+        THEN( "Invalid serialized data is rejected" )
+        {
+            const char unknownTag[] = { 2, 0, 0, 0 };
+            REQUIRE_THROWS_AS( SearchResultArray::readSafe( unknownTag, sizeof( unknownTag ) ),
+                               std::runtime_error );
+            REQUIRE_THROWS( SearchResultArray::readSafe( unknownTag, 0 ) );
+        }
+    }
+}
+
+SCENARIO( "Search result rank index", "[searchresultarray]" )
+{
+    GIVEN( "Index of a set spanning several samples" )
+    {
+        constexpr uint64_t Count = SearchResultRankIndex::SampleStep * 5 + 17;
+
+        SearchResultArray array;
+        for ( uint64_t value = 0; value < Count; ++value ) {
+            array.add( value * 3 + 1 );
+        }
+
+        SearchResultRankIndex index;
+        index.rebuild( array );
+
+        THEN( "Rank and select match the array" )
+        {
+            requireIndexMatches( array, index );
+        }
+
+        WHEN( "Values are appended and index is extended" )
+        {
+            array.addRange( Count * 3 + 10, Count * 3 + 10 + SearchResultRankIndex::SampleStep );
+            index.extend( array );
+
+            THEN( "Extended index matches the array" )
+            {
+                requireIndexMatches( array, index );
+            }
+        }
+
+        WHEN( "Last values are removed across a sample boundary" )
+        {
+            while ( array.cardinality() > SearchResultRankIndex::SampleStep * 5 - 3 ) {
+                array.remove( array.maximum() );
+                index.removeLast( array );
+            }
+
+            THEN( "Index matches the array" )
+            {
+                requireIndexMatches( array, index );
+            }
+        }
+
+        WHEN( "Values are inserted in the middle and index is rebuilt from them" )
+        {
+            array.addRange( 2000, 2100 );
+            index.rebuildFrom( array, 2000 );
+
+            THEN( "Index matches the array" )
+            {
+                requireIndexMatches( array, index );
+            }
+        }
+
+        WHEN( "A value is removed in the middle and index is rebuilt from it" )
+        {
+            array.remove( 301 );
+            index.rebuildFrom( array, 301 );
+
+            THEN( "Index matches the array" )
+            {
+                requireIndexMatches( array, index );
+            }
+        }
+    }
+
+    GIVEN( "Index of a wide set" )
+    {
+        const uint64_t base = uint64_t{ std::numeric_limits<uint32_t>::max() } - 100;
+
+        SearchResultArray array;
+        array.addRange( base, base + SearchResultRankIndex::SampleStep * 2 );
+
+        SearchResultRankIndex index;
+        index.rebuild( array );
+
+        THEN( "Rank and select match the array" )
+        {
+            REQUIRE( array.isWide() );
+            requireIndexMatches( array, index );
+        }
+    }
+}
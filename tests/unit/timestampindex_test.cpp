@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "linetypes.h"
+#include "timestampindex.h"
+
+SCENARIO( "Timestamp parsing", "[timestampindex]" )
+{
+    GIVEN( "ISO timestamp format" )
+    {
+        TimestampParser parser( "yyyy-MM-dd HH:mm:ss.zzz" );
+        REQUIRE( parser.isValid() );
+
+        THEN( "Time at the beginning of line is parsed" )
+        {
+            const auto timestamp = parser.parse( "2021-03-04 05:06:07.089 INFO message" );
+            REQUIRE( timestamp.has_value() );
+            REQUIRE( *timestamp == 1614834367089 );
+        }
+
+        THEN( "Lines without timestamp are rejected" )
+        {
+            REQUIRE_FALSE( parser.parse( "  at some.continuation.Line" ).has_value() );
+            REQUIRE_FALSE( parser.parse( "2021-03-04" ).has_value() );
+            REQUIRE_FALSE( parser.parse( "2021-13-04 05:06:07.089" ).has_value() );
+        }
+    }
+
+    GIVEN( "Syslog timestamp format" )
+    {
+        TimestampParser parser( "MMM dd HH:mm:ss" );
+
+        THEN( "Month name is parsed" )
+        {
+            const auto timestamp = parser.parse( "Feb 01 00:00:01 host daemon" );
+            REQUIRE( timestamp.has_value() );
+            REQUIRE( *timestamp == ( 31LL * 24 * 3600 + 1 ) * 1000 );
+        }
+
+        THEN( "Day padded with space is parsed" )
+        {
+            const auto timestamp = parser.parse( "Feb  1 00:00:01 host daemon" );
+            REQUIRE( timestamp.has_value() );
+            REQUIRE( *timestamp == ( 31LL * 24 * 3600 + 1 ) * 1000 );
+        }
+    }
+}
+
+SCENARIO( "Timestamp index lookup", "[timestampindex]" )
+{
+    GIVEN( "Index with ordered timestamps" )
+    {
+        TimestampIndex index;
+        index.add( 0_lnum, 100 );
+        index.add( 1024_lnum, 200 );
+        index.add( 2048_lnum, 300 );
+
+        THEN( "Range around the time is found" )
+        {
+            const auto range = index.findRange( 250, 3000_lcount );
+            REQUIRE( range.first == 1024_lnum );
+            REQUIRE( range.second == 2048_lnum );
+        }
+
+        THEN( "Range after the last entry ends at end of file" )
+        {
+            const auto range = index.findRange( 301, 3000_lcount );
+            REQUIRE( range.first == 2048_lnum );
+            REQUIRE( range.second == 3000_lnum );
+        }
+
+        WHEN( "Earlier timestamp is added" )
+        {
+            index.add( 3072_lnum, 50 );
+
+            THEN( "Index is disabled" )
+            {
+                REQUIRE_FALSE( index.isMonotone() );
+                REQUIRE( index.isEmpty() );
+            }
+        }
+    }
+}
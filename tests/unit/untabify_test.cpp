@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QString>
+
+#include "linetypes.h"
+
+namespace {
+
+QString expand( const QString& line, LineColumn initialPosition = 0_lcol,
+                TabColumnMap* columnMap = nullptr )
+{
+    return untabify( QString( line ), initialPosition, columnMap );
+}
+
+} // namespace
+
+SCENARIO( "Tabs expansion", "[untabify]" )
+{
+    TabColumnMap columnMap;
+
+    GIVEN( "Line without tabs" )
+    {
+        const auto expanded = expand( QStringLiteral( "some text" ), 0_lcol, &columnMap );
+
+        THEN( "Line is not changed" )
+        {
+            REQUIRE( expanded == QStringLiteral( "some text" ) );
+            REQUIRE( columnMap.empty() );
+            REQUIRE( columnMap.expandedColumn( 5_lcol ) == 5_lcol );
+        }
+    }
+
+    GIVEN( "Tab at column 0" )
+    {
+        const auto expanded = expand( QStringLiteral( "\tab" ), 0_lcol, &columnMap );
+
+        THEN( "Tab takes whole tab stop" )
+        {
+            REQUIRE( expanded == QStringLiteral( "        ab" ) );
+            REQUIRE( columnMap.expandedColumn( 0_lcol ) == 0_lcol );
+            REQUIRE( columnMap.expandedColumn( 1_lcol ) == 8_lcol );
+            REQUIRE( columnMap.expandedColumn( 2_lcol ) == 9_lcol );
+        }
+    }
+
+    GIVEN( "Consecutive tabs" )
+    {
+        const auto expanded = expand( QStringLiteral( "a\t\tb" ), 0_lcol, &columnMap );
+
+        THEN( "Each tab goes to the next tab stop" )
+        {
+            REQUIRE( expanded == QStringLiteral( "a" ) + QString( 15, QChar::Space ) + "b" );
+            REQUIRE( columnMap.expandedColumn( 1_lcol ) == 1_lcol );
+            REQUIRE( columnMap.expandedColumn( 2_lcol ) == 8_lcol );
+            REQUIRE( columnMap.expandedColumn( 3_lcol ) == 16_lcol );
+        }
+    }
+
+    GIVEN( "Line starting after column 0" )
+    {
+        const auto expanded = expand( QStringLiteral( "ab\tc" ), 3_lcol, &columnMap );
+
+        THEN( "Tab stops are counted from the initial position" )
+        {
+            REQUIRE( expanded == QStringLiteral( "ab   c" ) );
+            REQUIRE( columnMap.expandedColumn( 3_lcol ) == 5_lcol );
+        }
+    }
+
+    GIVEN( "Tab between words" )
+    {
+        const auto expanded = expand( QStringLiteral( "abc\tdef" ), 0_lcol, &columnMap );
+
+        THEN( "Tab position is mapped to the start of its spaces" )
+        {
+            REQUIRE( columnMap.expandedColumn( 3_lcol ) == 3_lcol );
+        }
+
+        THEN( "Span ending right after the tab includes all its spaces" )
+        {
+            const auto start = columnMap.expandedColumn( 1_lcol );
+            const auto end = columnMap.expandedColumn( 4_lcol );
+            REQUIRE( expanded.mid( start.get(), ( end - start ).get() )
+                     == QStringLiteral( "bc     " ) );
+        }
+
+        THEN( "Columns past the last tab are shifted by all spaces" )
+        {
+            REQUIRE( columnMap.expandedColumn( 6_lcol ) == 10_lcol );
+            REQUIRE( expanded.at( 10 ) == QChar( 'f' ) );
+        }
+    }
+}